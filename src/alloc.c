@@ -0,0 +1,92 @@
+/*
+ * alloc.c -
+ *
+ * Implementation of aligned memory and workspaces in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "tpl-alloc.h"
+
+struct TPL_Arena {
+    char* data;
+    size_t size;
+    size_t used;
+};
+
+void*
+tpl_alloc(size_t size)
+{
+    void* ptr = NULL;
+    int code = posix_memalign(&ptr, TPL_ALIGNMENT,
+                              TPL_ARENA_SIZE(size > 0 ? size : 1));
+    if (code != 0) {
+        errno = code;
+        return NULL;
+    }
+    return ptr;
+}
+
+void
+tpl_free(void* ptr)
+{
+    free(ptr);
+}
+
+TPL_Arena*
+tpl_create_arena(size_t size)
+{
+    TPL_Arena* arena = malloc(sizeof(TPL_Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->size = TPL_ARENA_SIZE(size);
+    arena->used = 0;
+    arena->data = tpl_alloc(arena->size);
+    if (arena->data == NULL) {
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+void
+tpl_destroy_arena(TPL_Arena* arena)
+{
+    if (arena != NULL) {
+        tpl_free(arena->data);
+        free(arena);
+    }
+}
+
+void*
+tpl_arena_alloc(TPL_Arena* arena, size_t size)
+{
+    size = TPL_ARENA_SIZE(size);
+    if (size > arena->size - arena->used) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    void* ptr = arena->data + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+void
+tpl_arena_reset(TPL_Arena* arena)
+{
+    arena->used = 0;
+}
+
+size_t
+tpl_arena_used(TPL_Arena const* arena)
+{
+    return arena->used;
+}
@@ -0,0 +1,222 @@
+/*
+ * bank.c -
+ *
+ * Implementation of filter banks, that is several filters applied to the same
+ * source.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_BANK_C
+#define _TPL_BANK_C 1
+
+#include "tpl-filter.h"
+#include "tpl-image.h"
+#include "tpl-inline.h"
+#include "tpl-stats.h"
+
+#define _tpl_index       long
+
+/* Assume column-major storage order. */
+#define dst(i1,i2)       dst[(i1) + dst_len1*(i2)]
+#define src(i1,i2)       src[(i1) + src_len1*(i2)]
+
+/*
+ * Kernels are applied by groups of at most `GROUP` to chunks of `CHUNK`
+ * outputs so that the `GROUP*CHUNK` sums fit in the vector registers while
+ * each chunk of source values is loaded once per group.
+ */
+#define GROUP  4
+#define CHUNK 16
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_BANK_C defined */
+
+/*
+ * Rows combined by the kernels are `row(j) = src + ld*clamp(j0 + j, 0, jmax)`
+ * which amounts to flat boundary conditions along the rows.
+ */
+#define row(j) (src + ld*pvc_min(pvc_max(j0 + (j), 0), jmax))
+
+/*
+ * Compute `dst[k*inc + i] = sum_j ker[k*m + j]*row(j)[i]` for `0 ≤ k < nk`
+ * and `0 ≤ i < n`.  This function is inlined with constant `nk` so that the
+ * loops on `k` and on the chunk are fully unrolled.
+ */
+static TPL_FORCE_INLINE void
+_tpl_private(bank_rows)(int nk,
+                        _tpl_index m,
+                        _tpl_index n,
+                        _tpl_float*restrict dst,
+                        _tpl_index inc,
+                        _tpl_float const*restrict ker,
+                        _tpl_float const* src,
+                        _tpl_index ld,
+                        _tpl_index j0,
+                        _tpl_index jmax)
+{
+    _tpl_index n0 = n - n%CHUNK;
+    for (_tpl_index i = 0; i < n0; i += CHUNK) {
+        _tpl_float acc[GROUP][CHUNK];
+        for (int k = 0; k < nk; ++k) {
+            for (int c = 0; c < CHUNK; ++c) {
+                acc[k][c] = 0;
+            }
+        }
+        for (_tpl_index j = 0; j < m; ++j) {
+            _tpl_float const* s = row(j) + i;
+            for (int k = 0; k < nk; ++k) {
+                _tpl_float w = ker[k*m + j];
+                for (int c = 0; c < CHUNK; ++c) {
+                    acc[k][c] += w*s[c];
+                }
+            }
+        }
+        for (int k = 0; k < nk; ++k) {
+            for (int c = 0; c < CHUNK; ++c) {
+                dst[k*inc + i + c] = acc[k][c];
+            }
+        }
+    }
+    for (_tpl_index i = n0; i < n; ++i) {
+        for (int k = 0; k < nk; ++k) {
+            _tpl_float s = 0;
+            for (_tpl_index j = 0; j < m; ++j) {
+                s += ker[k*m + j]*row(j)[i];
+            }
+            dst[k*inc + i] = s;
+        }
+    }
+}
+
+/*
+ * Apply `nk` kernels by groups of at most `GROUP`.
+ */
+static void
+_tpl_private(bank)(_tpl_index nk,
+                   _tpl_index m,
+                   _tpl_index n,
+                   _tpl_float*restrict dst,
+                   _tpl_index inc,
+                   _tpl_float const*restrict ker,
+                   _tpl_float const* src,
+                   _tpl_index ld,
+                   _tpl_index j0,
+                   _tpl_index jmax)
+{
+    for (_tpl_index k = 0; k < nk; k += GROUP) {
+        _tpl_float* d = dst + k*inc;
+        _tpl_float const* w = ker + k*m;
+        switch (pvc_min(nk - k, GROUP)) {
+        case 1:
+            _tpl_private(bank_rows)(1, m, n, d, inc, w,
+                                    src, ld, j0, jmax);
+            break;
+        case 2:
+            _tpl_private(bank_rows)(2, m, n, d, inc, w,
+                                    src, ld, j0, jmax);
+            break;
+        case 3:
+            _tpl_private(bank_rows)(3, m, n, d, inc, w,
+                                    src, ld, j0, jmax);
+            break;
+        default:
+            _tpl_private(bank_rows)(4, m, n, d, inc, w,
+                                    src, ld, j0, jmax);
+        }
+    }
+}
+
+void
+_tpl_public(filter_bank)(_tpl_index nk,
+                         _tpl_index m,
+                         _tpl_index n,
+                         _tpl_float*restrict dst,
+                         _tpl_float const*restrict ker,
+                         _tpl_float const*restrict src)
+{
+    if (nk < 1 || m < 1 || n < 1) {
+        return;
+    }
+    TPL_STATS_BEGIN;
+    _tpl_private(bank)(nk, m, n, dst, n, ker, src, 1, 0, m - 1);
+    TPL_STATS_END(TPL_STATS_FILTER_BANK, nk*n);
+}
+
+void
+_tpl_public(filter_bank_2d)(int dim,
+                            _tpl_index nk,
+                            _tpl_float*restrict dst,
+                            _tpl_index dst_len1,
+                            _tpl_index dst_len2,
+                            _tpl_float const*restrict ker,
+                            _tpl_index ker_len,
+                            _tpl_float const*restrict src,
+                            _tpl_index src_len1,
+                            _tpl_index src_len2,
+                            _tpl_index k1,
+                            _tpl_index k2,
+                            _tpl_float*restrict wrk)
+{
+    if (nk < 1 || ker_len < 1 || dst_len1 < 1 || dst_len2 < 1) {
+        return;
+    }
+    TPL_STATS_BEGIN;
+    _tpl_index npix = dst_len1*dst_len2;
+    if (dim == 1) {
+        _tpl_index wrk_len = dst_len1 + ker_len - 1;
+        for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+            _tpl_index src_i2 = pvc_min(pvc_max(dst_i2 + k2, 0),
+                                        src_len2 - 1);
+            tpl_load_contiguous_flat(wrk_len, wrk,
+                                     src_len1, &src(0, src_i2), k1);
+            _tpl_private(bank)(nk, ker_len, dst_len1, &dst(0, dst_i2), npix,
+                               ker, wrk, 1, 0, ker_len - 1);
+        }
+    } else {
+        /* Combine whole rows restricted to the source columns `s0:s1`
+           needed by the destination.  Results are directly written in the
+           destination when no columns are out of bounds. */
+        _tpl_index s0 = pvc_min(pvc_max(k1, 0), src_len1 - 1);
+        _tpl_index s1 = pvc_min(pvc_max(dst_len1 - 1 + k1, 0), src_len1 - 1);
+        _tpl_index ncols = s1 - s0 + 1;
+        int direct = (k1 >= 0 && k1 + dst_len1 <= src_len1);
+        for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+            _tpl_index j0 = dst_i2 + k2;
+            if (direct) {
+                _tpl_private(bank)(nk, ker_len, ncols, &dst(0, dst_i2), npix,
+                                   ker, &src(s0, 0), src_len1, j0,
+                                   src_len2 - 1);
+            } else {
+                _tpl_private(bank)(nk, ker_len, ncols, wrk, ncols,
+                                   ker, &src(s0, 0), src_len1, j0,
+                                   src_len2 - 1);
+                for (_tpl_index k = 0; k < nk; ++k) {
+                    tpl_load_contiguous_flat(dst_len1, &dst(0, dst_i2) + k*npix,
+                                             ncols, wrk + k*ncols, k1 - s0);
+                }
+            }
+        }
+    }
+    TPL_STATS_END(TPL_STATS_FILTER_BANK_2D, nk*dst_len1*dst_len2);
+}
+
+#undef row
+#undef _tpl_float
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_BANK_C */
@@ -0,0 +1,628 @@
+/*
+ * bench.c -
+ *
+ * Benchmarking filter and interpolation kernels of TPL library.
+ *
+ * Usage:
+ *
+ *     bench [-w WARMUP] [-r REPEAT] [-s MAXSIZE] [-t SECONDS] > bench.json
+ *
+ * Each kernel is run for sizes (number of destination elements) from 1024 up
+ * to MAXSIZE in steps of a factor 4, that is from L1-resident to DRAM-bound
+ * data with the default settings.  For each size, WARMUP untimed samples are
+ * followed by REPEAT timed samples, each sample repeating the call enough
+ * times to last at least SECONDS.  Results are printed in JSON on the
+ * standard output and as a table on the standard error.  GFLOP/s and GB/s
+ * are computed from the median time with nominal operation counts (`2*m`
+ * per element for a filter of size `m`) and the minimal memory traffic (each
+ * source and destination element read or written once).
+ *
+ * With option `-p` and on Linux, hardware counters (cycles, instructions,
+ * L1 data cache and last level cache misses) are read with perf_event_open()
+ * around the timed samples and the IPC and the numbers of misses per element
+ * are reported.  There is no portable event for vector instructions, option
+ * `-e CODE` adds a raw, CPU-specific, event (e.g. `-e 0x10c7` for
+ * FP_ARITH_INST_RETIRED.SCALAR_DOUBLE on recent Intel cores) reported as
+ * events per element.  Counters that cannot be opened (unsupported events,
+ * restrictive `perf_event_paranoid`, containers, etc.) are reported as
+ * `null`, the timings are not affected.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#ifndef _TPL_BENCH_C
+#define _TPL_BENCH_C 1
+
+#include <stdlib.h> /* for EXIT_SUCCESS, etc. */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pvc.h>
+#ifdef __linux__
+#  include <unistd.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
+#endif
+#include "tpl-filter.h"
+#include "tpl-image.h"
+#include "tpl-interp.h"
+
+#define MIN_SIZE  1024L
+
+/* Hardware counters. */
+enum {
+    CNT_CYCLES = 0,
+    CNT_INSTRUCTIONS,
+    CNT_L1D_MISSES,
+    CNT_LLC_MISSES,
+    CNT_RAW,
+    NCOUNTERS
+};
+
+static char const* const counter_names[NCOUNTERS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "raw"
+};
+
+typedef struct {
+    int    fd[NCOUNTERS];     /* file descriptors, -1 if unavailable */
+    double value[NCOUNTERS];  /* last measured values, < 0 if unavailable */
+} Counters;
+
+/* Benchmark settings. */
+typedef struct {
+    int    warmup;   /* number of untimed samples */
+    int    repeat;   /* number of timed samples */
+    long   max_size; /* maximum number of elements */
+    double min_time; /* minimum duration of a sample (seconds) */
+    long   count;    /* number of results printed so far */
+    Counters* cnt;   /* hardware counters, `NULL` if not used */
+} Settings;
+
+/* Arguments of a benchmarked call. */
+typedef struct {
+    void*  dst;
+    void*  src;
+    void*  ker;
+    void*  wrk1;
+    void*  wrk2;
+    int    dim;
+    long   m;
+    long   n;
+    long   len1;
+    long   len2;
+    TPL_CardinalCubicSpline const* phi;
+} Call;
+
+static double
+elapsed_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
+
+static int
+compare_doubles(void const* a, void const* b)
+{
+    double x = *(double const*)a, y = *(double const*)b;
+    return (x < y ? -1 : x > y ? 1 : 0);
+}
+
+#ifdef __linux__
+static int
+open_counter(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = (PERF_FORMAT_TOTAL_TIME_ENABLED |
+                        PERF_FORMAT_TOTAL_TIME_RUNNING);
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/*
+ * Open the hardware counters.  Counters are opened independently (not as a
+ * group) so that the available ones can be used when others are not.
+ * Returns the number of available counters.
+ */
+static int
+open_counters(Counters* cnt, long raw)
+{
+    int navail = 0;
+    for (int k = 0; k < NCOUNTERS; ++k) {
+        cnt->fd[k] = -1;
+        cnt->value[k] = -1;
+    }
+#ifdef __linux__
+    uint64_t l1d_miss = (PERF_COUNT_HW_CACHE_L1D |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    cnt->fd[CNT_CYCLES] = open_counter(PERF_TYPE_HARDWARE,
+                                       PERF_COUNT_HW_CPU_CYCLES);
+    cnt->fd[CNT_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE,
+                                             PERF_COUNT_HW_INSTRUCTIONS);
+    cnt->fd[CNT_L1D_MISSES] = open_counter(PERF_TYPE_HW_CACHE, l1d_miss);
+    cnt->fd[CNT_LLC_MISSES] = open_counter(PERF_TYPE_HARDWARE,
+                                           PERF_COUNT_HW_CACHE_MISSES);
+    if (raw > 0) {
+        cnt->fd[CNT_RAW] = open_counter(PERF_TYPE_RAW, raw);
+    }
+    for (int k = 0; k < NCOUNTERS; ++k) {
+        if (cnt->fd[k] >= 0) {
+            ++navail;
+        } else {
+            cnt->fd[k] = -1;
+        }
+    }
+#endif
+    return navail;
+}
+
+static void
+start_counters(Counters* cnt)
+{
+#ifdef __linux__
+    for (int k = 0; k < NCOUNTERS; ++k) {
+        if (cnt->fd[k] >= 0) {
+            ioctl(cnt->fd[k], PERF_EVENT_IOC_RESET, 0);
+            ioctl(cnt->fd[k], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+/* Stop the counters and store their values scaled for multiplexing. */
+static void
+stop_counters(Counters* cnt)
+{
+    for (int k = 0; k < NCOUNTERS; ++k) {
+        cnt->value[k] = -1;
+    }
+#ifdef __linux__
+    for (int k = 0; k < NCOUNTERS; ++k) {
+        if (cnt->fd[k] >= 0) {
+            ioctl(cnt->fd[k], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int k = 0; k < NCOUNTERS; ++k) {
+        uint64_t buf[3]; /* value, time enabled, time running */
+        if (cnt->fd[k] >= 0 &&
+            read(cnt->fd[k], buf, sizeof(buf)) == sizeof(buf) &&
+            buf[2] > 0) {
+            cnt->value[k] = (double)buf[0]*((double)buf[1]/(double)buf[2]);
+        }
+    }
+#endif
+}
+
+static void
+close_counters(Counters* cnt)
+{
+#ifdef __linux__
+    for (int k = 0; k < NCOUNTERS; ++k) {
+        if (cnt->fd[k] >= 0) {
+            close(cnt->fd[k]);
+            cnt->fd[k] = -1;
+        }
+    }
+#endif
+}
+
+/* Print a JSON number or null. */
+static void
+print_number(char const* key, double val)
+{
+    if (val >= 0) {
+        printf("\"%s\": %.4g", key, val);
+    } else {
+        printf("\"%s\": null", key);
+    }
+}
+
+/*
+ * Time `run(call)` and print the statistics.  `nelem` is the number of
+ * elements, `flops` and `bytes` are the number of operations and of bytes
+ * transferred by a single call (`flops` may be 0 if unknown).
+ */
+static void
+measure(Settings* cfg, char const* name, char const* type,
+        void (*run)(Call const*), Call const* call,
+        long nelem, double flops, double bytes)
+{
+    /* Calibrate the number of calls per sample. */
+    long iters = 1;
+    while (1) {
+        double t0 = elapsed_seconds();
+        for (long k = 0; k < iters; ++k) {
+            run(call);
+        }
+        double t = elapsed_seconds() - t0;
+        if (t >= cfg->min_time || iters >= (1L << 30)) {
+            break;
+        }
+        iters *= (t > 0 ? pvc_max(2, pvc_min(100, (long)(cfg->min_time/t) + 1))
+                  : 100);
+    }
+    for (int j = 0; j < cfg->warmup; ++j) {
+        for (long k = 0; k < iters; ++k) {
+            run(call);
+        }
+    }
+    int nsamples = pvc_max(cfg->repeat, 1);
+    double smp[nsamples];
+    if (cfg->cnt != NULL) {
+        start_counters(cfg->cnt);
+    }
+    for (int j = 0; j < nsamples; ++j) {
+        double t0 = elapsed_seconds();
+        for (long k = 0; k < iters; ++k) {
+            run(call);
+        }
+        smp[j] = (elapsed_seconds() - t0)/iters;
+    }
+    if (cfg->cnt != NULL) {
+        stop_counters(cfg->cnt);
+    }
+
+    /* Statistics of time per call. */
+    qsort(smp, nsamples, sizeof(smp[0]), compare_doubles);
+    double mean = 0.0, var = 0.0;
+    for (int j = 0; j < nsamples; ++j) {
+        mean += smp[j];
+    }
+    mean /= nsamples;
+    for (int j = 0; j < nsamples; ++j) {
+        var += (smp[j] - mean)*(smp[j] - mean);
+    }
+    var = (nsamples > 1 ? var/(nsamples - 1) : 0.0);
+    double med = (nsamples%2 == 1 ? smp[nsamples/2] :
+                  (smp[nsamples/2 - 1] + smp[nsamples/2])/2);
+    double scl = 1e9/nelem; /* seconds per call to ns per element */
+
+    printf("%s\n    {\"name\": \"%s\", \"type\": \"%s\", "
+           "\"dim\": %d, \"ker_len\": %ld, \"size\": %ld, "
+           "\"iterations\": %ld, \"samples\": %d,\n"
+           "     \"ns_per_elem\": {\"min\": %.4g, \"median\": %.4g, "
+           "\"mean\": %.4g, \"max\": %.4g, \"stddev\": %.4g},\n",
+           (cfg->count > 0 ? "," : ""), name, type, call->dim, call->m,
+           nelem, iters, nsamples, scl*smp[0], scl*med, scl*mean,
+           scl*smp[nsamples - 1], scl*sqrt(var));
+    if (flops > 0) {
+        printf("     \"gflops\": %.4g, ", 1e-9*flops/med);
+    } else {
+        printf("     \"gflops\": null, ");
+    }
+    printf("\"gbytes_per_sec\": %.4g", 1e-9*bytes/med);
+    if (cfg->cnt != NULL) {
+        /* Counts per element over all timed samples. */
+        double const* v = cfg->cnt->value;
+        double nrm = (double)nsamples*(double)iters*(double)nelem;
+        printf(",\n     \"counters\": {");
+        print_number("ipc", (v[CNT_CYCLES] > 0 && v[CNT_INSTRUCTIONS] >= 0 ?
+                             v[CNT_INSTRUCTIONS]/v[CNT_CYCLES] : -1));
+        for (int k = 0; k < NCOUNTERS; ++k) {
+            char key[64];
+            sprintf(key, "%s_per_elem", counter_names[k]);
+            printf(", ");
+            print_number(key, (v[k] >= 0 ? v[k]/nrm : -1));
+        }
+        printf("}");
+    }
+    printf("}");
+    fflush(stdout);
+    cfg->count += 1;
+
+    fprintf(stderr, "%-38s %-6s %d %2ld %9ld %10.4g %10.4g %10.4g\n",
+            name, type, call->dim, call->m, nelem, scl*med,
+            1e-9*flops/med, 1e-9*bytes/med);
+}
+
+static void
+run_func_wgts(Call const* c)
+{
+    double const* t = c->src;
+    double* w = c->dst;
+    for (long i = 0; i < c->n; ++i) {
+        TPL_INTERP_FUNC_WGTS(c->phi, t[i], w + 4*i);
+    }
+}
+
+static void
+run_deriv_wgts(Call const* c)
+{
+    double const* t = c->src;
+    double* w = c->dst;
+    for (long i = 0; i < c->n; ++i) {
+        TPL_INTERP_DERIV_WGTS(c->phi, t[i], w + 4*i);
+    }
+}
+
+static void
+run_func_deriv_wgts(Call const* c)
+{
+    double const* t = c->src;
+    double* w = c->dst;
+    double* d = w + 4*c->n;
+    for (long i = 0; i < c->n; ++i) {
+        TPL_INTERP_FUNC_DERIV_WGTS(c->phi, t[i], w + 4*i, d + 4*i);
+    }
+}
+
+/* Benchmark the cardinal cubic spline weights. */
+static int
+sweep_spline(Settings* cfg)
+{
+    long max_size = cfg->max_size;
+    double* t = malloc(max_size*sizeof(double));
+    double* w = malloc(8*max_size*sizeof(double));
+    if (t == NULL || w == NULL) {
+        free(t);
+        free(w);
+        return -1;
+    }
+    for (long i = 0; i < max_size; ++i) {
+        t[i] = (double)rand()/RAND_MAX;
+    }
+    memset(w, 0, 8*max_size*sizeof(double));
+    TPL_CardinalCubicSpline phi;
+    tpl_initialize_cardinal_cubic_spline(&phi, 0.0);
+    Call c = {.dst = w, .src = t, .phi = &phi, .m = 4};
+    for (long n = MIN_SIZE; n <= max_size; n *= 4) {
+        /* Nominal operation counts from interp.c. */
+        c.n = n;
+        measure(cfg, "cardinal_cubic_spline_func_wgts", "double",
+                run_func_wgts, &c, n, 13.0*n, 40.0*n);
+        measure(cfg, "cardinal_cubic_spline_deriv_wgts", "double",
+                run_deriv_wgts, &c, n, 13.0*n, 40.0*n);
+        measure(cfg, "cardinal_cubic_spline_func_deriv_wgts", "double",
+                run_func_deriv_wgts, &c, n, 25.0*n, 72.0*n);
+    }
+    free(t);
+    free(w);
+    return 0;
+}
+
+#define _tpl_float          float
+#define _tpl_type           "float"
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_type           "double"
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+int main(int argc, char* argv[])
+{
+    Settings cfg = {
+        .warmup = 2,
+        .repeat = 7,
+        .max_size = 1L << 22,
+        .min_time = 2e-3,
+        .count = 0,
+        .cnt = NULL
+    };
+    Counters cnt;
+    int use_counters = 0;
+    long raw = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && strcmp(argv[i], "-w") == 0) {
+            cfg.warmup = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            cfg.repeat = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            cfg.max_size = atol(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+            cfg.min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0) {
+            use_counters = 1;
+        } else if (i + 1 < argc && strcmp(argv[i], "-e") == 0) {
+            use_counters = 1;
+            raw = strtol(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-w WARMUP] [-r REPEAT] [-s MAXSIZE] "
+                    "[-t SECONDS] [-p] [-e CODE]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    cfg.max_size = pvc_max(cfg.max_size, MIN_SIZE);
+    if (use_counters) {
+        if (open_counters(&cnt, raw) > 0) {
+            cfg.cnt = &cnt;
+        } else {
+            fprintf(stderr, "hardware counters unavailable, "
+                    "reporting timings only\n");
+        }
+    }
+
+    printf("{\"library\": \"TPL\",\n");
+#ifdef USE_VCL
+    printf(" \"use_vcl\": %d,\n", USE_VCL ? 1 : 0);
+#endif
+    printf(" \"timer\": \"clock_gettime(CLOCK_MONOTONIC)\",\n");
+    printf(" \"warmup\": %d, \"repeat\": %d, \"min_time\": %g,\n",
+           cfg.warmup, cfg.repeat, cfg.min_time);
+    printf(" \"counters\": %s,\n", (cfg.cnt != NULL ? "true" : "false"));
+    printf(" \"results\": [");
+    fprintf(stderr, "%-38s %-6s %s %2s %9s %10s %10s %10s\n",
+            "# name", "type", "d", "m", "size", "ns/elem", "GFLOP/s", "GB/s");
+
+    int status = EXIT_SUCCESS;
+    if (sweep_filters_f(&cfg) != 0 || sweep_filters_d(&cfg) != 0 ||
+        sweep_spline(&cfg) != 0) {
+        fprintf(stderr, "insufficient memory\n");
+        status = EXIT_FAILURE;
+    }
+    printf("\n ]\n}\n");
+    if (cfg.cnt != NULL) {
+        close_counters(cfg.cnt);
+    }
+    return status;
+}
+
+#else /* _TPL_BENCH_C defined */
+
+static void
+_tpl_private(run_x1)(Call const* c)
+{
+    _tpl_public(filter_x1)(c->n, c->dst, c->ker, c->src);
+}
+
+static void
+_tpl_private(run_x2)(Call const* c)
+{
+    _tpl_public(filter_x2)(c->n, c->dst, c->ker, c->src);
+}
+
+static void
+_tpl_private(run_x3)(Call const* c)
+{
+    _tpl_public(filter_x3)(c->n, c->dst, c->ker, c->src);
+}
+
+static void
+_tpl_private(run_x4)(Call const* c)
+{
+    _tpl_public(filter_x4)(c->n, c->dst, c->ker, c->src);
+}
+
+static void
+_tpl_private(run_x5)(Call const* c)
+{
+    _tpl_public(filter_x5)(c->n, c->dst, c->ker, c->src);
+}
+
+static void
+_tpl_private(run_x5_nt)(Call const* c)
+{
+    _tpl_public(filter_x5_nt)(c->n, c->dst, c->ker, c->src);
+}
+
+static void
+_tpl_private(run_ref)(Call const* c)
+{
+    _tpl_public(filter_ref)(c->m, c->n, c->dst, c->ker, c->src);
+}
+
+static void
+_tpl_private(run_2d_ref)(Call const* c)
+{
+    _tpl_public(filter_2d_ref)(c->dim, c->dst, c->len1, c->len2,
+                               c->ker, c->m, c->src, c->len1, c->len2,
+                               -(c->m/2), -(c->m/2), c->wrk1, c->wrk2);
+}
+
+/* Optimized separable filter, the large-image mode is selected by the
+   streaming threshold. */
+static void
+_tpl_private(run_2d)(Call const* c)
+{
+    _tpl_public(filter_2d)(c->dim, c->dst, c->len1, c->len2,
+                           c->ker, c->m, c->src, c->len1, c->len2,
+                           -(c->m/2), -(c->m/2), c->wrk1, c->wrk2);
+}
+
+/* Benchmark the filters for a given floating-point type. */
+static int
+_tpl_private(sweep_filters)(Settings* cfg)
+{
+    static void (*const run_xn[])(Call const*) = {
+        _tpl_private(run_x1), _tpl_private(run_x2), _tpl_private(run_x3),
+        _tpl_private(run_x4), _tpl_private(run_x5)
+    };
+    static char const* const name_xn[] = {
+        "tpl_filter_x1", "tpl_filter_x2", "tpl_filter_x3",
+        "tpl_filter_x4", "tpl_filter_x5"
+    };
+    long ref_len = 7; /* filter size for the reference versions */
+    long max_size = cfg->max_size;
+    long max_len = (long)sqrt((double)max_size) + ref_len;
+    _tpl_float ker[ref_len];
+    _tpl_float* src = malloc((max_size + ref_len)*sizeof(_tpl_float));
+    _tpl_float* dst = malloc(max_size*sizeof(_tpl_float));
+    _tpl_float* wrk1 = malloc((max_len + ref_len)*sizeof(_tpl_float));
+    _tpl_float* wrk2 = malloc(max_len*sizeof(_tpl_float));
+    if (src == NULL || dst == NULL || wrk1 == NULL || wrk2 == NULL) {
+        free(src);
+        free(dst);
+        free(wrk1);
+        free(wrk2);
+        return -1;
+    }
+    for (long i = 0; i < max_size + ref_len; ++i) {
+        src[i] = (_tpl_float)rand()/RAND_MAX - (_tpl_float)0.5;
+    }
+    memset(dst, 0, max_size*sizeof(_tpl_float));
+    for (long k = 0; k < ref_len; ++k) {
+        ker[k] = (_tpl_float)1/(k + 1);
+    }
+
+    double size = sizeof(_tpl_float);
+    Call c = {.dst = dst, .src = src, .ker = ker, .wrk1 = wrk1, .wrk2 = wrk2};
+    for (long n = MIN_SIZE; n <= max_size; n *= 4) {
+        c.n = n;
+        c.dim = 0;
+        for (long m = 1; m <= 5; ++m) {
+            c.m = m;
+            measure(cfg, name_xn[m-1], _tpl_type, run_xn[m-1], &c,
+                    n, 2.0*m*n, size*(2*n + m - 1));
+        }
+        measure(cfg, "tpl_filter_x5_nt", _tpl_type, _tpl_private(run_x5_nt),
+                &c, n, 10.0*n, size*(2*n + 4));
+        c.m = ref_len;
+        measure(cfg, "tpl_filter_ref", _tpl_type, _tpl_private(run_ref), &c,
+                n, 2.0*ref_len*n, size*(2*n + ref_len - 1));
+
+        /* Square images with about `n` pixels. */
+        c.len1 = c.len2 = (long)sqrt((double)n);
+        long npix = c.len1*c.len2;
+        for (int dim = 1; dim <= 2; ++dim) {
+            c.dim = dim;
+            measure(cfg, "tpl_filter_2d_ref", _tpl_type,
+                    _tpl_private(run_2d_ref), &c,
+                    npix, 2.0*ref_len*npix, size*2*npix);
+        }
+        size_t threshold = tpl_get_streaming_threshold();
+        c.m = 5;
+        for (int dim = 1; dim <= 2; ++dim) {
+            c.dim = dim;
+            tpl_set_streaming_threshold(SIZE_MAX);
+            measure(cfg, "tpl_filter_2d", _tpl_type,
+                    _tpl_private(run_2d), &c,
+                    npix, 10.0*npix, size*2*npix);
+            tpl_set_streaming_threshold(0);
+            measure(cfg, "tpl_filter_2d_streaming", _tpl_type,
+                    _tpl_private(run_2d), &c,
+                    npix, 10.0*npix, size*2*npix);
+        }
+        tpl_set_streaming_threshold(threshold);
+    }
+    free(src);
+    free(dst);
+    free(wrk1);
+    free(wrk2);
+    return 0;
+}
+
+#undef _tpl_float
+#undef _tpl_type
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_BENCH_C */
@@ -0,0 +1,174 @@
+/*
+ * box.c -
+ *
+ * Implementation of box (moving average) filters by running sums.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_BOX_C
+#define _TPL_BOX_C 1
+
+#include "tpl-filter.h"
+#include "tpl-image.h"
+#include "tpl-inline.h"
+
+#define _tpl_index       long
+
+/* Assume column-major storage order. */
+#define dst(i1,i2)       dst[(i1) + dst_len1*(i2)]
+#define src(i1,i2)       src[(i1) + src_len1*(i2)]
+
+/*
+ * Running sums are recomputed from scratch every `max(m,RESYNC)` outputs to
+ * bound the accumulation of rounding errors.  This costs at most one more
+ * addition per output.
+ */
+#define RESYNC 1024
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_BOX_C defined */
+
+void
+_tpl_public(box_filter)(_tpl_index m,
+                        _tpl_index n,
+                        _tpl_float*restrict dst,
+                        _tpl_float const*restrict src)
+{
+    if (m < 1) {
+        return;
+    }
+    const _tpl_float scl = (_tpl_float)1/(_tpl_float)m;
+    const _tpl_index r = pvc_max(m, RESYNC);
+    for (_tpl_index i0 = 0; i0 < n; i0 += r) {
+        _tpl_index i1 = pvc_min(i0 + r, n);
+        _tpl_float s = 0;
+        for (_tpl_index k = 0; k < m; ++k) {
+            s += src[i0 + k];
+        }
+        dst[i0] = s*scl;
+        for (_tpl_index i = i0 + 1; i < i1; ++i) {
+            s += src[i + m - 1] - src[i - 1];
+            dst[i] = s*scl;
+        }
+    }
+}
+
+/*
+ * Store a row of results `acc` computed for source columns `s0` to `s1`
+ * (inclusive) into a row of the destination of length `n` with offset `k`.
+ */
+static inline void
+_tpl_private(box_store_row)(_tpl_index n,
+                            _tpl_float*restrict dst,
+                            _tpl_float const*restrict acc,
+                            _tpl_float scl,
+                            _tpl_index s0,
+                            _tpl_index s1,
+                            _tpl_index k)
+{
+    _tpl_index i = 0;
+    for (; i < n && i + k < s0; ++i) {
+        dst[i] = scl*acc[0];
+    }
+    _tpl_index imax = pvc_min(n, s1 - k + 1);
+    _tpl_float const* a = acc + (k - s0);
+    for (; i < imax; ++i) {
+        dst[i] = scl*a[i];
+    }
+    for (; i < n; ++i) {
+        dst[i] = scl*acc[s1 - s0];
+    }
+}
+
+void
+_tpl_public(box_filter_2d)(int dim,
+                           _tpl_float*restrict dst,
+                           _tpl_index dst_len1,
+                           _tpl_index dst_len2,
+                           _tpl_index box_len,
+                           _tpl_float const*restrict src,
+                           _tpl_index src_len1,
+                           _tpl_index src_len2,
+                           _tpl_index k1,
+                           _tpl_index k2,
+                           _tpl_float*restrict wrk)
+{
+    if (box_len < 1 || dst_len1 < 1 || dst_len2 < 1) {
+        return;
+    }
+    if (dim == 1) {
+        _tpl_index wrk_len = dst_len1 + box_len - 1;
+        _tpl_index src_i2_prev = -1;
+        for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+            _tpl_index src_i2 = pvc_min(pvc_max(dst_i2 + k2, 0),
+                                        src_len2 - 1);
+            if (src_i2 == src_i2_prev) {
+                // Just copy previous result.
+                tpl_copy_contiguous(dst_len1, &dst(0, dst_i2),
+                                    &dst(0, dst_i2 - 1));
+            } else {
+                tpl_load_contiguous_flat(wrk_len, wrk,
+                                         src_len1, &src(0, src_i2), k1);
+                _tpl_public(box_filter)(box_len, dst_len1,
+                                        &dst(0, dst_i2), wrk);
+                src_i2_prev = src_i2;
+            }
+        }
+    } else {
+        /* Running sums of whole rows restricted to the source columns
+           `s0:s1` needed by the destination. */
+        const _tpl_float scl = (_tpl_float)1/(_tpl_float)box_len;
+        const _tpl_index r = pvc_max(box_len, RESYNC);
+        _tpl_index s0 = pvc_min(pvc_max(k1, 0), src_len1 - 1);
+        _tpl_index s1 = pvc_min(pvc_max(dst_len1 - 1 + k1, 0), src_len1 - 1);
+        _tpl_index ncols = s1 - s0 + 1;
+        _tpl_float* acc = wrk;
+#define ROW(j) (&src(s0, pvc_min(pvc_max(j, 0), src_len2 - 1)))
+        for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+            _tpl_index j = dst_i2 + k2;
+            if (dst_i2 % r == 0) {
+                _tpl_float const* row = ROW(j);
+                for (_tpl_index i = 0; i < ncols; ++i) {
+                    acc[i] = row[i];
+                }
+                for (_tpl_index k = 1; k < box_len; ++k) {
+                    row = ROW(j + k);
+                    for (_tpl_index i = 0; i < ncols; ++i) {
+                        acc[i] += row[i];
+                    }
+                }
+            } else {
+                _tpl_float const* add = ROW(j + box_len - 1);
+                _tpl_float const* sub = ROW(j - 1);
+                if (add != sub) {
+                    for (_tpl_index i = 0; i < ncols; ++i) {
+                        acc[i] += add[i] - sub[i];
+                    }
+                }
+            }
+            _tpl_private(box_store_row)(dst_len1, &dst(0, dst_i2), acc,
+                                        scl, s0, s1, k1);
+        }
+#undef ROW
+    }
+}
+
+#undef _tpl_float
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_BOX_C */
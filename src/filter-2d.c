@@ -13,8 +13,13 @@
 #ifndef _TPL_FILTER_2D_C
 #define _TPL_FILTER_2D_C 1
 
+#include <stddef.h>
+
+#include "tpl-filter.h"
 #include "tpl-image.h"
 #include "tpl-inline.h"
+#include "tpl-pool.h"
+#include "tpl-stats.h"
 
 #define _tpl_index       long
 
@@ -22,6 +27,12 @@
 #define dst(i1,i2)       dst[(i1) + dst_len1*(i2)]
 #define src(i1,i2)       src[(i1) + src_len1*(i2)]
 
+/* Number of strided source values prefetched ahead in large-image mode, a
+   few hundred nanoseconds of memory latency. */
+#ifndef PREFETCH_DISTANCE
+#  define PREFETCH_DISTANCE 16
+#endif
+
 #define _tpl_float          float
 #define _tpl_suffix         f
 #define _tpl_public(name)   tpl_##name##_f
@@ -54,7 +65,7 @@ _tpl_private(filter_ref)(_tpl_index m,
 {
     for (_tpl_index i = 0; i < n; ++i) {
         _tpl_float s = 0;
-        for (_tpl_index k = 0; i < m; ++k) {
+        for (_tpl_index k = 0; k < m; ++k) {
             s += ker[k]*src[i+k];
         }
         dst[i] = s;
@@ -76,6 +87,7 @@ _tpl_public(filter_2d_ref)(int dim,
                            _tpl_float*restrict wrk,
                            _tpl_float*restrict tmp)
 {
+    TPL_STATS_BEGIN;
     if (dim == 1) {
         _tpl_index wrk_len = dst_len1 + ker_len - 1;
         _tpl_index src_i2_prev = -1;
@@ -125,6 +137,487 @@ _tpl_public(filter_2d_ref)(int dim,
             }
         }
     }
+    TPL_STATS_END(TPL_STATS_FILTER_2D_REF, dst_len1*dst_len2);
+}
+
+/*
+ * Optimized filter along a dimension of an image.  If `off` is not `NULL`,
+ * the affine calibration `(src - off)*scl` is applied while loading the
+ * source.  If `mom` is not `NULL`, the moments of the result are accumulated
+ * line by line while the lines are in cache.  Otherwise, if the destination
+ * exceeds the streaming threshold (see tpl_set_streaming_threshold()), rows
+ * are written with non-temporal stores and columns are loaded with software
+ * prefetching.
+ */
+static void
+_tpl_private(filter_2d_lines)(int dim,
+                              _tpl_float*restrict dst,
+                              _tpl_index dst_len1,
+                              _tpl_index dst_len2,
+                              _tpl_float const*restrict ker,
+                              _tpl_index ker_len,
+                              _tpl_float const*restrict src,
+                              _tpl_float const*restrict off,
+                              _tpl_float const*restrict scl,
+                              _tpl_index src_len1,
+                              _tpl_index src_len2,
+                              _tpl_index k1,
+                              _tpl_index k2,
+                              _tpl_float*restrict wrk,
+                              _tpl_float*restrict tmp,
+                              TPL_Moments* mom)
+{
+#define off(i1,i2)       off[(i1) + src_len1*(i2)]
+#define scl(i1,i2)       scl[(i1) + src_len1*(i2)]
+    if (ker_len < 1 || dst_len1 < 1 || dst_len2 < 1) {
+        return;
+    }
+    int large = (mom == NULL && (size_t)(dst_len1*dst_len2)*sizeof(_tpl_float)
+                 >= tpl_get_streaming_threshold());
+    if (dim == 1) {
+        _tpl_index wrk_len = dst_len1 + ker_len - 1;
+        _tpl_index src_i2_prev = -1;
+        for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+            _tpl_index src_i2 = pvc_min(pvc_max(dst_i2 + k2, 0),
+                                        src_len2 - 1);
+            if (src_i2 == src_i2_prev) {
+                // Just copy previous result.
+                tpl_copy_contiguous(dst_len1, &dst(0, dst_i2),
+                                    &dst(0, dst_i2 - 1));
+            } else {
+                if (off == NULL) {
+                    tpl_load_contiguous_flat(wrk_len, wrk,
+                                             src_len1, &src(0, src_i2), k1);
+                } else {
+                    tpl_load_contiguous_flat_calib(wrk_len, wrk,
+                                                   src_len1, &src(0, src_i2),
+                                                   k1, &off(0, src_i2),
+                                                   &scl(0, src_i2));
+                }
+                if (large) {
+                    tpl_filter_nt(ker_len, dst_len1, &dst(0, dst_i2),
+                                  ker, wrk);
+                } else {
+                    tpl_filter(ker_len, dst_len1, &dst(0, dst_i2), ker, wrk);
+                }
+                src_i2_prev = src_i2;
+            }
+            if (mom != NULL) {
+                tpl_update_moments(mom, dst_len1, &dst(0, dst_i2),
+                                   1, 0, dst_i2);
+            }
+        }
+    } else {
+        _tpl_index wrk_len = dst_len2 + ker_len - 1;
+        _tpl_index src_i1_prev = -1;
+        for (_tpl_index dst_i1 = 0; dst_i1 < dst_len1; ++dst_i1) {
+            _tpl_index src_i1 = pvc_min(pvc_max(dst_i1 + k1, 0),
+                                        src_len1 - 1);
+            if (src_i1 == src_i1_prev) {
+                // Just copy previous result.
+                tpl_copy_strided(dst_len2, dst_len1,
+                                 &dst(dst_i1, 0),
+                                 &dst(dst_i1 - 1, 0));
+            } else {
+                if (off == NULL && large) {
+                    tpl_load_strided_flat_prefetch(wrk_len, wrk,
+                                                   src_len2, &src(src_i1, 0),
+                                                   k2, src_len1,
+                                                   PREFETCH_DISTANCE);
+                } else if (off == NULL) {
+                    tpl_load_strided_flat(wrk_len, wrk,
+                                          src_len2, &src(src_i1, 0),
+                                          k2, src_len1);
+                } else {
+                    tpl_load_strided_flat_calib(wrk_len, wrk,
+                                                src_len2, &src(src_i1, 0),
+                                                k2, src_len1,
+                                                &off(src_i1, 0),
+                                                &scl(src_i1, 0));
+                }
+                tpl_filter(ker_len, dst_len2, tmp, ker, wrk);
+                tpl_store_strided(dst_len2, &dst(dst_i1, 0), dst_len1, tmp);
+                src_i1_prev = src_i1;
+            }
+            if (mom != NULL) {
+                /* The last result is still in `tmp`. */
+                tpl_update_moments(mom, dst_len2, tmp, 2, dst_i1, 0);
+            }
+        }
+    }
+#undef off
+#undef scl
+}
+
+void
+_tpl_public(filter_2d)(int dim,
+                       _tpl_float*restrict dst,
+                       _tpl_index dst_len1,
+                       _tpl_index dst_len2,
+                       _tpl_float const*restrict ker,
+                       _tpl_index ker_len,
+                       _tpl_float const*restrict src,
+                       _tpl_index src_len1,
+                       _tpl_index src_len2,
+                       _tpl_index k1,
+                       _tpl_index k2,
+                       _tpl_float*restrict wrk,
+                       _tpl_float*restrict tmp)
+{
+    TPL_STATS_BEGIN;
+    _tpl_private(filter_2d_lines)(dim, dst, dst_len1, dst_len2, ker, ker_len,
+                                  src, NULL, NULL, src_len1, src_len2, k1, k2,
+                                  wrk, tmp, NULL);
+    TPL_STATS_END(TPL_STATS_FILTER_2D, dst_len1*dst_len2);
+}
+
+/*
+ * Arguments of tpl_filter_2d_parallel() for the workers.
+ */
+struct _tpl_private(filter_2d_task) {
+    int dim;
+    _tpl_float* dst;
+    _tpl_index dst_len1, dst_len2;
+    _tpl_float const* ker;
+    _tpl_index ker_len;
+    _tpl_float const* src;
+    _tpl_index src_len1, src_len2;
+    _tpl_index k1, k2;
+    _tpl_float* wrk;
+    _tpl_float* tmp;
+};
+
+/*
+ * Each thread filters a block of consecutive rows of the destination which
+ * amounts to filtering a sub-image with a shifted offset `k2`.  For `dim = 1`
+ * the rows are filtered independently, for `dim = 2` the columns of each
+ * block are shorter but the flat boundary conditions still apply to the
+ * whole source.
+ */
+static void
+_tpl_private(filter_2d_worker)(void* arg, long rank, long nranks)
+{
+    struct _tpl_private(filter_2d_task) const* t = arg;
+    _tpl_index first, last;
+    tpl_pool_split(t->dst_len2, rank, nranks, &first, &last);
+    if (first >= last) {
+        return;
+    }
+    _tpl_index dst_len1 = t->dst_len1;
+    _tpl_index dst_len = (t->dim == 1 ? dst_len1 : t->dst_len2);
+    _tpl_index wrk_len = TPL_ALIGNED_LENGTH(dst_len + t->ker_len - 1,
+                                            sizeof(_tpl_float));
+    _tpl_index tmp_len = TPL_ALIGNED_LENGTH(t->dst_len2, sizeof(_tpl_float));
+    _tpl_private(filter_2d_lines)(t->dim, &t->dst[dst_len1*first],
+                                  dst_len1, last - first, t->ker, t->ker_len,
+                                  t->src, NULL, NULL,
+                                  t->src_len1, t->src_len2,
+                                  t->k1, t->k2 + first,
+                                  t->wrk + rank*wrk_len,
+                                  (t->tmp == NULL ? NULL :
+                                   t->tmp + rank*tmp_len), NULL);
+}
+
+void
+_tpl_public(filter_2d_parallel)(TPL_Pool* pool,
+                                int dim,
+                                _tpl_float*restrict dst,
+                                _tpl_index dst_len1,
+                                _tpl_index dst_len2,
+                                _tpl_float const*restrict ker,
+                                _tpl_index ker_len,
+                                _tpl_float const*restrict src,
+                                _tpl_index src_len1,
+                                _tpl_index src_len2,
+                                _tpl_index k1,
+                                _tpl_index k2,
+                                _tpl_float*restrict wrk,
+                                _tpl_float*restrict tmp)
+{
+    if (ker_len < 1 || dst_len1 < 1 || dst_len2 < 1) {
+        return;
+    }
+    TPL_STATS_BEGIN;
+    struct _tpl_private(filter_2d_task) t = {
+        .dim = dim, .dst = dst, .dst_len1 = dst_len1, .dst_len2 = dst_len2,
+        .ker = ker, .ker_len = ker_len, .src = src,
+        .src_len1 = src_len1, .src_len2 = src_len2, .k1 = k1, .k2 = k2,
+        .wrk = wrk, .tmp = tmp
+    };
+    tpl_pool_run(pool, _tpl_private(filter_2d_worker), &t);
+    TPL_STATS_END(TPL_STATS_FILTER_2D_PARALLEL, dst_len1*dst_len2);
+}
+
+/*
+ * Arguments of tpl_filter_2d_batch() for the jobs.  Each thread uses its
+ * own parts of `wrk_len` and `tmp_len` elements of the workspaces.
+ */
+struct _tpl_private(filter_2d_batch) {
+    int dim;
+    _tpl_float* const* dst;
+    _tpl_index const* dst_len1;
+    _tpl_index const* dst_len2;
+    _tpl_float const* ker;
+    _tpl_index ker_len;
+    _tpl_float const* const* src;
+    _tpl_index const* src_len1;
+    _tpl_index const* src_len2;
+    _tpl_index k1, k2;
+    _tpl_float* wrk;
+    _tpl_float* tmp;
+    _tpl_index wrk_len, tmp_len;
+};
+
+static void
+_tpl_private(filter_2d_job)(void* arg, long j, long rank)
+{
+    struct _tpl_private(filter_2d_batch) const* b = arg;
+    _tpl_private(filter_2d_lines)(b->dim, b->dst[j],
+                                  b->dst_len1[j], b->dst_len2[j],
+                                  b->ker, b->ker_len, b->src[j], NULL, NULL,
+                                  b->src_len1[j], b->src_len2[j], b->k1, b->k2,
+                                  b->wrk + rank*b->wrk_len,
+                                  (b->tmp == NULL ? NULL :
+                                   b->tmp + rank*b->tmp_len), NULL);
+}
+
+void
+_tpl_public(filter_2d_batch)(TPL_Pool* pool,
+                             _tpl_index nimgs,
+                             int dim,
+                             _tpl_float* const dst[],
+                             _tpl_index const dst_len1[],
+                             _tpl_index const dst_len2[],
+                             _tpl_float const*restrict ker,
+                             _tpl_index ker_len,
+                             _tpl_float const* const src[],
+                             _tpl_index const src_len1[],
+                             _tpl_index const src_len2[],
+                             _tpl_index k1,
+                             _tpl_index k2,
+                             _tpl_float*restrict wrk,
+                             _tpl_float*restrict tmp)
+{
+    if (ker_len < 1 || nimgs < 1) {
+        return;
+    }
+    TPL_STATS_BEGIN;
+    long nelem = 0;
+    _tpl_index max_len = 0, max_len2 = 0;
+    for (_tpl_index j = 0; j < nimgs; ++j) {
+        _tpl_index len = (dim == 1 ? dst_len1[j] : dst_len2[j]);
+        max_len = (len > max_len ? len : max_len);
+        max_len2 = (dst_len2[j] > max_len2 ? dst_len2[j] : max_len2);
+        nelem += dst_len1[j]*dst_len2[j];
+    }
+    struct _tpl_private(filter_2d_batch) b = {
+        .dim = dim, .dst = dst, .dst_len1 = dst_len1, .dst_len2 = dst_len2,
+        .ker = ker, .ker_len = ker_len, .src = src,
+        .src_len1 = src_len1, .src_len2 = src_len2, .k1 = k1, .k2 = k2,
+        .wrk = wrk, .tmp = tmp,
+        .wrk_len = TPL_ALIGNED_LENGTH(max_len + ker_len - 1,
+                                      sizeof(_tpl_float)),
+        .tmp_len = TPL_ALIGNED_LENGTH(max_len2, sizeof(_tpl_float))
+    };
+    tpl_pool_run_jobs(pool, nimgs, _tpl_private(filter_2d_job), &b);
+    TPL_STATS_END(TPL_STATS_FILTER_2D_BATCH, nelem);
+}
+
+void
+_tpl_public(filter_2d_calib)(int dim,
+                             _tpl_float*restrict dst,
+                             _tpl_index dst_len1,
+                             _tpl_index dst_len2,
+                             _tpl_float const*restrict ker,
+                             _tpl_index ker_len,
+                             _tpl_float const*restrict src,
+                             _tpl_float const*restrict off,
+                             _tpl_float const*restrict scl,
+                             _tpl_index src_len1,
+                             _tpl_index src_len2,
+                             _tpl_index k1,
+                             _tpl_index k2,
+                             _tpl_float*restrict wrk,
+                             _tpl_float*restrict tmp)
+{
+    TPL_STATS_BEGIN;
+    _tpl_private(filter_2d_lines)(dim, dst, dst_len1, dst_len2, ker, ker_len,
+                                  src, off, scl, src_len1, src_len2, k1, k2,
+                                  wrk, tmp, NULL);
+    TPL_STATS_END(TPL_STATS_FILTER_2D_CALIB, dst_len1*dst_len2);
+}
+
+void
+_tpl_public(filter_2d_reduce)(int dim,
+                              _tpl_float*restrict dst,
+                              _tpl_index dst_len1,
+                              _tpl_index dst_len2,
+                              _tpl_float const*restrict ker,
+                              _tpl_index ker_len,
+                              _tpl_float const*restrict src,
+                              _tpl_index src_len1,
+                              _tpl_index src_len2,
+                              _tpl_index k1,
+                              _tpl_index k2,
+                              _tpl_float*restrict wrk,
+                              _tpl_float*restrict tmp,
+                              TPL_Moments* mom)
+{
+    TPL_STATS_BEGIN;
+    _tpl_private(filter_2d_lines)(dim, dst, dst_len1, dst_len2, ker, ker_len,
+                                  src, NULL, NULL, src_len1, src_len2, k1, k2,
+                                  wrk, tmp, mom);
+    TPL_STATS_END(TPL_STATS_FILTER_2D_REDUCE, dst_len1*dst_len2);
+}
+
+void
+_tpl_public(filter_2d_var)(int dim,
+                           _tpl_float*restrict dst,
+                           _tpl_float*restrict dst_var,
+                           _tpl_index dst_len1,
+                           _tpl_index dst_len2,
+                           _tpl_float const*restrict ker,
+                           _tpl_index ker_len,
+                           _tpl_float const*restrict src,
+                           _tpl_float const*restrict src_var,
+                           _tpl_index src_len1,
+                           _tpl_index src_len2,
+                           _tpl_index k1,
+                           _tpl_index k2,
+                           _tpl_float*restrict wrk,
+                           _tpl_float*restrict tmp)
+{
+#define dst_var(i1,i2)   dst_var[(i1) + dst_len1*(i2)]
+#define src_var(i1,i2)   src_var[(i1) + src_len1*(i2)]
+    if (ker_len < 1 || dst_len1 < 1 || dst_len2 < 1) {
+        return;
+    }
+    TPL_STATS_BEGIN;
+    if (dim == 1) {
+        _tpl_index wrk_len = dst_len1 + ker_len - 1;
+        _tpl_float* wrk_var = wrk + wrk_len;
+        _tpl_index src_i2_prev = -1;
+        for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+            _tpl_index src_i2 = pvc_min(pvc_max(dst_i2 + k2, 0),
+                                        src_len2 - 1);
+            if (src_i2 == src_i2_prev) {
+                // Just copy previous results.
+                tpl_copy_contiguous(dst_len1, &dst(0, dst_i2),
+                                    &dst(0, dst_i2 - 1));
+                tpl_copy_contiguous(dst_len1, &dst_var(0, dst_i2),
+                                    &dst_var(0, dst_i2 - 1));
+            } else {
+                tpl_load_contiguous_flat(wrk_len, wrk,
+                                         src_len1, &src(0, src_i2), k1);
+                tpl_load_contiguous_flat(wrk_len, wrk_var,
+                                         src_len1, &src_var(0, src_i2), k1);
+                tpl_filter_var(ker_len, dst_len1, &dst(0, dst_i2),
+                               &dst_var(0, dst_i2), ker, wrk, wrk_var);
+                src_i2_prev = src_i2;
+            }
+        }
+    } else {
+        _tpl_index wrk_len = dst_len2 + ker_len - 1;
+        _tpl_float* wrk_var = wrk + wrk_len;
+        _tpl_float* tmp_var = tmp + dst_len2;
+        _tpl_index src_i1_prev = -1;
+        for (_tpl_index dst_i1 = 0; dst_i1 < dst_len1; ++dst_i1) {
+            _tpl_index src_i1 = pvc_min(pvc_max(dst_i1 + k1, 0),
+                                        src_len1 - 1);
+            if (src_i1 == src_i1_prev) {
+                // Just store previous results again.
+                tpl_store_strided(dst_len2, &dst(dst_i1, 0), dst_len1, tmp);
+                tpl_store_strided(dst_len2, &dst_var(dst_i1, 0), dst_len1,
+                                  tmp_var);
+            } else {
+                tpl_load_strided_flat(wrk_len, wrk,
+                                      src_len2, &src(src_i1, 0),
+                                      k2, src_len1);
+                tpl_load_strided_flat(wrk_len, wrk_var,
+                                      src_len2, &src_var(src_i1, 0),
+                                      k2, src_len1);
+                tpl_filter_var(ker_len, dst_len2, tmp, tmp_var,
+                               ker, wrk, wrk_var);
+                tpl_store_strided(dst_len2, &dst(dst_i1, 0), dst_len1, tmp);
+                tpl_store_strided(dst_len2, &dst_var(dst_i1, 0), dst_len1,
+                                  tmp_var);
+                src_i1_prev = src_i1;
+            }
+        }
+    }
+    TPL_STATS_END(TPL_STATS_FILTER_2D_VAR, dst_len1*dst_len2);
+#undef dst_var
+#undef src_var
+}
+
+void
+_tpl_public(filter_2d_dilated)(int dim,
+                               _tpl_float*restrict dst,
+                               _tpl_index dst_len1,
+                               _tpl_index dst_len2,
+                               _tpl_float const*restrict ker,
+                               _tpl_index ker_len,
+                               _tpl_index dil,
+                               _tpl_float const*restrict src,
+                               _tpl_index src_len1,
+                               _tpl_index src_len2,
+                               _tpl_index k1,
+                               _tpl_index k2,
+                               _tpl_float*restrict wrk)
+{
+    if (ker_len < 1 || dst_len1 < 1 || dst_len2 < 1) {
+        return;
+    }
+    TPL_STATS_BEGIN;
+    if (dim == 1) {
+        _tpl_index wrk_len = dst_len1 + (ker_len - 1)*dil;
+        _tpl_index src_i2_prev = -1;
+        for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+            _tpl_index src_i2 = pvc_min(pvc_max(dst_i2 + k2, 0),
+                                        src_len2 - 1);
+            if (src_i2 == src_i2_prev) {
+                // Just copy previous result.
+                tpl_copy_contiguous(dst_len1, &dst(0, dst_i2),
+                                    &dst(0, dst_i2 - 1));
+            } else {
+                tpl_load_contiguous_flat(wrk_len, wrk,
+                                         src_len1, &src(0, src_i2), k1);
+                tpl_filter_dilated(ker_len, dst_len1, &dst(0, dst_i2),
+                                   ker, wrk, dil);
+                src_i2_prev = src_i2;
+            }
+        }
+    } else {
+        /* Combine whole rows restricted to the source columns `s0:s1`
+           needed by the destination.  Results are directly accumulated in
+           the destination when no columns are out of bounds. */
+        _tpl_index s0 = pvc_min(pvc_max(k1, 0), src_len1 - 1);
+        _tpl_index s1 = pvc_min(pvc_max(dst_len1 - 1 + k1, 0), src_len1 - 1);
+        _tpl_index ncols = s1 - s0 + 1;
+        int direct = (k1 >= 0 && k1 + dst_len1 <= src_len1);
+#define ROW(j) (&src(s0, pvc_min(pvc_max(j, 0), src_len2 - 1)))
+        for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+            _tpl_float* acc = (direct ? &dst(0, dst_i2) : wrk);
+            _tpl_float const* row = ROW(dst_i2 + k2);
+            _tpl_float w = ker[0];
+            for (_tpl_index i = 0; i < ncols; ++i) {
+                acc[i] = w*row[i];
+            }
+            for (_tpl_index k = 1; k < ker_len; ++k) {
+                row = ROW(dst_i2 + k2 + k*dil);
+                w = ker[k];
+                for (_tpl_index i = 0; i < ncols; ++i) {
+                    acc[i] += w*row[i];
+                }
+            }
+            if (! direct) {
+                tpl_load_contiguous_flat(dst_len1, &dst(0, dst_i2),
+                                         ncols, acc, k1 - s0);
+            }
+        }
+#undef ROW
+    }
+    TPL_STATS_END(TPL_STATS_FILTER_2D_DILATED, dst_len1*dst_len2);
 }
 
 #undef _tpl_float
@@ -0,0 +1,858 @@
+/*
+ * filter-tests.c -
+ *
+ * Testing fast filters against direct implementations.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#include <stdlib.h> /* for EXIT_SUCCESS, etc. */
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pvc-math.h>
+#include "tpl-alloc.h"
+#include "tpl-filter.h"
+#include "tpl-image.h"
+#include "tpl-inline.h"
+#include "tpl-pipeline.h"
+#include "tpl-pool.h"
+#include "tpl-shm.h"
+#include "tpl-stats.h"
+
+#define LEN1 67
+#define LEN2 54
+
+/* Dimensions of the frames of the pipeline. */
+#define FRM1 32
+#define FRM2 24
+#define NFRMS 40
+
+static void
+random_values(long n, double* x)
+{
+    for (long i = 0; i < n; ++i) {
+        x[i] = (double)rand()/RAND_MAX - 0.5;
+    }
+}
+
+static double
+max_abs_diff(long n, double const* x, double const* y)
+{
+    double r = 0.0;
+    for (long i = 0; i < n; ++i) {
+        r = pvc_max(r, fabs(x[i] - y[i]));
+    }
+    return r;
+}
+
+static int
+check(char const* name, double err, double tol)
+{
+    printf("%-32s max. err. = %g\n", name, err);
+    return (err <= tol ? 0 : -1);
+}
+
+/* Direct convolution by a truncated Gaussian with flat boundaries. */
+static void
+gauss_ref(long n, double* dst, double const* src, double sigma)
+{
+    long h = (long)ceil(5*sigma);
+    double s = 0.0;
+    for (long k = -h; k <= h; ++k) {
+        s += exp(-0.5*(k/sigma)*(k/sigma));
+    }
+    for (long i = 0; i < n; ++i) {
+        double t = 0.0;
+        for (long k = -h; k <= h; ++k) {
+            t += exp(-0.5*(k/sigma)*(k/sigma))*src[pvc_min(pvc_max(i + k, 0),
+                                                           n - 1)];
+        }
+        dst[i] = t/s;
+    }
+}
+
+/* Direct sliding minimum or maximum along a dimension with flat boundaries. */
+static void
+minmax_ref(int op, int dim, double* dst, long dst_len1, long dst_len2,
+           long m, double const* src, long src_len1, long src_len2,
+           long k1, long k2)
+{
+    for (long i2 = 0; i2 < dst_len2; ++i2) {
+        for (long i1 = 0; i1 < dst_len1; ++i1) {
+            double r = 0.0;
+            for (long k = 0; k < m; ++k) {
+                long j1 = i1 + k1 + (dim == 1 ? k : 0);
+                long j2 = i2 + k2 + (dim == 2 ? k : 0);
+                j1 = pvc_min(pvc_max(j1, 0), src_len1 - 1);
+                j2 = pvc_min(pvc_max(j2, 0), src_len2 - 1);
+                double v = src[j1 + src_len1*j2];
+                r = (k == 0 ? v : op == 0 ? pvc_min(r, v) : pvc_max(r, v));
+            }
+            dst[i1 + dst_len1*i2] = r;
+        }
+    }
+}
+
+/* Direct moments of an image. */
+static void
+moments_ref(TPL_Moments* mom, double const* v, long len1, long len2)
+{
+    tpl_initialize_moments(mom);
+    for (long i2 = 0; i2 < len2; ++i2) {
+        for (long i1 = 0; i1 < len1; ++i1) {
+            double x = v[i1 + len1*i2];
+            mom->min = (mom->count == 0 ? x : pvc_min(mom->min, x));
+            mom->max = (mom->count == 0 ? x : pvc_max(mom->max, x));
+            mom->count += 1;
+            mom->sum += x;
+            mom->sum_1 += x*i1;
+            mom->sum_2 += x*i2;
+            mom->sum_11 += x*i1*i1;
+            mom->sum_12 += x*i1*i2;
+            mom->sum_22 += x*i2*i2;
+        }
+    }
+}
+
+/* Relative difference between two values of a moment. */
+static double
+moment_diff(double u, double v)
+{
+    return fabs(u - v)/pvc_max(fabs(v), 1.0);
+}
+
+/* Relative difference between moments, compared field by field. */
+static double
+moments_diff(TPL_Moments const* a, TPL_Moments const* b)
+{
+    double r = (a->count == b->count ? 0.0 : 1.0);
+    r = pvc_max(r, moment_diff(a->sum,    b->sum));
+    r = pvc_max(r, moment_diff(a->min,    b->min));
+    r = pvc_max(r, moment_diff(a->max,    b->max));
+    r = pvc_max(r, moment_diff(a->sum_1,  b->sum_1));
+    r = pvc_max(r, moment_diff(a->sum_2,  b->sum_2));
+    r = pvc_max(r, moment_diff(a->sum_11, b->sum_11));
+    r = pvc_max(r, moment_diff(a->sum_12, b->sum_12));
+    r = pvc_max(r, moment_diff(a->sum_22, b->sum_22));
+    return r;
+}
+
+/* Job counting its calls. */
+static void
+count_job(void* arg, long j, long rank)
+{
+    __atomic_add_fetch((int*)arg + j, 1, __ATOMIC_RELAXED);
+}
+
+/* Stage of a pipeline applying a (calibrated if `off != NULL`) filter. */
+typedef struct {
+    int dim;
+    double const* ker;
+    long ker_len;
+    double const* off;
+    double const* scl;
+    long k1, k2;
+    double wrk1[FRM1 + FRM2 + 16];
+    double wrk2[FRM2];
+} FilterStage;
+
+static void
+filter_stage(void* arg, void* dst, void const* src)
+{
+    FilterStage* s = arg;
+    if (s->off != NULL) {
+        tpl_filter_2d_calib(s->dim, (double*)dst, FRM1, FRM2,
+                            s->ker, s->ker_len, (double const*)src,
+                            s->off, s->scl, FRM1, FRM2, s->k1, s->k2,
+                            s->wrk1, s->wrk2);
+    } else {
+        tpl_filter_2d(s->dim, (double*)dst, FRM1, FRM2, s->ker, s->ker_len,
+                      (double const*)src, FRM1, FRM2, s->k1, s->k2,
+                      s->wrk1, s->wrk2);
+    }
+}
+
+/* Stage of a pipeline computing the moments of a frame. */
+static void
+moments_stage(void* arg, void* dst, void const* src)
+{
+    TPL_Moments* mom = dst;
+    double const* v = src;
+    tpl_initialize_moments(mom);
+    for (long i2 = 0; i2 < FRM2; ++i2) {
+        tpl_update_moments(mom, FRM1, v + FRM1*i2, 1, 0, i2);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int status = EXIT_SUCCESS;
+    long len1 = LEN1, len2 = LEN2, npix = LEN1*LEN2;
+    static double x[LEN1*LEN2], y[LEN1*LEN2], z[LEN1*LEN2];
+    static double wrk[8*(LEN1 + 5)];
+    static double wrk3[32*(LEN1 + LEN2 + 31)];
+    static double ker[41], wrk1[LEN1 + LEN2 + 41], wrk2[LEN1 + LEN2 + 41];
+
+    /* Recursive Gaussian versus direct convolution. */
+    random_values(len1, x);
+    for (int i = 0; i < 3; ++i) {
+        double sigma = (i == 0 ? 2.5 : i == 1 ? 4.0 : 11.0);
+        tpl_gauss_filter(len1, y, x, sigma, 0);
+        gauss_ref(len1, z, x, sigma);
+        char name[64];
+        sprintf(name, "tpl_gauss_filter (sigma=%g)", sigma);
+        if (check(name, max_abs_diff(len1, y, z), 2e-2) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Constant and linear signals. */
+    for (long i = 0; i < len1; ++i) {
+        x[i] = 3.0;
+    }
+    tpl_gauss_filter(len1, y, x, 6.0, 0);
+    tpl_gauss_filter(len1, z, x, 6.0, 1);
+    if (check("tpl_gauss_filter (constant)",
+              pvc_max(max_abs_diff(len1, y, x),
+                      max_abs_diff(len1, z, z + 1) + fabs(z[0])),
+              1e-12) != 0) {
+        status = EXIT_FAILURE;
+    }
+    for (long i = 0; i < len1; ++i) {
+        x[i] = 0.25*i;
+        z[i] = 0.25;
+    }
+    tpl_gauss_filter(len1, y, x, 3.0, 1);
+    if (check("tpl_gauss_filter (slope)",
+              max_abs_diff(len1 - 40, y + 20, z + 20), 1e-4) != 0) {
+        status = EXIT_FAILURE;
+    }
+
+    /* 2D filters must agree with the 1D filter along each line. */
+    random_values(npix, x);
+    for (int order = 0; order <= 2; ++order) {
+        double err = 0.0;
+        tpl_gauss_filter_2d(1, y, x, len1, len2, 2.7, order, wrk);
+        for (long i2 = 0; i2 < len2; ++i2) {
+            tpl_gauss_filter(len1, z, x + len1*i2, 2.7, order);
+            err = pvc_max(err, max_abs_diff(len1, y + len1*i2, z));
+        }
+        tpl_gauss_filter_2d(2, y, x, len1, len2, 2.7, order, wrk);
+        for (long i1 = 0; i1 < len1; ++i1) {
+            double a[LEN2], b[LEN2];
+            for (long i2 = 0; i2 < len2; ++i2) {
+                a[i2] = x[i1 + len1*i2];
+            }
+            tpl_gauss_filter(len2, b, a, 2.7, order);
+            for (long i2 = 0; i2 < len2; ++i2) {
+                err = pvc_max(err, fabs(y[i1 + len1*i2] - b[i2]));
+            }
+        }
+        char name[64];
+        sprintf(name, "tpl_gauss_filter_2d (order=%d)", order);
+        if (check(name, err, 1e-12) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Box filters versus reference filter (with offsets). */
+    random_values(npix, x);
+    for (int dim = 1; dim <= 2; ++dim) {
+        double err = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            long m = (i == 0 ? 1 : i == 1 ? 7 : 41);
+            long k1 = (i == 1 ? 5 - m : -m/2), k2 = (i == 1 ? 2 : -m/2);
+            for (long k = 0; k < m; ++k) {
+                ker[k] = 1.0/m;
+            }
+            tpl_box_filter_2d(dim, y, len1 - 3, len2 + 2, m,
+                              x, len1, len2, k1, k2, wrk1);
+            tpl_filter_ref_2d(dim, z, len1 - 3, len2 + 2, ker, m,
+                              x, len1, len2, k1, k2, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff((len1 - 3)*(len2 + 2), y, z));
+        }
+        char name[64];
+        sprintf(name, "tpl_box_filter_2d (dim=%d)", dim);
+        if (check(name, err, 1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Sliding minimum and maximum versus direct computation. */
+    for (int op = 0; op <= 1; ++op) {
+        for (int dim = 1; dim <= 2; ++dim) {
+            double err = 0.0;
+            for (int i = 0; i < 3; ++i) {
+                long m = (i == 0 ? 1 : i == 1 ? 4 : 31);
+                long k1 = (i == 1 ? 3 : -m/2), k2 = (i == 1 ? -7 : -m/2);
+                if (op == 0) {
+                    tpl_min_filter_2d(dim, y, len1 - 3, len2 + 2, m,
+                                      x, len1, len2, k1, k2, wrk3);
+                } else {
+                    tpl_max_filter_2d(dim, y, len1 - 3, len2 + 2, m,
+                                      x, len1, len2, k1, k2, wrk3);
+                }
+                minmax_ref(op, dim, z, len1 - 3, len2 + 2, m,
+                           x, len1, len2, k1, k2);
+                err = pvc_max(err, max_abs_diff((len1 - 3)*(len2 + 2), y, z));
+            }
+            char name[64];
+            sprintf(name, "tpl_%s_filter_2d (dim=%d)",
+                    (op == 0 ? "min" : "max"), dim);
+            if (check(name, err, 0.0) != 0) {
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+    tpl_copy_contiguous(len1, y, x);
+    tpl_max_filter(9, len1 - 8, y, y, wrk3);
+    minmax_ref(1, 1, z, len1 - 8, 1, 9, x, len1, 1, 0, 0);
+    if (check("tpl_max_filter (in-place)",
+              max_abs_diff(len1 - 8, y, z), 0.0) != 0) {
+        status = EXIT_FAILURE;
+    }
+
+    /* Dilated filters versus reference filter with zero-stuffed kernel. */
+    random_values(npix, x);
+    {
+        static const double b3[5] = {1.0/16, 4.0/16, 6.0/16, 4.0/16, 1.0/16};
+        long dil = 3, m = 4*dil + 1;
+        for (long k = 0; k < m; ++k) {
+            ker[k] = (k%dil == 0 ? b3[k/dil] : 0.0);
+        }
+        double err = 0.0;
+        for (int dim = 1; dim <= 2; ++dim) {
+            for (long k1 = -2*dil; k1 <= 0; k1 += 2*dil) {
+                tpl_filter_2d_dilated(dim, y, len1 - 3, len2 + 2, b3, 5, dil,
+                                      x, len1, len2, k1, 1 - 2*dil, wrk1);
+                tpl_filter_ref_2d(dim, z, len1 - 3, len2 + 2, ker, m,
+                                  x, len1, len2, k1, 1 - 2*dil, wrk1, wrk2);
+                err = pvc_max(err, max_abs_diff((len1 - 3)*(len2 + 2), y, z));
+            }
+        }
+        if (check("tpl_filter_2d_dilated", err, 1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Non-temporal stores (at any alignment) and large-image mode. */
+    random_values(npix, x);
+    for (long k = 0; k < 5; ++k) {
+        ker[k] = 1.0/(k + 2);
+    }
+    {
+        double err = 0.0;
+        for (long m = 1; m <= 6; ++m) {
+            for (long j = 0; j < 8; ++j) {
+                long n = len1 - 7 - j;
+                tpl_filter(m, n, z + j, ker, x);
+                tpl_filter_nt(m, n, y + j, ker, x);
+                err = pvc_max(err, max_abs_diff(n, y + j, z + j));
+            }
+        }
+        size_t threshold = tpl_get_streaming_threshold();
+        for (int dim = 1; dim <= 2; ++dim) {
+            tpl_set_streaming_threshold(SIZE_MAX);
+            tpl_filter_2d(dim, z, len1 - 3, len2 + 2, ker, 5,
+                          x, len1, len2, -2, -3, wrk1, wrk2);
+            tpl_set_streaming_threshold(0);
+            tpl_filter_2d(dim, y, len1 - 3, len2 + 2, ker, 5,
+                          x, len1, len2, -2, -3, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff((len1 - 3)*(len2 + 2), y, z));
+        }
+        tpl_set_streaming_threshold(threshold);
+        if (check("tpl_filter_nt", err, 0.0) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Aligned memory and workspace arena. */
+    {
+        int bad = 0;
+        double* buf = tpl_alloc(3*sizeof(double));
+        bad |= (buf == NULL || (uintptr_t)buf%TPL_ALIGNMENT != 0);
+        tpl_free(buf);
+        TPL_Arena* arena = tpl_create_arena(3*TPL_ALIGNMENT);
+        bad |= (arena == NULL);
+        for (int pass = 0; pass < 2 && arena != NULL; ++pass) {
+            char* a = tpl_arena_alloc(arena, 1);
+            char* b = tpl_arena_alloc(arena, TPL_ALIGNMENT + 1);
+            bad |= (a == NULL || b != a + TPL_ALIGNMENT ||
+                    (uintptr_t)a%TPL_ALIGNMENT != 0 ||
+                    tpl_arena_used(arena) != 3*TPL_ALIGNMENT ||
+                    tpl_arena_alloc(arena, 1) != NULL);
+            tpl_arena_reset(arena);
+        }
+        tpl_destroy_arena(arena);
+        if (check("tpl_arena_alloc", bad, 0.0) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Starlet transform and reconstruction. */
+    {
+        static double wav[5*LEN1*LEN2], tmp[LEN1*LEN2 + LEN1 + 32];
+        tpl_starlet_2d(4, wav, x, len1, len2, tmp);
+        tpl_starlet_2d_rec(4, y, wav, len1, len2);
+        if (check("tpl_starlet_2d_rec", max_abs_diff(npix, x, y),
+                  1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Filter bank versus reference filter applied to each kernel. */
+    random_values(npix, x);
+    {
+        static double bank[5*7], out[5*LEN1*LEN2];
+        long nk = 5, m = 7, n1 = len1 - 3, n2 = len2 + 2;
+        random_values(nk*m, bank);
+        double err = 0.0;
+        for (int dim = 1; dim <= 2; ++dim) {
+            for (long k1 = -3; k1 <= 0; k1 += 3) {
+                tpl_filter_bank_2d(dim, nk, out, n1, n2, bank, m,
+                                   x, len1, len2, k1, -3, wrk3);
+                for (long k = 0; k < nk; ++k) {
+                    tpl_filter_ref_2d(dim, z, n1, n2, bank + k*m, m,
+                                      x, len1, len2, k1, -3, wrk1, wrk2);
+                    err = pvc_max(err, max_abs_diff(n1*n2, out + k*n1*n2, z));
+                }
+            }
+        }
+        if (check("tpl_filter_bank_2d", err, 1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Sobel and Scharr gradients versus separable reference filters. */
+    random_values(npix, x);
+    {
+        static double gx[LEN1*LEN2], gy[LEN1*LEN2];
+        static double mag[LEN1*LEN2], ang[LEN1*LEN2];
+        static const double sobel[3] = {1.0/4, 2.0/4, 1.0/4};
+        static const double scharr[3] = {3.0/16, 10.0/16, 3.0/16};
+        static const double diff[3] = {-0.5, 0.0, 0.5};
+        double err = 0.0;
+        for (int op = TPL_SOBEL; op <= TPL_SCHARR; ++op) {
+            double const* smo = (op == TPL_SOBEL ? sobel : scharr);
+            tpl_gradient_2d(op, gx, gy, mag, ang, x, len1, len2, wrk1);
+            tpl_filter_ref_2d(2, y, len1, len2, smo, 3,
+                              x, len1, len2, 0, -1, wrk1, wrk2);
+            tpl_filter_ref_2d(1, z, len1, len2, diff, 3,
+                              y, len1, len2, -1, 0, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff(npix, gx, z));
+            tpl_filter_ref_2d(1, y, len1, len2, smo, 3,
+                              x, len1, len2, -1, 0, wrk1, wrk2);
+            tpl_filter_ref_2d(2, z, len1, len2, diff, 3,
+                              y, len1, len2, 0, -1, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff(npix, gy, z));
+            for (long i = 0; i < npix; ++i) {
+                err = pvc_max(err, fabs(mag[i]*cos(ang[i]) - gx[i]));
+                err = pvc_max(err, fabs(mag[i]*sin(ang[i]) - gy[i]));
+            }
+        }
+        if (check("tpl_gradient_2d", err, 1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Normalized convolution versus two reference filters. */
+    random_values(npix, x);
+    {
+        static unsigned char u8[LEN1*LEN2], bits[(LEN1*LEN2 + 7)/8];
+        static double mx[LEN1*LEN2], mm[LEN1*LEN2], nd[LEN1*LEN2];
+        static double k1d[5], k2d[4], wrk4[2*(4 + 1)*LEN1 + 2*4];
+        long n1 = len1 - 3, n2 = len2 + 2;
+        random_values(5, k1d);
+        random_values(4, k2d);
+        for (int i = 0; i < 5; ++i) {
+            k1d[i] += 1.0;
+        }
+        for (int i = 0; i < 4; ++i) {
+            k2d[i] += 1.0;
+        }
+        for (long i = 0; i < npix; ++i) {
+            u8[i] = (rand()%5 != 0);
+            if (u8[i]) {
+                bits[i >> 3] |= 1 << (i & 7);
+            }
+            mm[i] = u8[i];
+            mx[i] = u8[i]*x[i];
+        }
+        tpl_filter_ref_2d(1, y, n1, len2, k1d, 5, mx, len1, len2,
+                          -2, 0, wrk1, wrk2);
+        tpl_filter_ref_2d(2, nd, n1, n2, k2d, 4, y, n1, len2,
+                          0, -1, wrk1, wrk2);
+        tpl_filter_ref_2d(1, y, n1, len2, k1d, 5, mm, len1, len2,
+                          -2, 0, wrk1, wrk2);
+        tpl_filter_ref_2d(2, z, n1, n2, k2d, 4, y, n1, len2,
+                          0, -1, wrk1, wrk2);
+        for (long i = 0; i < n1*n2; ++i) {
+            z[i] = (z[i] > 0 ? nd[i]/z[i] : 0.0);
+        }
+        double err = 0.0;
+        tpl_masked_filter_2d(y, n1, n2, k1d, 5, k2d, 4, x, TPL_MASK_UINT8, u8,
+                             len1, len2, -2, -1, wrk4);
+        err = pvc_max(err, max_abs_diff(n1*n2, y, z));
+        tpl_masked_filter_2d(y, n1, n2, k1d, 5, k2d, 4, x, TPL_MASK_BITS, bits,
+                             len1, len2, -2, -1, wrk4);
+        err = pvc_max(err, max_abs_diff(n1*n2, y, z));
+        if (check("tpl_masked_filter_2d", err, 1e-13) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Calibration while loading versus calibration followed by filter. */
+    random_values(npix, x);
+    {
+        static double dark[LEN1*LEN2], gain[LEN1*LEN2], cal[LEN1*LEN2];
+        random_values(npix, dark);
+        random_values(npix, gain);
+        random_values(7, ker);
+        for (long i = 0; i < npix; ++i) {
+            gain[i] += 1.5;
+            cal[i] = (x[i] - dark[i])*gain[i];
+        }
+        double err = 0.0;
+        for (int dim = 1; dim <= 2; ++dim) {
+            tpl_filter_2d_calib(dim, y, len1 - 3, len2 + 2, ker, 7,
+                                x, dark, gain, len1, len2, -3, -2,
+                                wrk1, wrk2);
+            tpl_filter_ref_2d(dim, z, len1 - 3, len2 + 2, ker, 7,
+                              cal, len1, len2, -3, -2, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff((len1 - 3)*(len2 + 2), y, z));
+        }
+        if (check("tpl_filter_2d_calib", err, 1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Filters with reductions versus filter followed by moments. */
+    random_values(npix, x);
+    random_values(7, ker);
+    {
+        TPL_Moments mom, ref;
+        double err = 0.0;
+        for (int dim = 1; dim <= 2; ++dim) {
+            tpl_filter_ref_2d(dim, z, len1 - 3, len2 + 2, ker, 7,
+                              x, len1, len2, -3, -2, wrk1, wrk2);
+            tpl_filter_2d(dim, y, len1 - 3, len2 + 2, ker, 7,
+                          x, len1, len2, -3, -2, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff((len1 - 3)*(len2 + 2), y, z));
+            tpl_initialize_moments(&mom);
+            tpl_filter_2d_reduce(dim, y, len1 - 3, len2 + 2, ker, 7,
+                                 x, len1, len2, -3, -2, wrk1, wrk2, &mom);
+            err = pvc_max(err, max_abs_diff((len1 - 3)*(len2 + 2), y, z));
+            moments_ref(&ref, z, len1 - 3, len2 + 2);
+            err = pvc_max(err, moments_diff(&mom, &ref));
+        }
+        if (check("tpl_filter_2d_reduce", err, 1e-12) != 0) {
+            status = EXIT_FAILURE;
+        }
+        err = 0.0;
+        tpl_filter_ref(7, npix - 6, z, ker, x);
+        tpl_initialize_moments(&mom);
+        tpl_filter_reduce(7, npix - 6, y, ker, x, &mom);
+        err = pvc_max(err, max_abs_diff(npix - 6, y, z));
+        moments_ref(&ref, z, npix - 6, 1);
+        err = pvc_max(err, moments_diff(&mom, &ref));
+        if (check("tpl_filter_reduce", err, 1e-12) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Variance propagation versus filtering by the squared kernel. */
+    random_values(npix, x);
+    random_values(7, ker);
+    {
+        static double v[LEN1*LEN2], w[LEN1*LEN2], u[LEN1*LEN2];
+        static double wrk5[2*(LEN1 + LEN2 + 41)], wrk6[2*(LEN1 + LEN2 + 41)];
+        double ker2[7];
+        for (long i = 0; i < npix; ++i) {
+            v[i] = x[i] + 0.5;
+        }
+        for (int k = 0; k < 7; ++k) {
+            ker2[k] = ker[k]*ker[k];
+        }
+        double err = 0.0;
+        for (int dim = 1; dim <= 2; ++dim) {
+            long n = (len1 - 3)*(len2 + 2);
+            tpl_filter_2d_var(dim, y, w, len1 - 3, len2 + 2, ker, 7, x, v,
+                              len1, len2, -3, -2, wrk5, wrk6);
+            tpl_filter_ref_2d(dim, z, len1 - 3, len2 + 2, ker, 7,
+                              x, len1, len2, -3, -2, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff(n, y, z));
+            tpl_filter_ref_2d(dim, u, len1 - 3, len2 + 2, ker2, 7,
+                              v, len1, len2, -3, -2, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff(n, w, u));
+        }
+        for (long m = 1; m <= 7; ++m) {
+            tpl_filter_var(m, npix - 6, y, w, ker, x, v);
+            tpl_filter_ref(m, npix - 6, z, ker, x);
+            tpl_filter_ref(m, npix - 6, u, ker2, v);
+            err = pvc_max(err, max_abs_diff(npix - 6, y, z));
+            err = pvc_max(err, max_abs_diff(npix - 6, w, u));
+        }
+        if (check("tpl_filter_2d_var", err, 1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Parallel versus serial filtering, with and without workers. */
+    random_values(npix, x);
+    random_values(7, ker);
+    {
+        static double wrk5[3*(LEN1 + LEN2 + 41)], wrk6[3*(LEN1 + LEN2 + 41)];
+        TPL_Pool* pool = tpl_create_pool(2, NULL, 10000);
+        if (pool == NULL) {
+            fprintf(stderr, "failed to create pool of threads\n");
+            return EXIT_FAILURE;
+        }
+        double err = 0.0;
+        for (int k = 0; k < 2; ++k) {
+            TPL_Pool* p = (k == 0 ? NULL : pool);
+            for (int dim = 1; dim <= 2; ++dim) {
+                long n = (len1 - 3)*(len2 + 2);
+                tpl_filter_2d_parallel(p, dim, y, len1 - 3, len2 + 2, ker, 7,
+                                       x, len1, len2, -3, -2, wrk5, wrk6);
+                tpl_filter_2d(dim, z, len1 - 3, len2 + 2, ker, 7,
+                              x, len1, len2, -3, -2, wrk1, wrk2);
+                err = pvc_max(err, max_abs_diff(n, y, z));
+            }
+        }
+        tpl_destroy_pool(pool);
+        if (check("tpl_filter_2d_parallel", err, 1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Batch of images of different sizes versus serial filtering. */
+    random_values(npix, x);
+    random_values(7, ker);
+    {
+        static double wrk5[3*(LEN1 + LEN2 + 41)], wrk6[3*(LEN1 + LEN2 + 41)];
+        static double buf[LEN1*LEN2 + 30*20 + 9*70 + 1];
+        long m1[4] = {len1, 30, 9, 1}, m2[4] = {len2, 20, 70, 1};
+        double* dst[4];
+        double const* src[4] = {x, x + 100, x + 7, x + 3};
+        dst[0] = buf;
+        for (int j = 1; j < 4; ++j) {
+            dst[j] = dst[j-1] + m1[j-1]*m2[j-1];
+        }
+        TPL_Pool* pool = tpl_create_pool(2, NULL, 10000);
+        if (pool == NULL) {
+            fprintf(stderr, "failed to create pool of threads\n");
+            return EXIT_FAILURE;
+        }
+        double err = 0.0;
+        for (int k = 0; k < 2; ++k) {
+            TPL_Pool* p = (k == 0 ? NULL : pool);
+            for (int dim = 1; dim <= 2; ++dim) {
+                tpl_filter_2d_batch(p, 4, dim, dst, m1, m2, ker, 7,
+                                    src, m1, m2, -3, -2, wrk5, wrk6);
+                for (int j = 0; j < 4; ++j) {
+                    tpl_filter_2d(dim, z, m1[j], m2[j], ker, 7, src[j],
+                                  m1[j], m2[j], -3, -2, wrk1, wrk2);
+                    err = pvc_max(err, max_abs_diff(m1[j]*m2[j], dst[j], z));
+                }
+            }
+        }
+        /* Each job of a large batch must be run exactly once. */
+        static int count[1000];
+        tpl_pool_run_jobs(pool, 1000, count_job, count);
+        for (int j = 0; j < 1000; ++j) {
+            err = pvc_max(err, fabs(count[j] - 1.0));
+        }
+        tpl_destroy_pool(pool);
+        if (check("tpl_filter_2d_batch", err, 1e-14) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Pipeline of calibration, separable filter, shift and moments versus
+       serial processing of the frames. */
+    {
+        static double frames[NFRMS][FRM1*FRM2], off[FRM1*FRM2], scl[FRM1*FRM2];
+        static double a[FRM1*FRM2], b[FRM1*FRM2], c[FRM1*FRM2];
+        static TPL_Moments ref[NFRMS];
+        static FilterStage f[3];
+        static double one = 1.0;
+        random_values(NFRMS*FRM1*FRM2, &frames[0][0]);
+        random_values(FRM1*FRM2, off);
+        random_values(FRM1*FRM2, scl);
+        random_values(5, ker);
+        f[0] = (FilterStage){.dim = 1, .ker = ker, .ker_len = 5,
+                             .off = off, .scl = scl, .k1 = -2, .k2 = 0};
+        f[1] = (FilterStage){.dim = 2, .ker = ker, .ker_len = 5,
+                             .k1 = 0, .k2 = -2};
+        f[2] = (FilterStage){.dim = 1, .ker = &one, .ker_len = 1,
+                             .k1 = 3, .k2 = -1};
+        for (int n = 0; n < NFRMS; ++n) {
+            filter_stage(&f[0], a, frames[n]);
+            filter_stage(&f[1], b, a);
+            filter_stage(&f[2], c, b);
+            moments_stage(NULL, &ref[n], c);
+        }
+        TPL_Stage* stages[4] = {filter_stage, filter_stage, filter_stage,
+                                moments_stage};
+        void* args[4] = {&f[0], &f[1], &f[2], NULL};
+        size_t sizes[3] = {sizeof(a), sizeof(a), sizeof(a)};
+        TPL_Ring* input = tpl_create_ring(3, sizeof(frames[0]));
+        TPL_Ring* output = tpl_create_ring(3, sizeof(TPL_Moments));
+        TPL_Pipeline* pipe = (input == NULL || output == NULL ? NULL :
+                              tpl_create_pipeline(4, stages, args, sizes, 2,
+                                                  input, output, NULL,
+                                                  10000));
+        if (pipe == NULL) {
+            fprintf(stderr, "failed to create pipeline\n");
+            return EXIT_FAILURE;
+        }
+        double err = 0.0;
+        int nin = 0, nout = 0;
+        long idle = 0;
+        while (nout < NFRMS && idle < 1000000) {
+            void* slot = (nin < NFRMS ? tpl_ring_acquire(input) : NULL);
+            if (slot != NULL) {
+                memcpy(slot, frames[nin], sizeof(frames[0]));
+                tpl_ring_publish(input);
+                ++nin;
+            }
+            TPL_Moments const* mom = tpl_ring_peek(output);
+            if (mom != NULL) {
+                err = pvc_max(err, moments_diff(mom, &ref[nout]));
+                tpl_ring_release(output);
+                ++nout;
+            }
+            if (slot == NULL && mom == NULL) {
+                struct timespec ts = {0, 10000};
+                nanosleep(&ts, NULL);
+                ++idle;
+            }
+        }
+        tpl_destroy_pipeline(pipe);
+        tpl_destroy_ring(input);
+        tpl_destroy_ring(output);
+        if (nout != NFRMS) {
+            err = 1.0;
+        }
+        if (check("tpl_create_pipeline", err, 0) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Filtering frames in shared memory in place. */
+    {
+        char name[64];
+        sprintf(name, "/tpl-filter-tests-%ld", (long)getpid());
+        TPL_ShmWriter* wrt = tpl_create_shm_writer(name, TPL_DOUBLE,
+                                                   len1, len2, 3);
+        TPL_ShmSource* src = (wrt == NULL ? NULL :
+                              tpl_attach_shm_source(name));
+        if (src == NULL) {
+            fprintf(stderr, "failed to create shared memory frames\n");
+            tpl_destroy_shm_writer(wrt);
+            return EXIT_FAILURE;
+        }
+        TPL_ImageView view, wview;
+        int bad = (tpl_shm_source_last(src, &view) != -1);
+        for (int n = 0; n < 2; ++n) {
+            tpl_shm_writer_start(wrt, &wview);
+            random_values(npix, wview.data);
+            tpl_shm_writer_publish(wrt);
+        }
+        bad |= (tpl_shm_source_last(src, &view) != 0 || view.serial != 1 ||
+                view.type != TPL_DOUBLE || view.pitch != len1 ||
+                view.data == wview.data);
+        double err = 0.0;
+        if (!bad) {
+            tpl_filter_2d(2, y, len1, len2, ker, 7, view.data,
+                          len1, len2, 0, -3, wrk1, wrk2);
+            bad |= !tpl_shm_source_check(src, &view);
+            tpl_copy_contiguous(npix, x, (double const*)view.data);
+            tpl_filter_2d(2, z, len1, len2, ker, 7, x,
+                          len1, len2, 0, -3, wrk1, wrk2);
+            err = max_abs_diff(npix, y, z);
+            /* Overwriting all buffers invalidates the frame. */
+            for (int n = 0; n < 3; ++n) {
+                tpl_shm_writer_start(wrt, &wview);
+                tpl_shm_writer_publish(wrt);
+            }
+            bad |= tpl_shm_source_check(src, &view);
+        }
+        tpl_detach_shm_source(src);
+        tpl_destroy_shm_writer(wrt);
+        if (check("tpl_attach_shm_source", (bad ? 1.0 : err), 0) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Out-of-core filtering by strips versus in-memory filtering. */
+    random_values(npix, x);
+    random_values(7, ker);
+    {
+        char src_name[] = "/tmp/tpl-filter-tests-XXXXXX";
+        char dst_name[] = "/tmp/tpl-filter-tests-XXXXXX";
+        int src_fd = mkstemp(src_name);
+        int dst_fd = mkstemp(dst_name);
+        if (src_fd == -1 || dst_fd == -1 ||
+            write(src_fd, x, sizeof(x)) != (ssize_t)sizeof(x)) {
+            fprintf(stderr, "failed to create temporary files\n");
+            return EXIT_FAILURE;
+        }
+        unlink(src_name);
+        unlink(dst_name);
+        double err = 0.0;
+        for (int dim = 1; dim <= 2; ++dim) {
+            long n = (len1 - 3)*(len2 + 2);
+            if (tpl_filter_2d_stream(dim, dst_fd, len1 - 3, len2 + 2, ker, 7,
+                                     src_fd, len1, len2, -3, -2, 5) != 0 ||
+                pread(dst_fd, y, n*sizeof(double), 0) !=
+                (ssize_t)(n*sizeof(double))) {
+                err = 1.0;
+                break;
+            }
+            tpl_filter_2d(dim, z, len1 - 3, len2 + 2, ker, 7,
+                          x, len1, len2, -3, -2, wrk1, wrk2);
+            err = pvc_max(err, max_abs_diff(n, y, z));
+        }
+        close(src_fd);
+        close(dst_fd);
+        if (check("tpl_filter_2d_stream", err, 0) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Instrumentation (no statistics if compiled out). */
+    {
+        TPL_Stats st;
+        unsigned long long ncalls = (tpl_stats_enabled() ? 3 : 0);
+        tpl_stats_reset();
+        for (int k = 0; k < 3; ++k) {
+            tpl_filter_2d(1, y, len1 - 3, len2 + 2, ker, 7,
+                          x, len1, len2, -3, -2, wrk1, wrk2);
+        }
+        tpl_stats_query(TPL_STATS_FILTER_2D, &st);
+        unsigned long long nhist = 0;
+        for (int j = 0; j < TPL_STATS_BUCKETS; ++j) {
+            nhist += st.hist[j];
+        }
+        int bad = (st.calls != ncalls || nhist != ncalls ||
+                   st.elements != ncalls*(len1 - 3)*(len2 + 2));
+        tpl_stats_reset();
+        tpl_stats_query(TPL_STATS_FILTER_2D, &st);
+        bad |= (st.calls != 0);
+        if (check("tpl_stats", bad, 0) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
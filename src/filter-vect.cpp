@@ -21,6 +21,7 @@
 #if USE_VCL
 #  include <vectorclass.h>
 #endif
+#include <stdint.h>
 #include "tpl-filter.h"
 
 /*
@@ -58,6 +59,17 @@
 
 #define ROUND_DOWN(a,b)    (((a)/(b))*(b))
 
+/*
+ * Non-temporal stores are weakly ordered, `STORE_FENCE()` makes them
+ * globally visible before any subsequent store.
+ */
+#if defined(__SSE__)
+#  include <immintrin.h>
+#  define STORE_FENCE()  _mm_sfence()
+#else
+#  define STORE_FENCE()  __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
 #define _CAT2(_1,_2) _1##_2
 #define CAT2(_1,_2) _CAT2(_1,_2)
 
@@ -151,6 +163,30 @@
 #define _LOAD_PART_4(p,pfx,arr,i)   _LOAD_PART_3(p,pfx,arr,i); CAT(pfx,3).load_partial(p,&(arr)[(i)+3])
 #define _LOAD_PART_5(p,pfx,arr,i)   _LOAD_PART_4(p,pfx,arr,i); CAT(pfx,4).load_partial(p,&(arr)[(i)+4])
 
+/*
+ * Loading of a group of packed values for a dilated filter.
+ *
+ * The calls `LOAD_FULL_DIL(n,pfx,arr,i,d)` and `LOAD_PART_DIL(n,p,pfx,arr,i,d)`
+ * are the same as `LOAD_FULL(n,pfx,arr,i)` and `LOAD_PART(n,p,pfx,arr,i)`
+ * except that successive variables are loaded at offsets `i`, `i+d`,
+ * `i+2*d`, etc.
+ */
+#define LOAD_FULL_DIL(n,pfx,arr,i,d)   CAT(_LOAD_FULL_DIL_,n)(pfx,arr,i,d)
+
+#define _LOAD_FULL_DIL_1(pfx,arr,i,d)                                  CAT(pfx,0).load(&(arr)[(i)])
+#define _LOAD_FULL_DIL_2(pfx,arr,i,d)   _LOAD_FULL_DIL_1(pfx,arr,i,d); CAT(pfx,1).load(&(arr)[(i)+(d)])
+#define _LOAD_FULL_DIL_3(pfx,arr,i,d)   _LOAD_FULL_DIL_2(pfx,arr,i,d); CAT(pfx,2).load(&(arr)[(i)+2*(d)])
+#define _LOAD_FULL_DIL_4(pfx,arr,i,d)   _LOAD_FULL_DIL_3(pfx,arr,i,d); CAT(pfx,3).load(&(arr)[(i)+3*(d)])
+#define _LOAD_FULL_DIL_5(pfx,arr,i,d)   _LOAD_FULL_DIL_4(pfx,arr,i,d); CAT(pfx,4).load(&(arr)[(i)+4*(d)])
+
+#define LOAD_PART_DIL(n,p,pfx,arr,i,d)   CAT(_LOAD_PART_DIL_,n)(p,pfx,arr,i,d)
+
+#define _LOAD_PART_DIL_1(p,pfx,arr,i,d)                                    CAT(pfx,0).load_partial(p,&(arr)[(i)])
+#define _LOAD_PART_DIL_2(p,pfx,arr,i,d)   _LOAD_PART_DIL_1(p,pfx,arr,i,d); CAT(pfx,1).load_partial(p,&(arr)[(i)+(d)])
+#define _LOAD_PART_DIL_3(p,pfx,arr,i,d)   _LOAD_PART_DIL_2(p,pfx,arr,i,d); CAT(pfx,2).load_partial(p,&(arr)[(i)+2*(d)])
+#define _LOAD_PART_DIL_4(p,pfx,arr,i,d)   _LOAD_PART_DIL_3(p,pfx,arr,i,d); CAT(pfx,3).load_partial(p,&(arr)[(i)+3*(d)])
+#define _LOAD_PART_DIL_5(p,pfx,arr,i,d)   _LOAD_PART_DIL_4(p,pfx,arr,i,d); CAT(pfx,4).load_partial(p,&(arr)[(i)+4*(d)])
+
 /*
  * Non-vectorized version of the filter.
  *
@@ -171,6 +207,22 @@
 #define _FILTER_5(w,a,i)  (((w##0)*(a)[i]     + (w##1)*(a)[(i)+1]) + \
                            ((w##2)*(a)[(i)+2] + (w##3)*(a)[(i)+3]) + \
                            ((w##4)*(a)[(i)+4]))
+
+/*
+ * Non-vectorized version of the dilated filter, same as `FILTER(n,w,a,i)`
+ * but with the source values taken at offsets `i`, `i+d`, `i+2*d`, etc.
+ */
+#define FILTER_DIL(n,w,a,i,d)   CAT(_FILTER_DIL_,n)(w,a,i,d)
+
+#define _FILTER_DIL_1(w,a,i,d)  ((w##0)*(a)[i])
+#define _FILTER_DIL_2(w,a,i,d)  ((w##0)*(a)[i] + (w##1)*(a)[(i)+(d)])
+#define _FILTER_DIL_3(w,a,i,d)  ((w##0)*(a)[i] + (w##1)*(a)[(i)+(d)] + \
+                                 (w##2)*(a)[(i)+2*(d)])
+#define _FILTER_DIL_4(w,a,i,d)  (((w##0)*(a)[i]        + (w##1)*(a)[(i)+(d)]) + \
+                                 ((w##2)*(a)[(i)+2*(d)] + (w##3)*(a)[(i)+3*(d)]))
+#define _FILTER_DIL_5(w,a,i,d)  (((w##0)*(a)[i]        + (w##1)*(a)[(i)+(d)]) + \
+                                 ((w##2)*(a)[(i)+2*(d)] + (w##3)*(a)[(i)+3*(d)]) + \
+                                 ((w##4)*(a)[(i)+4*(d)]))
 /*
  * Apply a vectorized version of the filter.
  *
@@ -187,12 +239,12 @@
 #if defined(__FMA__)
 #  define _APPLY_FILTER_2(r,w,a)                \
     r = a##0*w##0;                              \
-    mul_add(a##1,w##1, r)
+    r = mul_add(a##1,w##1, r)
 #  define _APPLY_FILTER_3(r,w,a)                \
     r = a##0*w##0;                              \
     r = mul_add(a##1,w##1, r);                  \
     r = mul_add(a##2,w##2, r)
-#  define _APPLY_FILTER_4(r,ww,a)               \
+#  define _APPLY_FILTER_4(r,w,a)                \
     r = a##0*w##0;                              \
     r = mul_add(a##1,w##1, r);                  \
     r = mul_add(a##2,w##2, r);                  \
@@ -330,4 +382,79 @@ _tpl_func(CAT2(filter_x,_tpl_kersiz))(_tpl_index n,
 #endif
 }
 
+/*
+ * Same as above but with non-temporal stores which do not pollute the cache
+ * with the destination.  The first elements are stored with a partial store
+ * until the destination is aligned on the size of the packed vectors.
+ */
+extern "C" void
+_tpl_func(CAT3(filter_x,_tpl_kersiz,_nt))(_tpl_index n,
+                                          _tpl_float *restrict dst,
+                                          _tpl_float const*restrict ker,
+                                          _tpl_float const*restrict src)
+{
+#if _tpl_size > 1
+    const uintptr_t align = _tpl_size*sizeof(_tpl_float);
+    uintptr_t addr = (uintptr_t)dst;
+    _tpl_index j = ((align - addr%align)%align)/sizeof(_tpl_float);
+    if (addr%sizeof(_tpl_float) != 0 || j >= n) {
+        _tpl_func(CAT2(filter_x,_tpl_kersiz))(n, dst, ker, src);
+        return;
+    }
+    _tpl_vect r, LIST(_tpl_kersiz, a);
+    LOAD_COEFS(_tpl_kersiz, _tpl_vect, w, ker);
+    if (j > 0) {
+        int p = j;
+        LOAD_PART(_tpl_kersiz, p, a, src, 0);
+        APPLY_FILTER(r, _tpl_kersiz, w, a);
+        r.store_partial(p, dst);
+    }
+    _tpl_index m = j + ROUND_DOWN(n - j, _tpl_size);
+    for (_tpl_index i = j; i < m; i += _tpl_size) {
+        LOAD_FULL(_tpl_kersiz, a, src, i);
+        APPLY_FILTER(r, _tpl_kersiz, w, a);
+        r.store_nt(&dst[i]);
+    }
+    if (m < n) {
+        int p = n - m;
+        LOAD_PART(_tpl_kersiz, p, a, src, m);
+        APPLY_FILTER(r, _tpl_kersiz, w, a);
+        r.store_partial(p, &dst[m]);
+    }
+    STORE_FENCE();
+#else /* non-vectorized code */
+    _tpl_func(CAT2(filter_x,_tpl_kersiz))(n, dst, ker, src);
+#endif
+}
+
+extern "C" void
+_tpl_func(CAT3(filter_x,_tpl_kersiz,_dilated))(_tpl_index n,
+                                               _tpl_float *restrict dst,
+                                               _tpl_float const*restrict ker,
+                                               _tpl_float const*restrict src,
+                                               _tpl_index d)
+{
+#if _tpl_size > 1
+    _tpl_vect r, LIST(_tpl_kersiz, a);
+    LOAD_COEFS(_tpl_kersiz, _tpl_vect, w, ker);
+    _tpl_index m = ROUND_DOWN(n, _tpl_size);
+    for (_tpl_index i = 0; i < m; i += _tpl_size) {
+        LOAD_FULL_DIL(_tpl_kersiz, a, src, i, d);
+        APPLY_FILTER(r, _tpl_kersiz, w, a);
+        r.store(&dst[i]);
+    }
+    if (m < n) {
+        int p = n - m;
+        LOAD_PART_DIL(_tpl_kersiz, p, a, src, m, d);
+        APPLY_FILTER(r, _tpl_kersiz, w, a);
+        r.store_partial(p, &dst[m]);
+    }
+#else /* non-vectorized code */
+    LOAD_COEFS(_tpl_kersiz, _tpl_float, w, ker);
+    for (_tpl_index i = 0; i < n; ++i) {
+        dst[i] = FILTER_DIL(_tpl_kersiz, w, src, i, d);
+    }
+#endif
+}
+
 #endif /* _TPL_FILTER_VCL_C */
@@ -16,9 +16,35 @@
 #define _TPL_FILTER_C 1
 
 #include "tpl-filter.h"
+#include "tpl-stats.h"
 
 #define _tpl_index       long
 
+/* Number of values filtered before being reduced, small enough for the
+   chunk to stay in L1 cache. */
+#define REDUCE_CHUNK     1024
+
+/* Number of values and variances filtered in turn, small enough for the
+   four chunks of source and destination to stay in L1 cache. */
+#define VAR_CHUNK        512
+
+/* Longest kernel with a vectorized version. */
+#define VECT_KER_MAX     5
+
+static size_t streaming_threshold = TPL_STREAMING_THRESHOLD;
+
+void
+tpl_set_streaming_threshold(size_t size)
+{
+    __atomic_store_n(&streaming_threshold, size, __ATOMIC_RELAXED);
+}
+
+size_t
+tpl_get_streaming_threshold(void)
+{
+    return __atomic_load_n(&streaming_threshold, __ATOMIC_RELAXED);
+}
+
 #define _tpl_float       float
 #define _tpl_func(name)  tpl_##name##_f
 #include __FILE__
@@ -36,6 +62,7 @@ _tpl_func(filter)(_tpl_index                m,
                   _tpl_float const*restrict ker,
                   _tpl_float const*restrict src)
 {
+    TPL_STATS_BEGIN;
     if (m == 5) {
         _tpl_func(filter_x5)(n, dst, ker, src);
     } else if (m == 4) {
@@ -49,6 +76,89 @@ _tpl_func(filter)(_tpl_index                m,
     } else {
         _tpl_func(filter_ref)(m, n, dst, ker, src);
     }
+    TPL_STATS_END(TPL_STATS_FILTER, n);
+}
+
+void
+_tpl_func(filter_nt)(_tpl_index                m,
+                     _tpl_index                n,
+                     _tpl_float      *restrict dst,
+                     _tpl_float const*restrict ker,
+                     _tpl_float const*restrict src)
+{
+    TPL_STATS_BEGIN;
+    if (m == 5) {
+        _tpl_func(filter_x5_nt)(n, dst, ker, src);
+    } else if (m == 4) {
+        _tpl_func(filter_x4_nt)(n, dst, ker, src);
+    } else if (m == 3) {
+        _tpl_func(filter_x3_nt)(n, dst, ker, src);
+    } else if (m == 2) {
+        _tpl_func(filter_x2_nt)(n, dst, ker, src);
+    } else if (m == 1) {
+        _tpl_func(filter_x1_nt)(n, dst, ker, src);
+    } else {
+        _tpl_func(filter_ref)(m, n, dst, ker, src);
+    }
+    TPL_STATS_END(TPL_STATS_FILTER, n);
+}
+
+void
+_tpl_func(filter_reduce)(_tpl_index                m,
+                         _tpl_index                n,
+                         _tpl_float      *restrict dst,
+                         _tpl_float const*restrict ker,
+                         _tpl_float const*restrict src,
+                         TPL_Moments*              mom)
+{
+    TPL_STATS_BEGIN;
+    for (_tpl_index i = 0; i < n; i += REDUCE_CHUNK) {
+        _tpl_index len = (n - i < REDUCE_CHUNK ? n - i : REDUCE_CHUNK);
+        _tpl_func(filter)(m, len, dst + i, ker, src + i);
+        _tpl_func(update_moments)(mom, len, dst + i, 1, i, 0);
+    }
+    TPL_STATS_END(TPL_STATS_FILTER_REDUCE, n);
+}
+
+void
+_tpl_func(filter_var)(_tpl_index                m,
+                      _tpl_index                n,
+                      _tpl_float      *restrict dst,
+                      _tpl_float      *restrict dst_var,
+                      _tpl_float const*restrict ker,
+                      _tpl_float const*restrict src,
+                      _tpl_float const*restrict src_var)
+{
+    if (m < 1 || n < 1) {
+        return;
+    }
+    TPL_STATS_BEGIN;
+    if (m <= VECT_KER_MAX) {
+        /* Vectorized filters applied in turn to chunks of the values and of
+           the variances while they are in cache. */
+        _tpl_float ker2[VECT_KER_MAX];
+        for (_tpl_index k = 0; k < m; ++k) {
+            ker2[k] = ker[k]*ker[k];
+        }
+        for (_tpl_index i = 0; i < n; i += VAR_CHUNK) {
+            _tpl_index len = (n - i < VAR_CHUNK ? n - i : VAR_CHUNK);
+            _tpl_func(filter)(m, len, dst + i, ker, src + i);
+            _tpl_func(filter)(m, len, dst_var + i, ker2, src_var + i);
+        }
+    } else {
+        /* Both outputs computed in the same loop. */
+        for (_tpl_index i = 0; i < n; ++i) {
+            _tpl_float s = 0, v = 0;
+            for (_tpl_index k = 0; k < m; ++k) {
+                _tpl_float c = ker[k];
+                s += c*src[i+k];
+                v += (c*c)*src_var[i+k];
+            }
+            dst[i] = s;
+            dst_var[i] = v;
+        }
+    }
+    TPL_STATS_END(TPL_STATS_FILTER_VAR, n);
 }
 
 void
@@ -67,6 +177,37 @@ _tpl_func(filter_ref)(_tpl_index                m,
     }
 }
 
+void
+_tpl_func(filter_dilated)(_tpl_index                m,
+                          _tpl_index                n,
+                          _tpl_float      *restrict dst,
+                          _tpl_float const*restrict ker,
+                          _tpl_float const*restrict src,
+                          _tpl_index                d)
+{
+    TPL_STATS_BEGIN;
+    if (m == 5) {
+        _tpl_func(filter_x5_dilated)(n, dst, ker, src, d);
+    } else if (m == 4) {
+        _tpl_func(filter_x4_dilated)(n, dst, ker, src, d);
+    } else if (m == 3) {
+        _tpl_func(filter_x3_dilated)(n, dst, ker, src, d);
+    } else if (m == 2) {
+        _tpl_func(filter_x2_dilated)(n, dst, ker, src, d);
+    } else if (m == 1) {
+        _tpl_func(filter_x1_dilated)(n, dst, ker, src, d);
+    } else {
+        for (_tpl_index i = 0; i < n; ++i) {
+            _tpl_float s = 0;
+            for (_tpl_index k = 0; k < m; ++k) {
+                s += ker[k]*src[i+k*d];
+            }
+            dst[i] = s;
+        }
+    }
+    TPL_STATS_END(TPL_STATS_FILTER_DILATED, n);
+}
+
 #undef _tpl_float
 #undef _tpl_func
 
@@ -0,0 +1,273 @@
+/*
+ * gauss.c -
+ *
+ * Implementation of recursive Gaussian filters.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_GAUSS_C
+#define _TPL_GAUSS_C 1
+
+#include <math.h>
+
+#include "tpl-filter.h"
+#include "tpl-image.h"
+
+#define _tpl_index       long
+
+/* Number of columns filtered together when `dim = 1`. */
+#define BLOCK 8
+
+/*
+ * Coefficients of the 3rd order recursive filter of Young & van Vliet (1995):
+ *
+ *     w[j] = b*x[j] + a1*w[j-1] + a2*w[j-2] + a3*w[j-3]    (causal)
+ *     y[j] = b*w[j] + a1*y[j+1] + a2*y[j+2] + a3*y[j+3]    (anti-causal)
+ *
+ * and matrix `m` of Triggs & Sdika (2006) (premultiplied by `b`) which yields
+ * `y[n-1] - u`, `y[n] - u` and `y[n+1] - u` from `w[n-1] - u`, `w[n-2] - u`
+ * and `w[n-3] - u` for a signal of length `n` extended by its last value `u`.
+ */
+typedef struct {
+    double b, a1, a2, a3;
+    double m[3][3];
+} gauss_coefs;
+
+static int
+gauss_coefs_init(gauss_coefs* c, double sigma, int order)
+{
+    if (!(sigma >= 0.5) || order < 0 || order > 2) {
+        return -1;
+    }
+    double q = (sigma >= 2.5 ? 0.98711*sigma - 0.96330 :
+                3.97156 - 4.14554*sqrt(1.0 - 0.26891*sigma));
+    double q2 = q*q, q3 = q2*q;
+    double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+    double a1 = (2.44413*q + 2.85619*q2 + 1.26661*q3)/b0;
+    double a2 = -(1.4281*q2 + 1.26661*q3)/b0;
+    double a3 = 0.422205*q3/b0;
+    double b = 1.0 - (a1 + a2 + a3);
+    double s = b/((1.0 + a1 - a2 + a3)*(1.0 - a1 - a2 - a3)*
+                  (1.0 + a2 + (a1 - a3)*a3));
+    c->b = b;
+    c->a1 = a1;
+    c->a2 = a2;
+    c->a3 = a3;
+    c->m[0][0] = s*(1.0 - a2 - a1*a3 - a3*a3);
+    c->m[0][1] = s*(a1 + a3)*(a2 + a1*a3);
+    c->m[0][2] = s*a3*(a1 + a2*a3);
+    c->m[1][0] = s*(a1 + a2*a3);
+    c->m[1][1] = s*(1.0 - a2)*(a2 + a1*a3);
+    c->m[1][2] = s*(1.0 - a2 - a1*a3 - a3*a3)*a3;
+    c->m[2][0] = s*(a1*a3 + a2 + a1*a1 - a2*a2);
+    c->m[2][1] = s*(a1*a2 + a3*a2*a2 - a1*a3*a3 - a3*a3*a3 - a3*a2 + a3);
+    c->m[2][2] = s*a3*(a1 + a2*a3);
+    return 0;
+}
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_GAUSS_C defined */
+
+/*
+ * Apply the recursive Gaussian filter to `nb` interleaved lines of length `n`.
+ * Sample `j` of line `b` is `src[j*stride + b]` in the source and
+ * `dst[j*stride + b]` in the destination.  The two may be the same.  All
+ * operations are done on whole rows of `nb` values so that the compiler can
+ * vectorize the recursions.  Workspace `tmp` must have `5*nb` elements.
+ */
+static inline void
+_tpl_private(gauss_lines)(gauss_coefs const* c,
+                          int order,
+                          _tpl_index n,
+                          _tpl_index nb,
+                          _tpl_index stride,
+                          _tpl_float* dst,
+                          _tpl_float const* src,
+                          _tpl_float*restrict tmp)
+{
+#define X(j) (src + (j)*stride)
+#define Z(j) (dst + (j)*stride)
+#define Y(j) ((j) < n ? Z(j) : (j) == n ? p1 : p2)
+    _tpl_float* x0 = tmp;          /* first source value */
+    _tpl_float* u  = tmp + nb;     /* last source value */
+    _tpl_float* p1 = tmp + 2*nb;   /* y[n] */
+    _tpl_float* p2 = tmp + 3*nb;   /* y[n+1] */
+    _tpl_float* q  = tmp + 4*nb;   /* y[j-1] */
+    const _tpl_float b  = c->b;
+    const _tpl_float a1 = c->a1;
+    const _tpl_float a2 = c->a2;
+    const _tpl_float a3 = c->a3;
+
+    if (n < 1) {
+        return;
+    }
+    for (_tpl_index k = 0; k < nb; ++k) {
+        x0[k] = X(0)[k];
+        u[k] = X(n-1)[k];
+    }
+
+    /* Causal pass, the state is `x[0]` before the first sample. */
+    for (_tpl_index j = 0; j < n; ++j) {
+        _tpl_float const* xj = X(j);
+        _tpl_float const* w1 = (j >= 1 ? Z(j-1) : x0);
+        _tpl_float const* w2 = (j >= 2 ? Z(j-2) : x0);
+        _tpl_float const* w3 = (j >= 3 ? Z(j-3) : x0);
+        _tpl_float* zj = Z(j);
+        for (_tpl_index k = 0; k < nb; ++k) {
+            zj[k] = b*xj[k] + a1*w1[k] + a2*w2[k] + a3*w3[k];
+        }
+    }
+
+    /* Initial state of the anti-causal pass (Triggs & Sdika). */
+    {
+        _tpl_float* w1 = Z(n-1);
+        _tpl_float const* w2 = (n >= 2 ? Z(n-2) : x0);
+        _tpl_float const* w3 = (n >= 3 ? Z(n-3) : x0);
+        const _tpl_float m00 = c->m[0][0], m01 = c->m[0][1], m02 = c->m[0][2];
+        const _tpl_float m10 = c->m[1][0], m11 = c->m[1][1], m12 = c->m[1][2];
+        const _tpl_float m20 = c->m[2][0], m21 = c->m[2][1], m22 = c->m[2][2];
+        for (_tpl_index k = 0; k < nb; ++k) {
+            _tpl_float d1 = w1[k] - u[k];
+            _tpl_float d2 = w2[k] - u[k];
+            _tpl_float d3 = w3[k] - u[k];
+            p1[k] = u[k] + m10*d1 + m11*d2 + m12*d3;
+            p2[k] = u[k] + m20*d1 + m21*d2 + m22*d3;
+            w1[k] = u[k] + m00*d1 + m01*d2 + m02*d3;
+        }
+    }
+
+    /* Anti-causal pass. */
+    for (_tpl_index j = n - 2; j >= 0; --j) {
+        _tpl_float const* y1 = Z(j+1);
+        _tpl_float const* y2 = Y(j+2);
+        _tpl_float const* y3 = Y(j+3);
+        _tpl_float* zj = Z(j);
+        for (_tpl_index k = 0; k < nb; ++k) {
+            zj[k] = b*zj[k] + a1*y1[k] + a2*y2[k] + a3*y3[k];
+        }
+    }
+    if (order == 0) {
+        return;
+    }
+
+    /* Central differences, `y[-1]` is obtained by one more anti-causal step
+       since `w[-1] = x[0]`. */
+    {
+        _tpl_float const* y0 = Y(0);
+        _tpl_float const* y1 = Y(1);
+        _tpl_float const* y2 = Y(2);
+        for (_tpl_index k = 0; k < nb; ++k) {
+            q[k] = b*x0[k] + a1*y0[k] + a2*y1[k] + a3*y2[k];
+        }
+    }
+    if (order == 1) {
+        for (_tpl_index j = 0; j < n; ++j) {
+            _tpl_float const* yn = Y(j+1);
+            _tpl_float* zj = Z(j);
+            for (_tpl_index k = 0; k < nb; ++k) {
+                _tpl_float t = zj[k];
+                zj[k] = (yn[k] - q[k])/2;
+                q[k] = t;
+            }
+        }
+    } else {
+        for (_tpl_index j = 0; j < n; ++j) {
+            _tpl_float const* yn = Y(j+1);
+            _tpl_float* zj = Z(j);
+            for (_tpl_index k = 0; k < nb; ++k) {
+                _tpl_float t = zj[k];
+                zj[k] = (yn[k] - t) - (t - q[k]);
+                q[k] = t;
+            }
+        }
+    }
+#undef X
+#undef Y
+#undef Z
+}
+
+int
+_tpl_public(gauss_filter)(_tpl_index n,
+                          _tpl_float* dst,
+                          _tpl_float const* src,
+                          double sigma,
+                          int order)
+{
+    gauss_coefs c;
+    _tpl_float tmp[5];
+    if (gauss_coefs_init(&c, sigma, order) != 0) {
+        return -1;
+    }
+    _tpl_private(gauss_lines)(&c, order, n, 1, 1, dst, src, tmp);
+    return 0;
+}
+
+int
+_tpl_public(gauss_filter_2d)(int dim,
+                             _tpl_float* dst,
+                             _tpl_float const* src,
+                             _tpl_index len1,
+                             _tpl_index len2,
+                             double sigma,
+                             int order,
+                             _tpl_float*restrict wrk)
+{
+    gauss_coefs c;
+    if (gauss_coefs_init(&c, sigma, order) != 0 || (dim != 1 && dim != 2)) {
+        return -1;
+    }
+    if (len1 < 1 || len2 < 1) {
+        return 0;
+    }
+    if (dim == 2) {
+        /* Filter along the rows, all columns at the same time. */
+        _tpl_private(gauss_lines)(&c, order, len2, len1, len1,
+                                  dst, src, wrk);
+    } else {
+        /* Filter blocks of columns transposed in the workspace.  The last
+           block is padded with copies of its last column. */
+        _tpl_float* blk = wrk;
+        _tpl_float* tmp = wrk + BLOCK*len1;
+        for (_tpl_index i2 = 0; i2 < len2; i2 += BLOCK) {
+            _tpl_index nb = pvc_min(len2 - i2, BLOCK);
+            _tpl_float const* col[BLOCK];
+            for (_tpl_index k = 0; k < BLOCK; ++k) {
+                col[k] = src + len1*(i2 + pvc_min(k, nb - 1));
+            }
+            for (_tpl_index i1 = 0; i1 < len1; ++i1) {
+                for (_tpl_index k = 0; k < BLOCK; ++k) {
+                    blk[BLOCK*i1 + k] = col[k][i1];
+                }
+            }
+            _tpl_private(gauss_lines)(&c, order, len1, BLOCK, BLOCK,
+                                      blk, blk, tmp);
+            for (_tpl_index k = 0; k < nb; ++k) {
+                _tpl_float* out = dst + len1*(i2 + k);
+                for (_tpl_index i1 = 0; i1 < len1; ++i1) {
+                    out[i1] = blk[BLOCK*i1 + k];
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+#undef _tpl_float
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_GAUSS_C */
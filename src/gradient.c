@@ -0,0 +1,111 @@
+/*
+ * gradient.c -
+ *
+ * Implementation of fused Sobel and Scharr image gradients.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_GRADIENT_C
+#define _TPL_GRADIENT_C 1
+
+#include <math.h>
+#include <stddef.h>
+
+#include "tpl-image.h"
+
+#define _tpl_index       long
+
+/* Assume column-major storage order. */
+#define src(i1,i2)       src[(i1) + len1*(i2)]
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_sqrt           sqrtf
+#define _tpl_atan2          atan2f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_sqrt           sqrt
+#define _tpl_atan2          atan2
+#include __FILE__
+
+#else /* _TPL_GRADIENT_C defined */
+
+int
+_tpl_public(gradient_2d)(TPL_GradientOperator op,
+                         _tpl_float*restrict gx,
+                         _tpl_float*restrict gy,
+                         _tpl_float*restrict mag,
+                         _tpl_float*restrict ang,
+                         _tpl_float const*restrict src,
+                         _tpl_index len1,
+                         _tpl_index len2,
+                         _tpl_float*restrict wrk)
+{
+    /* Normalized smoothing weights, the central difference is `(a[i+1] -
+       a[i-1])/2`. */
+    _tpl_float w0, w1;
+    if (op == TPL_SOBEL) {
+        w0 = (_tpl_float)1/4;
+        w1 = (_tpl_float)2/4;
+    } else if (op == TPL_SCHARR) {
+        w0 = (_tpl_float)3/16;
+        w1 = (_tpl_float)10/16;
+    } else {
+        return -1;
+    }
+    if (len1 < 1 || len2 < 1) {
+        return 0;
+    }
+
+    /* Rows of vertically smoothed values `s` and vertical differences `d`,
+       padded by one element at each end for flat boundary conditions. */
+    _tpl_float* s = wrk + 1;
+    _tpl_float* d = wrk + len1 + 3;
+    for (_tpl_index i2 = 0; i2 < len2; ++i2) {
+        _tpl_float const* rp = &src(0, pvc_max(i2 - 1, 0));
+        _tpl_float const* r0 = &src(0, i2);
+        _tpl_float const* rn = &src(0, pvc_min(i2 + 1, len2 - 1));
+        for (_tpl_index i1 = 0; i1 < len1; ++i1) {
+            s[i1] = w0*(rp[i1] + rn[i1]) + w1*r0[i1];
+            d[i1] = (rn[i1] - rp[i1])/2;
+        }
+        s[-1] = s[0];
+        s[len1] = s[len1-1];
+        d[-1] = d[0];
+        d[len1] = d[len1-1];
+        _tpl_index off = len1*i2;
+        _tpl_float* x = gx + off;
+        _tpl_float* y = gy + off;
+        for (_tpl_index i1 = 0; i1 < len1; ++i1) {
+            x[i1] = (s[i1+1] - s[i1-1])/2;
+            y[i1] = w0*(d[i1-1] + d[i1+1]) + w1*d[i1];
+        }
+        if (mag != NULL) {
+            _tpl_float* m = mag + off;
+            for (_tpl_index i1 = 0; i1 < len1; ++i1) {
+                m[i1] = _tpl_sqrt(x[i1]*x[i1] + y[i1]*y[i1]);
+            }
+        }
+        if (ang != NULL) {
+            _tpl_float* a = ang + off;
+            for (_tpl_index i1 = 0; i1 < len1; ++i1) {
+                a[i1] = _tpl_atan2(y[i1], x[i1]);
+            }
+        }
+    }
+    return 0;
+}
+
+#undef _tpl_float
+#undef _tpl_public
+#undef _tpl_sqrt
+#undef _tpl_atan2
+
+#endif /* _TPL_GRADIENT_C */
@@ -47,5 +47,54 @@ int main(int argc, char* argv[])
     double err_avg = sum1/cnt;
     double err_std = sqrt((sum2 - (sum1/cnt)*sum1)/(cnt - 1));
     printf("err. = %g +/- %g\n", err_avg, err_std);
+
+    /*
+     * Quantized interpolation weights must be exact at the quantization
+     * steps and otherwise differ by less than the variation of the weights
+     * over half a step.
+     */
+    long steps = 256;
+    TPL_QuantizedInterpolation q;
+    if (tpl_initialize_quantized_interpolation(
+            &q, (TPL_InterpolationFunction const*)&phi, steps) != 0) {
+        fprintf(stderr, "failed to initialize quantized interpolation\n");
+        return EXIT_FAILURE;
+    }
+    double grid_err = 0.0;
+    double quant_err = 0.0;
+    double fused_err = 0.0;
+    for (long r = 0; r <= 4*steps; ++r) {
+        double t = (double)r/(4*steps);
+        double w0[4], w1[4], d0[4], d1[4];
+        TPL_INTERP_FUNC_WGTS(&phi, t, w0);
+        TPL_INTERP_FUNC_WGTS(&q, t, w1);
+        TPL_INTERP_DERIV_WGTS(&phi, t, d0);
+        TPL_INTERP_DERIV_WGTS(&q, t, d1);
+        double const* w2 = TPL_QUANTIZED_FUNC_WGTS(&q, t);
+        double w3[4], d3[4], w4[4], d4[4];
+        TPL_INTERP_FUNC_DERIV_WGTS(&phi, t, w3, d3);
+        TPL_INTERP_FUNC_DERIV_WGTS(&q, t, w4, d4);
+        for (int k = 0; k < 4; ++k) {
+            double e = pvc_max(fabs(w1[k] - w0[k]), fabs(d1[k] - d0[k]));
+            if (r%4 == 0) {
+                grid_err = pvc_max(grid_err, e);
+            } else {
+                quant_err = pvc_max(quant_err, e);
+            }
+            fused_err = pvc_max(fused_err, fabs(w3[k] - w0[k]));
+            fused_err = pvc_max(fused_err, fabs(d3[k] - d0[k]));
+            if (w2[k] != w1[k] || w4[k] != w1[k] || d4[k] != d1[k]) {
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+    tpl_finalize_quantized_interpolation(&q);
+    printf("quantized weights: abs. err. at steps = %g\n", grid_err);
+    printf("quantized weights: abs. err. max. = %g (steps = %ld)\n",
+           quant_err, steps);
+    printf("fused weights: abs. err. max. = %g\n", fused_err);
+    if (grid_err > 1e-15 || quant_err > 4.0/steps || fused_err > 1e-15) {
+        status = EXIT_FAILURE;
+    }
     return status;
 }
@@ -12,13 +12,10 @@
  */
 
 #include "tpl-interp.h"
+#include "tpl-alloc.h"
+#include <stdlib.h>
 #include <math.h>
 
-/* This is just to have a concrete definition. */
-struct TPL_InterpolationFunction {
-     _TPL_INTERPOLATION_FUNCTION;
-};
-
 #define frac(T,a,b)  (((T)(a))/((T)(b)))
 
 #define square(x)                               \
@@ -131,6 +128,28 @@ cardinal_cubic_spline_deriv_weights(TPL_InterpolationFunction const* ptr,
     w[3] = obj->d1*t*(frac(double,2,3) - t);
 }
 
+static void
+cardinal_cubic_spline_func_deriv_weights(TPL_InterpolationFunction const* ptr,
+                                         double t, double* w, double* d)
+{
+    TPL_CardinalCubicSpline const* obj = (TPL_CardinalCubicSpline const*)ptr;
+    /*
+     * Same as cardinal_cubic_spline_func_weights and
+     * cardinal_cubic_spline_deriv_weights but sharing u = 1 - t and t u.
+     */
+    double u = 1 - t;
+    double tu = t*u;
+    double ptu = obj->f1*tu;
+    w[0] = ptu*u;
+    w[1] = (u - obj->f2*t)*tu + u;
+    w[2] = (t - obj->f2*u)*tu + t;
+    w[3] = ptu*t;
+    d[0] = -obj->d1*u*(t - frac(double,1,3));
+    d[1] = obj->d2*(t - obj->d3)*t;
+    d[2] = -obj->d2*u*(obj->d4 - t);
+    d[3] = obj->d1*t*(frac(double,2,3) - t);
+}
+
 void
 tpl_initialize_cardinal_cubic_spline(TPL_CardinalCubicSpline* obj, double c)
 {
@@ -149,4 +168,146 @@ tpl_initialize_cardinal_cubic_spline(TPL_CardinalCubicSpline* obj, double c)
     obj->func_wgts = cardinal_cubic_spline_func_weights;
     obj->deriv = cardinal_cubic_spline_deriv;
     obj->deriv_wgts = cardinal_cubic_spline_deriv_weights;
+    obj->func_deriv_wgts = cardinal_cubic_spline_func_deriv_weights;
+}
+
+// Row of the table of a quantized interpolation function for offset `t`.
+static inline double const*
+quantized_table_row(TPL_QuantizedInterpolation const* obj,
+                    double const* tab, double t)
+{
+    long r = (long)(t*obj->steps + 0.5);
+    if (r < 0) {
+        r = 0;
+    } else if (r > obj->steps) {
+        r = obj->steps;
+    }
+    return tab + r*obj->stride;
+}
+
+static double
+quantized_func(TPL_InterpolationFunction const* ptr, double x)
+{
+    TPL_QuantizedInterpolation const* obj =
+        (TPL_QuantizedInterpolation const*)ptr;
+    return TPL_INTERP_FUNC(obj->base, x);
+}
+
+static void
+quantized_func_weights(TPL_InterpolationFunction const* ptr,
+                       double t, double* w)
+{
+    TPL_QuantizedInterpolation const* obj =
+        (TPL_QuantizedInterpolation const*)ptr;
+    double const* tab = quantized_table_row(obj, obj->func_table, t);
+    for (long k = 0; k < obj->size; ++k) {
+        w[k] = tab[k];
+    }
+}
+
+static double
+quantized_deriv(TPL_InterpolationFunction const* ptr, double x)
+{
+    TPL_QuantizedInterpolation const* obj =
+        (TPL_QuantizedInterpolation const*)ptr;
+    return TPL_INTERP_DERIV(obj->base, x);
+}
+
+static void
+quantized_deriv_weights(TPL_InterpolationFunction const* ptr,
+                        double t, double* w)
+{
+    TPL_QuantizedInterpolation const* obj =
+        (TPL_QuantizedInterpolation const*)ptr;
+    double const* tab = quantized_table_row(obj, obj->deriv_table, t);
+    for (long k = 0; k < obj->size; ++k) {
+        w[k] = tab[k];
+    }
+}
+
+static void
+quantized_func_deriv_weights(TPL_InterpolationFunction const* ptr,
+                             double t, double* w, double* d)
+{
+    TPL_QuantizedInterpolation const* obj =
+        (TPL_QuantizedInterpolation const*)ptr;
+    double const* ftab = quantized_table_row(obj, obj->func_table, t);
+    double const* dtab = quantized_table_row(obj, obj->deriv_table, t);
+    for (long k = 0; k < obj->size; ++k) {
+        w[k] = ftab[k];
+        d[k] = dtab[k];
+    }
+}
+
+int
+tpl_initialize_quantized_interpolation(TPL_QuantizedInterpolation* obj,
+                                       TPL_InterpolationFunction const* base,
+                                       long steps)
+{
+    obj->func_table = NULL;
+    obj->deriv_table = NULL;
+    if (base == NULL || base->size < 1 || steps < 1) {
+        return -1;
+    }
+
+    /*
+     * Choose the stride so that the rows of the tables are aligned on the
+     * smallest power of 2 number of elements not less than the size of the
+     * interpolation function, or on a multiple of TPL_ALIGNMENT for large
+     * sizes.
+     */
+    long align = TPL_ALIGNMENT/sizeof(double);
+    long stride = 1;
+    while (stride < base->size && stride < align) {
+        stride *= 2;
+    }
+    if (stride < base->size) {
+        stride = ((base->size + align - 1)/align)*align;
+    }
+    size_t nbytes = (steps + 1)*stride*sizeof(double);
+    double* func_table = tpl_alloc(nbytes);
+    if (func_table == NULL) {
+        return -1;
+    }
+    double* deriv_table = tpl_alloc(nbytes);
+    if (deriv_table == NULL) {
+        tpl_free(func_table);
+        return -1;
+    }
+    obj->size = base->size;
+    obj->func = quantized_func;
+    obj->func_wgts = quantized_func_weights;
+    obj->deriv = quantized_deriv;
+    obj->deriv_wgts = quantized_deriv_weights;
+    obj->func_deriv_wgts = quantized_func_deriv_weights;
+    obj->base = base;
+    obj->steps = steps;
+    obj->stride = stride;
+    obj->func_table = func_table;
+    obj->deriv_table = deriv_table;
+    for (long r = 0; r <= steps; ++r) {
+        double t = (double)r/(double)steps;
+        double* fw = obj->func_table + r*stride;
+        double* dw = obj->deriv_table + r*stride;
+        TPL_INTERP_FUNC_WGTS(base, t, fw);
+        TPL_INTERP_DERIV_WGTS(base, t, dw);
+        for (long k = base->size; k < stride; ++k) {
+            fw[k] = 0.0;
+            dw[k] = 0.0;
+        }
+    }
+    return 0;
+}
+
+void
+tpl_finalize_quantized_interpolation(TPL_QuantizedInterpolation* obj)
+{
+    if (obj->func_table != NULL) {
+        tpl_free(obj->func_table);
+        obj->func_table = NULL;
+    }
+    if (obj->deriv_table != NULL) {
+        tpl_free(obj->deriv_table);
+        obj->deriv_table = NULL;
+    }
 }
@@ -0,0 +1,160 @@
+/*
+ * masked.c -
+ *
+ * Implementation of normalized convolution of images with bad pixels.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_MASKED_C
+#define _TPL_MASKED_C 1
+
+#include <stdint.h>
+
+#include "tpl-filter.h"
+#include "tpl-image.h"
+#include "tpl-inline.h"
+
+#define _tpl_index       long
+
+/* Assume column-major storage order. */
+#define dst(i1,i2)       dst[(i1) + dst_len1*(i2)]
+#define src(i1,i2)       src[(i1) + src_len1*(i2)]
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_MASKED_C defined */
+
+/*
+ * Load `m` values of the mask of a source row starting at linear index `off`
+ * with offset `k` and flat boundary conditions.  The result is 1 for valid
+ * pixels and 0 for bad ones.
+ */
+static void
+_tpl_private(load_mask_flat)(_tpl_index m,
+                             _tpl_float*restrict y,
+                             _tpl_index n,
+                             TPL_MaskType type,
+                             void const* msk,
+                             _tpl_index off,
+                             _tpl_index k)
+{
+    if (type == TPL_MASK_BITS) {
+        uint8_t const* bits = msk;
+        for (_tpl_index i = 0; i < m; ++i) {
+            _tpl_index p = off + pvc_min(pvc_max(i + k, 0), n - 1);
+            y[i] = (bits[p >> 3] >> (p & 7)) & 1;
+        }
+    } else {
+        uint8_t const* u8 = (uint8_t const*)msk + off;
+        _tpl_index i1 = pvc_min(pvc_max(-k, 0), m);
+        _tpl_index i2 = pvc_max(pvc_min(n - k, m), i1);
+        for (_tpl_index i = 0; i < i1; ++i) {
+            y[i] = (u8[0] != 0);
+        }
+        for (_tpl_index i = i1; i < i2; ++i) {
+            y[i] = (u8[i + k] != 0);
+        }
+        for (_tpl_index i = i2; i < m; ++i) {
+            y[i] = (u8[n - 1] != 0);
+        }
+    }
+}
+
+int
+_tpl_public(masked_filter_2d)(_tpl_float*restrict dst,
+                              _tpl_index dst_len1,
+                              _tpl_index dst_len2,
+                              _tpl_float const*restrict ker1,
+                              _tpl_index ker1_len,
+                              _tpl_float const*restrict ker2,
+                              _tpl_index ker2_len,
+                              _tpl_float const*restrict src,
+                              TPL_MaskType msk_type,
+                              void const* msk,
+                              _tpl_index src_len1,
+                              _tpl_index src_len2,
+                              _tpl_index k1,
+                              _tpl_index k2,
+                              _tpl_float*restrict wrk)
+{
+    if (msk_type != TPL_MASK_UINT8 && msk_type != TPL_MASK_BITS) {
+        return -1;
+    }
+    if (ker1_len < 1 || ker2_len < 1 || dst_len1 < 1 || dst_len2 < 1) {
+        return 0;
+    }
+
+    /* Ring buffers of the rows filtered along the 1st dimension for the
+       numerator (masked data) and the denominator (mask), followed by the
+       lines of masked data and mask. */
+    _tpl_index n = dst_len1;
+    _tpl_index lin_len = dst_len1 + ker1_len - 1;
+    _tpl_float* num = wrk;
+    _tpl_float* den = num + ker2_len*n;
+    _tpl_float* dat = den + ker2_len*n;
+    _tpl_float* wgt = dat + lin_len;
+
+    for (_tpl_index dst_i2 = 0; dst_i2 < dst_len2; ++dst_i2) {
+        /* Filter along the 1st dimension the source rows which are not yet
+           in the ring buffers. */
+        _tpl_index j0 = dst_i2 + k2;
+        _tpl_index jmin = (dst_i2 == 0 ? j0 : j0 + ker2_len - 1);
+        for (_tpl_index j = jmin; j < j0 + ker2_len; ++j) {
+            _tpl_index src_i2 = pvc_min(pvc_max(j, 0), src_len2 - 1);
+            _tpl_index slot = (j - j0 + dst_i2)%ker2_len;
+            tpl_load_contiguous_flat(lin_len, dat,
+                                     src_len1, &src(0, src_i2), k1);
+            _tpl_private(load_mask_flat)(lin_len, wgt, src_len1,
+                                         msk_type, msk, src_len1*src_i2, k1);
+            for (_tpl_index i = 0; i < lin_len; ++i) {
+                dat[i] *= wgt[i];
+            }
+            tpl_filter(ker1_len, n, num + slot*n, ker1, dat);
+            tpl_filter(ker1_len, n, den + slot*n, ker1, wgt);
+        }
+
+        /* Combine the rows along the 2nd dimension and normalize. */
+        _tpl_float* d = &dst(0, dst_i2);
+        _tpl_float* t = dat; /* denominator of the row */
+        for (_tpl_index q = 0; q < ker2_len; ++q) {
+            _tpl_index slot = (dst_i2 + q)%ker2_len;
+            _tpl_float const* a = num + slot*n;
+            _tpl_float const* b = den + slot*n;
+            _tpl_float w = ker2[q];
+            if (q == 0) {
+                for (_tpl_index i = 0; i < n; ++i) {
+                    d[i] = w*a[i];
+                    t[i] = w*b[i];
+                }
+            } else {
+                for (_tpl_index i = 0; i < n; ++i) {
+                    d[i] += w*a[i];
+                    t[i] += w*b[i];
+                }
+            }
+        }
+        for (_tpl_index i = 0; i < n; ++i) {
+            d[i] = (t[i] > 0 ? d[i]/t[i] : 0);
+        }
+    }
+    return 0;
+}
+
+#undef _tpl_float
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_MASKED_C */
@@ -0,0 +1,239 @@
+/*
+ * minmax.c -
+ *
+ * Implementation of sliding minimum and maximum filters (erosion and
+ * dilation) by the algorithm of van Herk (1992) and Gil & Werman (1993).
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_MINMAX_C
+#define _TPL_MINMAX_C 1
+
+#include "tpl-filter.h"
+#include "tpl-image.h"
+
+#define _tpl_index       long
+
+/* Number of lines filtered together by the 2D filters. */
+#define BLOCK 16
+
+/*
+ * Define a function `name` which applies a sliding `op` (min or max) of width
+ * `m` to `nb` interleaved lines.  Sample `j` of line `b` is `src[j*nb + b]`
+ * for `0 ≤ j < n + m - 1` and `dst[j*nb + b] = op(src[j*nb + b], ...,
+ * src[(j + m - 1)*nb + b])` for `0 ≤ j < n`.  The source is divided in
+ * blocks of `m` samples, `g` is the running `op` from the start of each block
+ * and `h` from the end of each block so that each output is `op(h[j],
+ * g[j+m-1])`.  Array `dst` may be the same as `src`.  Workspace `wrk` must
+ * have `(n + m)*nb` elements.
+ */
+#define _TPL_MINMAX_LINES(name, op)                                     \
+    static inline void                                                  \
+    name(_tpl_index m,                                                  \
+         _tpl_index n,                                                  \
+         _tpl_index nb,                                                 \
+         _tpl_float* dst,                                               \
+         _tpl_float const* src,                                         \
+         _tpl_float*restrict wrk)                                       \
+    {                                                                   \
+        _tpl_index len = n + m - 1;                                     \
+        _tpl_float* g = wrk;                                            \
+        _tpl_float* h = wrk + len*nb;                                   \
+        for (_tpl_index j = 0; j < len; ++j) {                          \
+            _tpl_float const* s = src + j*nb;                           \
+            _tpl_float* gj = g + j*nb;                                  \
+            if (j%m == 0) {                                             \
+                for (_tpl_index b = 0; b < nb; ++b) {                   \
+                    gj[b] = s[b];                                       \
+                }                                                       \
+            } else {                                                    \
+                _tpl_float const* gp = gj - nb;                         \
+                for (_tpl_index b = 0; b < nb; ++b) {                   \
+                    gj[b] = op(gp[b], s[b]);                            \
+                }                                                       \
+            }                                                           \
+        }                                                               \
+        for (_tpl_index j = len - 1; j >= 0; --j) {                     \
+            _tpl_float const* s = src + j*nb;                           \
+            if (j%m == m - 1 || j == len - 1) {                         \
+                for (_tpl_index b = 0; b < nb; ++b) {                   \
+                    h[b] = s[b];                                        \
+                }                                                       \
+            } else {                                                    \
+                for (_tpl_index b = 0; b < nb; ++b) {                   \
+                    h[b] = op(h[b], s[b]);                              \
+                }                                                       \
+            }                                                           \
+            if (j < n) {                                                \
+                _tpl_float* d = dst + j*nb;                             \
+                _tpl_float const* gj = g + (j + m - 1)*nb;              \
+                for (_tpl_index b = 0; b < nb; ++b) {                   \
+                    d[b] = op(h[b], gj[b]);                             \
+                }                                                       \
+            }                                                           \
+        }                                                               \
+    }
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_MINMAX_C defined */
+
+_TPL_MINMAX_LINES(_tpl_private(min_lines), pvc_min)
+_TPL_MINMAX_LINES(_tpl_private(max_lines), pvc_max)
+
+void
+_tpl_public(min_filter)(_tpl_index m,
+                        _tpl_index n,
+                        _tpl_float* dst,
+                        _tpl_float const* src,
+                        _tpl_float*restrict wrk)
+{
+    if (m >= 1 && n >= 1) {
+        _tpl_private(min_lines)(m, n, 1, dst, src, wrk);
+    }
+}
+
+void
+_tpl_public(max_filter)(_tpl_index m,
+                        _tpl_index n,
+                        _tpl_float* dst,
+                        _tpl_float const* src,
+                        _tpl_float*restrict wrk)
+{
+    if (m >= 1 && n >= 1) {
+        _tpl_private(max_lines)(m, n, 1, dst, src, wrk);
+    }
+}
+
+/*
+ * Apply sliding minimum (`op = 0`) or maximum (`op = 1`) along a dimension of
+ * an image.  Blocks of `BLOCK` destination lines are gathered (with flat
+ * boundaries) into the workspace, interleaved so that the filter operates on
+ * vectors of `BLOCK` values, then scattered into the destination.
+ */
+static void
+_tpl_private(minmax_2d)(int op,
+                        int dim,
+                        _tpl_float*restrict dst,
+                        _tpl_index dst_len1,
+                        _tpl_index dst_len2,
+                        _tpl_index box_len,
+                        _tpl_float const*restrict src,
+                        _tpl_index src_len1,
+                        _tpl_index src_len2,
+                        _tpl_index k1,
+                        _tpl_index k2,
+                        _tpl_float*restrict wrk)
+{
+    if (box_len < 1 || dst_len1 < 1 || dst_len2 < 1) {
+        return;
+    }
+    /* Lengths of the lines and their strides in the destination, number of
+       lines and their strides. */
+    _tpl_index n, dst_inc, src_inc, src_len, k, nlines, dst_step;
+    if (dim == 1) {
+        n = dst_len1;
+        dst_inc = 1;
+        src_inc = 1;
+        src_len = src_len1;
+        k = k1;
+        nlines = dst_len2;
+        dst_step = dst_len1;
+    } else {
+        n = dst_len2;
+        dst_inc = dst_len1;
+        src_inc = src_len1;
+        src_len = src_len2;
+        k = k2;
+        nlines = dst_len1;
+        dst_step = 1;
+    }
+    _tpl_index len = n + box_len - 1;
+    _tpl_float* blk = wrk;
+    _tpl_float* tmp = wrk + len*BLOCK;
+    for (_tpl_index l = 0; l < nlines; l += BLOCK) {
+        _tpl_index nb = pvc_min(nlines - l, BLOCK);
+        _tpl_float const* line[BLOCK];
+        for (_tpl_index b = 0; b < BLOCK; ++b) {
+            /* Partial blocks are padded by repeating the last line. */
+            _tpl_index i = l + pvc_min(b, nb - 1);
+            if (dim == 1) {
+                line[b] = src + src_len1*pvc_min(pvc_max(i + k2, 0),
+                                                 src_len2 - 1);
+            } else {
+                line[b] = src + pvc_min(pvc_max(i + k1, 0), src_len1 - 1);
+            }
+        }
+        for (_tpl_index j = 0; j < len; ++j) {
+            _tpl_index off = src_inc*pvc_min(pvc_max(j + k, 0), src_len - 1);
+            _tpl_float* r = blk + j*BLOCK;
+            for (_tpl_index b = 0; b < BLOCK; ++b) {
+                r[b] = line[b][off];
+            }
+        }
+        if (op == 0) {
+            _tpl_private(min_lines)(box_len, n, BLOCK, blk, blk, tmp);
+        } else {
+            _tpl_private(max_lines)(box_len, n, BLOCK, blk, blk, tmp);
+        }
+        for (_tpl_index b = 0; b < nb; ++b) {
+            _tpl_float* d = dst + dst_step*(l + b);
+            for (_tpl_index j = 0; j < n; ++j) {
+                d[dst_inc*j] = blk[j*BLOCK + b];
+            }
+        }
+    }
+}
+
+void
+_tpl_public(min_filter_2d)(int dim,
+                           _tpl_float*restrict dst,
+                           _tpl_index dst_len1,
+                           _tpl_index dst_len2,
+                           _tpl_index box_len,
+                           _tpl_float const*restrict src,
+                           _tpl_index src_len1,
+                           _tpl_index src_len2,
+                           _tpl_index k1,
+                           _tpl_index k2,
+                           _tpl_float*restrict wrk)
+{
+    _tpl_private(minmax_2d)(0, dim, dst, dst_len1, dst_len2, box_len,
+                            src, src_len1, src_len2, k1, k2, wrk);
+}
+
+void
+_tpl_public(max_filter_2d)(int dim,
+                           _tpl_float*restrict dst,
+                           _tpl_index dst_len1,
+                           _tpl_index dst_len2,
+                           _tpl_index box_len,
+                           _tpl_float const*restrict src,
+                           _tpl_index src_len1,
+                           _tpl_index src_len2,
+                           _tpl_index k1,
+                           _tpl_index k2,
+                           _tpl_float*restrict wrk)
+{
+    _tpl_private(minmax_2d)(1, dim, dst, dst_len1, dst_len2, box_len,
+                            src, src_len1, src_len2, k1, k2, wrk);
+}
+
+#undef _tpl_float
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_MINMAX_C */
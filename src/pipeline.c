@@ -0,0 +1,301 @@
+/*
+ * pipeline.c -
+ *
+ * Implementation of the streaming of frames in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE 1 /* for pthread_setaffinity_np */
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define cpu_relax()  _mm_pause()
+#else
+#  define cpu_relax()  ((void)0)
+#endif
+
+#include "tpl-alloc.h"
+#include "tpl-pipeline.h"
+
+#define CACHE_LINE 64
+
+/*
+ * The producer owns `head` (number of published slots) and the consumer
+ * owns `tail` (number of released slots).  Each side keeps a cached copy of
+ * the index of the other side which is only reloaded when the ring looks
+ * full (or empty) so that the cache line of the other side is rarely
+ * touched.  Release stores and acquire loads of the indices order the
+ * accesses to the contents of the slots.
+ */
+struct TPL_Ring {
+    _Alignas(CACHE_LINE) unsigned long head;
+    unsigned long tail_cache;
+    _Alignas(CACHE_LINE) unsigned long tail;
+    unsigned long head_cache;
+    _Alignas(CACHE_LINE) unsigned long nslots;
+    size_t slot_size;
+    char* data;
+};
+
+#define LOAD_ACQUIRE(var)        __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(var, val)  __atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+
+TPL_Ring*
+tpl_create_ring(long nslots, size_t slot_size)
+{
+    if (nslots < 1 || slot_size < 1) {
+        errno = EINVAL;
+        return NULL;
+    }
+    slot_size = ((slot_size + CACHE_LINE - 1)/CACHE_LINE)*CACHE_LINE;
+    TPL_Ring* ring = tpl_alloc(sizeof(TPL_Ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->head = 0;
+    ring->tail_cache = 0;
+    ring->tail = 0;
+    ring->head_cache = 0;
+    ring->nslots = nslots;
+    ring->slot_size = slot_size;
+    ring->data = tpl_alloc(nslots*slot_size);
+    if (ring->data == NULL) {
+        tpl_free(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+void
+tpl_destroy_ring(TPL_Ring* ring)
+{
+    if (ring != NULL) {
+        tpl_free(ring->data);
+        tpl_free(ring);
+    }
+}
+
+void*
+tpl_ring_acquire(TPL_Ring* ring)
+{
+    unsigned long head = ring->head;
+    if (head - ring->tail_cache >= ring->nslots) {
+        ring->tail_cache = LOAD_ACQUIRE(ring->tail);
+        if (head - ring->tail_cache >= ring->nslots) {
+            return NULL;
+        }
+    }
+    return ring->data + (head%ring->nslots)*ring->slot_size;
+}
+
+void
+tpl_ring_publish(TPL_Ring* ring)
+{
+    STORE_RELEASE(ring->head, ring->head + 1);
+}
+
+void*
+tpl_ring_peek(TPL_Ring* ring)
+{
+    unsigned long tail = ring->tail;
+    if (tail == ring->head_cache) {
+        ring->head_cache = LOAD_ACQUIRE(ring->head);
+        if (tail == ring->head_cache) {
+            return NULL;
+        }
+    }
+    return ring->data + (tail%ring->nslots)*ring->slot_size;
+}
+
+void
+tpl_ring_release(TPL_Ring* ring)
+{
+    STORE_RELEASE(ring->tail, ring->tail + 1);
+}
+
+typedef struct Stage {
+    TPL_Pipeline* pipe;
+    TPL_Stage* func;
+    void* arg;
+    TPL_Ring* input;
+    TPL_Ring* output;
+} Stage;
+
+struct TPL_Pipeline {
+    int quit;
+    long nstages;
+    long nthreads; /* number of running threads */
+    long spin_ns;
+    pthread_t* threads;
+    Stage* stages;
+    TPL_Ring** rings; /* intermediate rings */
+};
+
+static long long
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000000000LL*ts.tv_sec + ts.tv_nsec;
+}
+
+/*
+ * Wait for a slot to process (if `peek` is true) or to fill.  Spins for at
+ * most `spin_ns` nanoseconds, then sleeps for short periods.  Returns `NULL`
+ * if the pipeline is being destroyed.
+ */
+static void*
+wait_slot(TPL_Pipeline* pipe, TPL_Ring* ring, int peek)
+{
+    void* slot = (peek ? tpl_ring_peek(ring) : tpl_ring_acquire(ring));
+    if (slot != NULL) {
+        return slot;
+    }
+    long long deadline = now_ns() + pipe->spin_ns;
+    int spinning = 1;
+    while (1) {
+        for (int k = 0; k < 64; ++k) {
+            if (spinning) {
+                cpu_relax();
+            } else {
+                struct timespec ts = {0, 20000};
+                nanosleep(&ts, NULL);
+            }
+            slot = (peek ? tpl_ring_peek(ring) : tpl_ring_acquire(ring));
+            if (slot != NULL) {
+                return slot;
+            }
+        }
+        if (__atomic_load_n(&pipe->quit, __ATOMIC_RELAXED)) {
+            return NULL;
+        }
+        if (spinning && now_ns() >= deadline) {
+            spinning = 0;
+        }
+    }
+}
+
+static void*
+stage_main(void* arg)
+{
+    Stage* s = arg;
+    while (1) {
+        void const* src = wait_slot(s->pipe, s->input, 1);
+        if (src == NULL) {
+            break;
+        }
+        void* dst = wait_slot(s->pipe, s->output, 0);
+        if (dst == NULL) {
+            break;
+        }
+        s->func(s->arg, dst, src);
+        tpl_ring_publish(s->output);
+        tpl_ring_release(s->input);
+    }
+    return NULL;
+}
+
+TPL_Pipeline*
+tpl_create_pipeline(long nstages,
+                    TPL_Stage* const stages[],
+                    void* const args[],
+                    size_t const sizes[],
+                    long depth,
+                    TPL_Ring* input,
+                    TPL_Ring* output,
+                    int const* cpus,
+                    long spin_ns)
+{
+    if (nstages < 1 || depth < 1 || spin_ns < 0 ||
+        input == NULL || output == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    TPL_Pipeline* pipe = calloc(1, sizeof(TPL_Pipeline));
+    if (pipe == NULL) {
+        return NULL;
+    }
+    pipe->nstages = nstages;
+    pipe->spin_ns = spin_ns;
+    pipe->threads = malloc(nstages*sizeof(pthread_t));
+    pipe->stages = malloc(nstages*sizeof(Stage));
+    pipe->rings = calloc(nstages, sizeof(TPL_Ring*));
+    if (pipe->threads == NULL || pipe->stages == NULL || pipe->rings == NULL) {
+        tpl_destroy_pipeline(pipe);
+        return NULL;
+    }
+    for (long s = 1; s < nstages; ++s) {
+        pipe->rings[s] = tpl_create_ring(depth, sizes[s-1]);
+        if (pipe->rings[s] == NULL) {
+            tpl_destroy_pipeline(pipe);
+            return NULL;
+        }
+    }
+    for (long s = 0; s < nstages; ++s) {
+        Stage* stg = &pipe->stages[s];
+        stg->pipe = pipe;
+        stg->func = stages[s];
+        stg->arg = args[s];
+        stg->input = (s == 0 ? input : pipe->rings[s]);
+        stg->output = (s == nstages - 1 ? output : pipe->rings[s+1]);
+    }
+    for (long s = 0; s < nstages; ++s) {
+        int code = pthread_create(&pipe->threads[s], NULL, stage_main,
+                                  &pipe->stages[s]);
+        if (code != 0) {
+            tpl_destroy_pipeline(pipe);
+            errno = code;
+            return NULL;
+        }
+        pipe->nthreads = s + 1;
+        if (cpus != NULL) {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[s], &set);
+            code = pthread_setaffinity_np(pipe->threads[s],
+                                          sizeof(set), &set);
+#else
+            code = ENOSYS;
+#endif
+            if (code != 0) {
+                tpl_destroy_pipeline(pipe);
+                errno = code;
+                return NULL;
+            }
+        }
+    }
+    return pipe;
+}
+
+void
+tpl_destroy_pipeline(TPL_Pipeline* pipe)
+{
+    if (pipe != NULL) {
+        __atomic_store_n(&pipe->quit, 1, __ATOMIC_RELAXED);
+        for (long s = 0; s < pipe->nthreads; ++s) {
+            pthread_join(pipe->threads[s], NULL);
+        }
+        if (pipe->rings != NULL) {
+            for (long s = 1; s < pipe->nstages; ++s) {
+                tpl_destroy_ring(pipe->rings[s]);
+            }
+        }
+        free(pipe->threads);
+        free(pipe->stages);
+        free(pipe->rings);
+        free(pipe);
+    }
+}
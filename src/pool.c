@@ -0,0 +1,356 @@
+/*
+ * pool.c -
+ *
+ * Implementation of the pool of threads of TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE 1 /* for pthread_setaffinity_np */
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef __linux__
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define cpu_relax()  _mm_pause()
+#else
+#  define cpu_relax()  ((void)0)
+#endif
+
+#include "tpl-alloc.h"
+#include "tpl-pool.h"
+
+/*
+ * Synchronization is done by two futex words: `generation` is incremented by
+ * the caller to start a new task, `remaining` is the number of workers which
+ * have not yet completed the current task.  A waiting thread spins on its
+ * word for at most `spin_ns` nanoseconds, then declares itself as sleeping
+ * (in `sleepers` for the workers, in `caller_sleeping` for the caller) and
+ * sleeps on the futex.  The waker only issues a system call when a thread
+ * is sleeping.  Sequentially consistent ordering of the store of the futex
+ * word and of the load of the sleeping counter (and conversely) prevents
+ * lost wake-ups, and the futex call rechecks the word in the kernel.
+ */
+struct TPL_Pool {
+    int generation;       /* futex word: task counter */
+    int remaining;        /* futex word: number of busy workers */
+    int sleepers;         /* number of workers sleeping on `generation` */
+    int caller_sleeping;  /* caller is sleeping on `remaining` */
+    int quit;             /* workers must exit */
+    TPL_Task* task;
+    void* arg;
+    long nworkers;
+    long spin_ns;
+    pthread_t* threads;
+    struct Worker* workers;
+    struct Deque* deques;
+};
+
+/*
+ * Jobs of a batch not yet run by a thread.  The remaining jobs `lo:hi-1` are
+ * packed in a single word so that the owner (taking `lo`) and the thieves
+ * (taking `hi-1`) only need a compare-and-swap.  Each deque has its own
+ * cache line to avoid false sharing.
+ */
+typedef struct Deque {
+    _Alignas(64) unsigned long long range;
+} Deque;
+
+#define RANGE(lo, hi)  (((unsigned long long)(hi) << 32) | (unsigned)(lo))
+
+typedef struct Worker {
+    TPL_Pool* pool;
+    long rank;
+} Worker;
+
+#define LOAD(var)  __atomic_load_n(&(var), __ATOMIC_SEQ_CST)
+
+static long long
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000000000LL*ts.tv_sec + ts.tv_nsec;
+}
+
+static void
+futex_wait(int* addr, int val)
+{
+#ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+    (void)addr;
+    (void)val;
+    sched_yield();
+#endif
+}
+
+static void
+futex_wake(int* addr)
+{
+#ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, (int)0x7fffffff,
+            NULL, NULL, 0);
+#else
+    (void)addr;
+#endif
+}
+
+/*
+ * Spin until `*addr != val` for at most `spin_ns` nanoseconds.  Returns the
+ * last value of `*addr`.  The clock is only read every few iterations.
+ */
+static int
+spin_while_equal(int* addr, int val, long spin_ns)
+{
+    int cur = LOAD(*addr);
+    if (cur != val || spin_ns <= 0) {
+        return cur;
+    }
+    long long deadline = now_ns() + spin_ns;
+    while (1) {
+        for (int k = 0; k < 64; ++k) {
+            cpu_relax();
+            cur = LOAD(*addr);
+            if (cur != val) {
+                return cur;
+            }
+        }
+        if (now_ns() >= deadline) {
+            return cur;
+        }
+    }
+}
+
+static void*
+worker_main(void* arg)
+{
+    Worker* w = arg;
+    TPL_Pool* pool = w->pool;
+    int seen = 0; /* generation of last task */
+    while (1) {
+        int gen = spin_while_equal(&pool->generation, seen, pool->spin_ns);
+        if (gen == seen) {
+            __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+            if (LOAD(pool->generation) == seen) {
+                futex_wait(&pool->generation, seen);
+            }
+            __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        seen = gen;
+        if (LOAD(pool->quit)) {
+            break;
+        }
+        pool->task(pool->arg, w->rank, pool->nworkers + 1);
+        if (__atomic_sub_fetch(&pool->remaining, 1, __ATOMIC_SEQ_CST) == 0 &&
+            LOAD(pool->caller_sleeping)) {
+            futex_wake(&pool->remaining);
+        }
+    }
+    return NULL;
+}
+
+/* Start a new generation and wake up sleeping workers. */
+static void
+start_generation(TPL_Pool* pool)
+{
+    __atomic_store_n(&pool->remaining, (int)pool->nworkers, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&pool->generation, 1, __ATOMIC_SEQ_CST);
+    if (LOAD(pool->sleepers) > 0) {
+        futex_wake(&pool->generation);
+    }
+}
+
+/* Wait for all workers to complete the current generation. */
+static void
+wait_workers(TPL_Pool* pool)
+{
+    int cur = LOAD(pool->remaining);
+    while (cur != 0) {
+        int val = cur;
+        cur = spin_while_equal(&pool->remaining, val, pool->spin_ns);
+        if (cur == val) {
+            __atomic_store_n(&pool->caller_sleeping, 1, __ATOMIC_SEQ_CST);
+            if (LOAD(pool->remaining) == val) {
+                futex_wait(&pool->remaining, val);
+            }
+            __atomic_store_n(&pool->caller_sleeping, 0, __ATOMIC_SEQ_CST);
+            cur = LOAD(pool->remaining);
+        }
+    }
+}
+
+TPL_Pool*
+tpl_create_pool(long nworkers, int const* cpus, long spin_ns)
+{
+    if (nworkers < 0 || spin_ns < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    TPL_Pool* pool = calloc(1, sizeof(TPL_Pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->spin_ns = spin_ns;
+    if (nworkers > 0) {
+        pool->threads = malloc(nworkers*sizeof(pthread_t));
+        pool->workers = malloc(nworkers*sizeof(Worker));
+        pool->deques = tpl_alloc((nworkers + 1)*sizeof(Deque));
+        if (pool->threads == NULL || pool->workers == NULL ||
+            pool->deques == NULL) {
+            tpl_destroy_pool(pool);
+            return NULL;
+        }
+    }
+    for (long r = 1; r <= nworkers; ++r) {
+        Worker* w = &pool->workers[r-1];
+        w->pool = pool;
+        w->rank = r;
+        int code = pthread_create(&pool->threads[r-1], NULL, worker_main, w);
+        if (code != 0) {
+            tpl_destroy_pool(pool);
+            errno = code;
+            return NULL;
+        }
+        pool->nworkers = r;
+        if (cpus != NULL) {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[r-1], &set);
+            code = pthread_setaffinity_np(pool->threads[r-1],
+                                          sizeof(set), &set);
+#else
+            code = ENOSYS;
+#endif
+            if (code != 0) {
+                tpl_destroy_pool(pool);
+                errno = code;
+                return NULL;
+            }
+        }
+    }
+    return pool;
+}
+
+void
+tpl_destroy_pool(TPL_Pool* pool)
+{
+    if (pool != NULL) {
+        if (pool->nworkers > 0) {
+            __atomic_store_n(&pool->quit, 1, __ATOMIC_SEQ_CST);
+            __atomic_add_fetch(&pool->generation, 1, __ATOMIC_SEQ_CST);
+            futex_wake(&pool->generation);
+            for (long r = 0; r < pool->nworkers; ++r) {
+                pthread_join(pool->threads[r], NULL);
+            }
+        }
+        free(pool->threads);
+        free(pool->workers);
+        tpl_free(pool->deques);
+        free(pool);
+    }
+}
+
+long
+tpl_pool_size(TPL_Pool const* pool)
+{
+    return (pool == NULL ? 1 : pool->nworkers + 1);
+}
+
+void
+tpl_pool_run(TPL_Pool* pool, TPL_Task* task, void* arg)
+{
+    if (pool == NULL || pool->nworkers < 1) {
+        task(arg, 0, 1);
+        return;
+    }
+    pool->task = task;
+    pool->arg = arg;
+    start_generation(pool);
+    task(arg, 0, pool->nworkers + 1);
+    wait_workers(pool);
+}
+
+/*
+ * Take a job from a deque, from the front for the owner, from the back for
+ * a thief.  Returns 0 if the deque is empty.  As no jobs are added during a
+ * batch, an empty deque remains empty.
+ */
+static int
+take_job(Deque* d, int owner, long* job)
+{
+    unsigned long long r = LOAD(d->range);
+    while (1) {
+        unsigned lo = (unsigned)r, hi = (unsigned)(r >> 32);
+        if (lo >= hi) {
+            return 0;
+        }
+        unsigned long long s = (owner ? RANGE(lo + 1, hi) : RANGE(lo, hi - 1));
+        if (__atomic_compare_exchange_n(&d->range, &r, s, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            *job = (owner ? lo : hi - 1);
+            return 1;
+        }
+    }
+}
+
+typedef struct Batch {
+    Deque* deques;
+    TPL_Job* job;
+    void* arg;
+} Batch;
+
+static void
+run_batch(void* arg, long rank, long nranks)
+{
+    Batch* b = arg;
+    long j;
+    while (take_job(&b->deques[rank], 1, &j)) {
+        b->job(b->arg, j, rank);
+    }
+    for (long k = 1; k < nranks; ++k) {
+        Deque* victim = &b->deques[(rank + k)%nranks];
+        while (take_job(victim, 0, &j)) {
+            b->job(b->arg, j, rank);
+        }
+    }
+}
+
+void
+tpl_pool_run_jobs(TPL_Pool* pool, long njobs, TPL_Job* job, void* arg)
+{
+    if (njobs < 1) {
+        return;
+    }
+    if (pool == NULL || pool->nworkers < 1) {
+        for (long j = 0; j < njobs; ++j) {
+            job(arg, j, 0);
+        }
+        return;
+    }
+    long nranks = pool->nworkers + 1;
+    for (long r = 0; r < nranks; ++r) {
+        long first, last;
+        tpl_pool_split(njobs, r, nranks, &first, &last);
+        __atomic_store_n(&pool->deques[r].range, RANGE(first, last),
+                         __ATOMIC_RELAXED);
+    }
+    Batch b = {.deques = pool->deques, .job = job, .arg = arg};
+    tpl_pool_run(pool, run_batch, &b); /* publishes the deques */
+}
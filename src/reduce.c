@@ -0,0 +1,105 @@
+/*
+ * reduce.c -
+ *
+ * Implementation of reductions in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_REDUCE_C
+#define _TPL_REDUCE_C 1
+
+#include <math.h>
+#include <pvc.h>
+
+#include "tpl-reduce.h"
+
+#define _tpl_index       long
+
+void
+tpl_initialize_moments(TPL_Moments* mom)
+{
+    mom->count = 0;
+    mom->sum = 0.0;
+    mom->min = +INFINITY;
+    mom->max = -INFINITY;
+    mom->sum_1 = 0.0;
+    mom->sum_2 = 0.0;
+    mom->sum_11 = 0.0;
+    mom->sum_12 = 0.0;
+    mom->sum_22 = 0.0;
+}
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#include __FILE__
+
+#else /* _TPL_REDUCE_C defined */
+
+void
+_tpl_public(update_moments)(TPL_Moments* mom,
+                            _tpl_index n,
+                            _tpl_float const* v,
+                            int dim,
+                            _tpl_index i1,
+                            _tpl_index i2)
+{
+    if (n < 1) {
+        return;
+    }
+    /* Sums along the line with `t = k` the index in the line (computed in
+       double precision to preserve the moments of large images). */
+    double s = 0, st = 0, stt = 0;
+    _tpl_float vmin = v[0], vmax = v[0];
+    for (_tpl_index k = 0; k < n; ++k) {
+        _tpl_float x = v[k];
+        double t = (double)k;
+        s += x;
+        st += x*t;
+        stt += x*t*t;
+        vmin = pvc_min(vmin, x);
+        vmax = pvc_max(vmax, x);
+    }
+    /* Shift the line indices to the pixel indices: along the line `i = i0 +
+       t` and the other index `j` is fixed. */
+    double i0 = (dim == 1 ? i1 : i2);
+    double j  = (dim == 1 ? i2 : i1);
+    double si = st + i0*s;
+    double sii = stt + 2*i0*st + i0*i0*s;
+    if (mom->count > 0) {
+        /* Avoid comparisons with infinities which may be optimized out by
+           fast-math. */
+        mom->min = pvc_min(mom->min, vmin);
+        mom->max = pvc_max(mom->max, vmax);
+    } else {
+        mom->min = vmin;
+        mom->max = vmax;
+    }
+    mom->count += n;
+    mom->sum += s;
+    mom->sum_12 += j*si;
+    if (dim == 1) {
+        mom->sum_1 += si;
+        mom->sum_2 += j*s;
+        mom->sum_11 += sii;
+        mom->sum_22 += j*j*s;
+    } else {
+        mom->sum_1 += j*s;
+        mom->sum_2 += si;
+        mom->sum_11 += j*j*s;
+        mom->sum_22 += sii;
+    }
+}
+
+#undef _tpl_float
+#undef _tpl_public
+
+#endif /* _TPL_REDUCE_C */
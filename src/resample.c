@@ -0,0 +1,255 @@
+/*
+ * resample.c -
+ *
+ * Implementation of 1-dimensional resampling.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_RESAMPLE_C
+#define _TPL_RESAMPLE_C 1
+
+#include <math.h>
+#include "tpl-warp.h"
+#include "tpl-inline.h"
+#include "tpl-pool.h"
+#include "tpl-stats.h"
+
+#define _tpl_index       long
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_RESAMPLE_C defined */
+
+int
+_tpl_public(resample_1d)(_tpl_float*restrict dst,
+                         _tpl_index dst_len,
+                         _tpl_float const*restrict src,
+                         _tpl_index src_len,
+                         double off,
+                         double step,
+                         TPL_InterpolationFunction const* ker)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    _tpl_index size = ker->size;
+    _tpl_index h = (size - 1)/2;
+    double w[TPL_INTERP_MAX_SIZE];
+    for (_tpl_index j = 0; j < dst_len; ++j) {
+        double x = off + step*j;
+        double fl = floor(x);
+        TPL_INTERP_FUNC_WGTS(ker, x - fl, w);
+        _tpl_index i = (_tpl_index)fl - h;
+        double s = 0;
+        if (i >= 0 && i + size <= src_len) {
+            for (_tpl_index k = 0; k < size; ++k) {
+                s += w[k]*src[i + k];
+            }
+        } else {
+            for (_tpl_index k = 0; k < size; ++k) {
+                s += w[k]*src[pvc_min(pvc_max(i + k, 0), src_len - 1)];
+            }
+        }
+        dst[j] = s;
+    }
+    TPL_STATS_END(TPL_STATS_RESAMPLE_1D, dst_len);
+    return 0;
+}
+
+/*
+ * Apply the adjoint of the resampling for the part `first ≤ i < last` of the
+ * destination.  Only the source elements whose interpolation footprint
+ * intersects this part (after the flat boundary conditions) are visited, in
+ * increasing order, and only the destination elements of the part are
+ * updated.  Hence, the parts can be computed by different threads and the
+ * result is the same whatever the splitting.
+ */
+static void
+_tpl_private(resample_1d_adj_part)(_tpl_float*restrict dst,
+                                   _tpl_index dst_len,
+                                   _tpl_index first,
+                                   _tpl_index last,
+                                   _tpl_float const*restrict src,
+                                   _tpl_index src_len,
+                                   double off,
+                                   double step,
+                                   TPL_InterpolationFunction const* ker)
+{
+    _tpl_index size = ker->size;
+    _tpl_index h = (size - 1)/2;
+    double w[TPL_INTERP_MAX_SIZE];
+    for (_tpl_index i = first; i < last; ++i) {
+        dst[i] = 0;
+    }
+    /* Range of source indices `j` whose footprint `floor(x) - h + k` for `x =
+       off + step*j` and `k = 0, ..., size - 1` intersects the part, that is
+       `first + h - size + 1 ≤ x` (unless `first = 0`) and `x < last + h`
+       (unless `last = dst_len`), with a margin for rounding errors. */
+    _tpl_index j0 = 0, j1 = src_len;
+    if (step != 0) {
+        double t_lo = (first + h - size + 1 - off)/step;
+        double t_hi = (last + h - off)/step;
+        int lo_bound = (step > 0 ? first > 0 : last < dst_len);
+        int hi_bound = (step > 0 ? last < dst_len : first > 0);
+        double lo = floor(step > 0 ? t_lo : t_hi) - 1;
+        double hi = ceil(step > 0 ? t_hi : t_lo) + 2;
+        if (lo_bound) {
+            j0 = (lo <= 0 ? 0 : lo >= src_len ? src_len : (_tpl_index)lo);
+        }
+        if (hi_bound) {
+            j1 = (hi <= 0 ? 0 : hi >= src_len ? src_len : (_tpl_index)hi);
+        }
+    }
+    for (_tpl_index j = j0; j < j1; ++j) {
+        double x = off + step*j;
+        double fl = floor(x);
+        _tpl_index i = (_tpl_index)fl - h;
+        double v = src[j];
+        TPL_INTERP_FUNC_WGTS(ker, x - fl, w);
+        if (i >= first && i + size <= last) {
+            for (_tpl_index k = 0; k < size; ++k) {
+                dst[i + k] += w[k]*v;
+            }
+        } else {
+            for (_tpl_index k = 0; k < size; ++k) {
+                _tpl_index l = pvc_min(pvc_max(i + k, 0), dst_len - 1);
+                if (l >= first && l < last) {
+                    dst[l] += w[k]*v;
+                }
+            }
+        }
+    }
+}
+
+int
+_tpl_public(resample_1d_adj)(_tpl_float*restrict dst,
+                             _tpl_index dst_len,
+                             _tpl_float const*restrict src,
+                             _tpl_index src_len,
+                             double off,
+                             double step,
+                             TPL_InterpolationFunction const* ker)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    _tpl_private(resample_1d_adj_part)(dst, dst_len, 0, dst_len,
+                                       src, src_len, off, step, ker);
+    TPL_STATS_END(TPL_STATS_RESAMPLE_1D_ADJ, src_len);
+    return 0;
+}
+
+/*
+ * Arguments of tpl_resample_1d_parallel() and tpl_resample_1d_adj_parallel()
+ * for the workers.
+ */
+struct _tpl_private(resample_1d_task) {
+    _tpl_float* dst;
+    _tpl_index dst_len;
+    _tpl_float const* src;
+    _tpl_index src_len;
+    double off, step;
+    TPL_InterpolationFunction const* ker;
+};
+
+/*
+ * Each thread resamples a block of consecutive destination elements, the
+ * offset is shifted accordingly.
+ */
+static void
+_tpl_private(resample_1d_worker)(void* arg, long rank, long nranks)
+{
+    struct _tpl_private(resample_1d_task) const* t = arg;
+    _tpl_index first, last;
+    tpl_pool_split(t->dst_len, rank, nranks, &first, &last);
+    if (first < last) {
+        _tpl_public(resample_1d)(t->dst + first, last - first,
+                                 t->src, t->src_len,
+                                 t->off + t->step*first, t->step, t->ker);
+    }
+}
+
+int
+_tpl_public(resample_1d_parallel)(TPL_Pool* pool,
+                                  _tpl_float*restrict dst,
+                                  _tpl_index dst_len,
+                                  _tpl_float const*restrict src,
+                                  _tpl_index src_len,
+                                  double off,
+                                  double step,
+                                  TPL_InterpolationFunction const* ker)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    struct _tpl_private(resample_1d_task) t = {
+        .dst = dst, .dst_len = dst_len, .src = src, .src_len = src_len,
+        .off = off, .step = step, .ker = ker
+    };
+    tpl_pool_run(pool, _tpl_private(resample_1d_worker), &t);
+    TPL_STATS_END(TPL_STATS_RESAMPLE_1D_PARALLEL, dst_len);
+    return 0;
+}
+
+/*
+ * Each thread computes a block of consecutive destination elements of the
+ * adjoint, the source elements contributing to two blocks are visited by the
+ * two threads.
+ */
+static void
+_tpl_private(resample_1d_adj_worker)(void* arg, long rank, long nranks)
+{
+    struct _tpl_private(resample_1d_task) const* t = arg;
+    _tpl_index first, last;
+    tpl_pool_split(t->dst_len, rank, nranks, &first, &last);
+    if (first < last) {
+        _tpl_private(resample_1d_adj_part)(t->dst, t->dst_len, first, last,
+                                           t->src, t->src_len,
+                                           t->off, t->step, t->ker);
+    }
+}
+
+int
+_tpl_public(resample_1d_adj_parallel)(TPL_Pool* pool,
+                                      _tpl_float*restrict dst,
+                                      _tpl_index dst_len,
+                                      _tpl_float const*restrict src,
+                                      _tpl_index src_len,
+                                      double off,
+                                      double step,
+                                      TPL_InterpolationFunction const* ker)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    struct _tpl_private(resample_1d_task) t = {
+        .dst = dst, .dst_len = dst_len, .src = src, .src_len = src_len,
+        .off = off, .step = step, .ker = ker
+    };
+    tpl_pool_run(pool, _tpl_private(resample_1d_adj_worker), &t);
+    TPL_STATS_END(TPL_STATS_RESAMPLE_1D_ADJ_PARALLEL, src_len);
+    return 0;
+}
+
+#undef _tpl_float
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_RESAMPLE_C */
@@ -0,0 +1,253 @@
+/*
+ * shm.c -
+ *
+ * Implementation of frames in shared memory in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tpl-shm.h"
+
+#define MAGIC 0x54504c53484d3031UL /* "TPLSHM01" */
+
+#define ROUND_UP(a, b)  ((((a) + (b) - 1)/(b))*(b))
+
+/*
+ * Layout of the shared memory segment: the header, the headers of the
+ * buffers and the frames, all aligned on TPL_ALIGNMENT bytes.  The version
+ * of a buffer is odd while the buffer is being written (as for a sequence
+ * lock) and is incremented when the frame is published.  The number of
+ * published frames is `count`, the last one being in buffer
+ * `(count - 1) % nbufs`.
+ */
+typedef struct {
+    unsigned long magic;
+    int type;
+    long len1, len2, pitch, nbufs;
+    size_t size;    /* total size of segment */
+    size_t offset;  /* offset of first frame */
+    size_t stride;  /* bytes between consecutive frames */
+    _Alignas(TPL_ALIGNMENT) unsigned long count;
+} Header;
+
+typedef struct {
+    _Alignas(TPL_ALIGNMENT) unsigned long version;
+    unsigned long serial;
+} Buffer;
+
+struct TPL_ShmWriter {
+    char* name;
+    Header* hdr;
+    unsigned long next; /* serial of next frame */
+};
+
+struct TPL_ShmSource {
+    Header const* hdr;
+};
+
+#define BUFFERS(hdr)  ((Buffer*)((char*)(hdr) + sizeof(Header)))
+#define FRAME(hdr, j) ((char*)(hdr) + (hdr)->offset + (j)*(hdr)->stride)
+
+static void
+make_view(Header const* hdr, unsigned long serial, unsigned long version,
+          TPL_ImageView* view)
+{
+    view->data = FRAME(hdr, serial%hdr->nbufs);
+    view->len1 = hdr->len1;
+    view->len2 = hdr->len2;
+    view->pitch = hdr->pitch;
+    view->type = hdr->type;
+    view->serial = serial;
+    view->version = version;
+}
+
+TPL_ShmWriter*
+tpl_create_shm_writer(char const* name,
+                      TPL_ElementType type,
+                      long len1,
+                      long len2,
+                      long nbufs)
+{
+    size_t elsize = (type == TPL_FLOAT ? sizeof(float) :
+                     type == TPL_DOUBLE ? sizeof(double) : 0);
+    if (name == NULL || elsize == 0 || len1 < 1 || len2 < 1 || nbufs < 1) {
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t offset = ROUND_UP(sizeof(Header) + nbufs*sizeof(Buffer),
+                             TPL_ALIGNMENT);
+    size_t stride = ROUND_UP(len1*len2*elsize, TPL_ALIGNMENT);
+    size_t size = offset + nbufs*stride;
+    TPL_ShmWriter* wrt = calloc(1, sizeof(TPL_ShmWriter));
+    if (wrt == NULL) {
+        return NULL;
+    }
+    wrt->name = strdup(name);
+    if (wrt->name == NULL) {
+        free(wrt);
+        return NULL;
+    }
+    int fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, S_IRUSR|S_IWUSR);
+    if (fd == -1) {
+        goto error;
+    }
+    if (ftruncate(fd, size) == -1) {
+        int code = errno;
+        close(fd);
+        shm_unlink(name);
+        errno = code;
+        goto error;
+    }
+    void* addr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        int code = errno;
+        shm_unlink(name);
+        errno = code;
+        goto error;
+    }
+    /* The segment is zero-filled, the magic number is written last. */
+    Header* hdr = addr;
+    hdr->type = type;
+    hdr->len1 = len1;
+    hdr->len2 = len2;
+    hdr->pitch = len1;
+    hdr->nbufs = nbufs;
+    hdr->size = size;
+    hdr->offset = offset;
+    hdr->stride = stride;
+    __atomic_store_n(&hdr->magic, MAGIC, __ATOMIC_RELEASE);
+    wrt->hdr = hdr;
+    return wrt;
+
+ error:
+    free(wrt->name);
+    free(wrt);
+    return NULL;
+}
+
+void
+tpl_destroy_shm_writer(TPL_ShmWriter* wrt)
+{
+    if (wrt != NULL) {
+        shm_unlink(wrt->name);
+        munmap(wrt->hdr, wrt->hdr->size);
+        free(wrt->name);
+        free(wrt);
+    }
+}
+
+void
+tpl_shm_writer_start(TPL_ShmWriter* wrt, TPL_ImageView* view)
+{
+    Header* hdr = wrt->hdr;
+    unsigned long s = wrt->next;
+    Buffer* buf = &BUFFERS(hdr)[s%hdr->nbufs];
+    unsigned long v = buf->version + 1;
+    __atomic_store_n(&buf->version, v, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&buf->serial, s, __ATOMIC_RELAXED);
+    make_view(hdr, s, v, view);
+}
+
+void
+tpl_shm_writer_publish(TPL_ShmWriter* wrt)
+{
+    Header* hdr = wrt->hdr;
+    unsigned long s = wrt->next;
+    Buffer* buf = &BUFFERS(hdr)[s%hdr->nbufs];
+    __atomic_store_n(&buf->version, buf->version + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&hdr->count, s + 1, __ATOMIC_RELEASE);
+    wrt->next = s + 1;
+}
+
+TPL_ShmSource*
+tpl_attach_shm_source(char const* name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int code = errno;
+        close(fd);
+        errno = code;
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(Header)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+    Header const* hdr = addr;
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != MAGIC ||
+        hdr->size != (size_t)st.st_size) {
+        munmap(addr, st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    TPL_ShmSource* src = malloc(sizeof(TPL_ShmSource));
+    if (src == NULL) {
+        munmap(addr, st.st_size);
+        return NULL;
+    }
+    src->hdr = hdr;
+    return src;
+}
+
+void
+tpl_detach_shm_source(TPL_ShmSource* src)
+{
+    if (src != NULL) {
+        munmap((void*)src->hdr, src->hdr->size);
+        free(src);
+    }
+}
+
+int
+tpl_shm_source_last(TPL_ShmSource* src, TPL_ImageView* view)
+{
+    Header const* hdr = src->hdr;
+    while (1) {
+        unsigned long n = __atomic_load_n(&hdr->count, __ATOMIC_ACQUIRE);
+        if (n == 0) {
+            return -1;
+        }
+        /* Retry if the buffer of the last frame is already being
+           overwritten by a newer frame. */
+        Buffer const* buf = &BUFFERS(hdr)[(n - 1)%hdr->nbufs];
+        unsigned long v = __atomic_load_n(&buf->version, __ATOMIC_ACQUIRE);
+        if ((v & 1) == 0 &&
+            __atomic_load_n(&buf->serial, __ATOMIC_RELAXED) == n - 1) {
+            make_view(hdr, n - 1, v, view);
+            return 0;
+        }
+    }
+}
+
+int
+tpl_shm_source_check(TPL_ShmSource const* src, TPL_ImageView const* view)
+{
+    Header const* hdr = src->hdr;
+    Buffer const* buf = &BUFFERS(hdr)[view->serial%hdr->nbufs];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&buf->version, __ATOMIC_RELAXED) == view->version;
+}
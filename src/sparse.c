@@ -0,0 +1,362 @@
+/*
+ * sparse.c -
+ *
+ * Implementation of sparse interpolation matrices.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_SPARSE_C
+#define _TPL_SPARSE_C 1
+
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include "tpl-alloc.h"
+#include "tpl-pool.h"
+#include "tpl-sparse.h"
+#include "tpl-inline.h"
+#include "tpl-stats.h"
+
+#define _tpl_index       long
+
+/*
+ * Leading dimension of the ELLPACK arrays is rounded up to a multiple of
+ * `ROWS_ALIGN` so that all slots are aligned for SIMD vectors.
+ */
+#define ROWS_ALIGN  (TPL_ALIGNMENT/sizeof(float))
+
+/*
+ * The product by the matrix is computed by blocks of `ROWS_BLOCK` rows whose
+ * accumulators remain in the L1 cache while the slots are processed.
+ */
+#define ROWS_BLOCK  64
+
+/*
+ * Yield the least column `c` in `[0,ncols]` such that `tptr[c] >= e`, the
+ * column offsets `tptr` being nondecreasing.
+ */
+static long
+lower_bound(long const* tptr, long ncols, long e)
+{
+    long lo = 0, hi = ncols;
+    while (lo < hi) {
+        long c = lo + (hi - lo)/2;
+        if (tptr[c] < e) {
+            lo = c + 1;
+        } else {
+            hi = c;
+        }
+    }
+    return lo;
+}
+
+void
+tpl_finalize_interpolation_matrix(TPL_InterpolationMatrix* A)
+{
+    tpl_free(A->idx);
+    tpl_free(A->wgt);
+    tpl_free(A->tptr);
+    tpl_free(A->tidx);
+    tpl_free(A->twgt);
+    A->idx = NULL;
+    A->wgt = NULL;
+    A->tptr = NULL;
+    A->tidx = NULL;
+    A->twgt = NULL;
+}
+
+#define _tpl_float          float
+#define _tpl_type           TPL_FLOAT
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_type           TPL_DOUBLE
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_SPARSE_C defined */
+
+int
+_tpl_public(initialize_interpolation_matrix)(
+    TPL_InterpolationMatrix* A,
+    _tpl_index n,
+    double const* x1,
+    double const* x2,
+    _tpl_index len1,
+    _tpl_index len2,
+    TPL_InterpolationFunction const* ker)
+{
+    A->idx = NULL;
+    A->wgt = NULL;
+    A->tptr = NULL;
+    A->tidx = NULL;
+    A->twgt = NULL;
+    if (n < 1 || n > INT_MAX || len1 < 1 || len2 < 1 || ker == NULL ||
+        ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE ||
+        len1 > INT_MAX/len2) {
+        return -1;
+    }
+    _tpl_index size = ker->size;
+    _tpl_index h = (size - 1)/2;
+    _tpl_index nnz = size*size;
+    _tpl_index ldr = ((n + ROWS_ALIGN - 1)/ROWS_ALIGN)*ROWS_ALIGN;
+    _tpl_index ncols = len1*len2;
+    A->nrows = n;
+    A->ncols = ncols;
+    A->nnz = nnz;
+    A->ldr = ldr;
+    A->type = _tpl_type;
+    A->idx = tpl_alloc(nnz*ldr*sizeof(int));
+    A->wgt = tpl_alloc(nnz*ldr*sizeof(_tpl_float));
+    A->tptr = tpl_alloc((ncols + 1)*sizeof(long));
+    A->tidx = tpl_alloc(nnz*n*sizeof(int));
+    A->twgt = tpl_alloc(nnz*n*sizeof(_tpl_float));
+    if (A->idx == NULL || A->wgt == NULL || A->tptr == NULL ||
+        A->tidx == NULL || A->twgt == NULL) {
+        tpl_finalize_interpolation_matrix(A);
+        return -1;
+    }
+
+    /* Compute indices and weights in ELLPACK format. */
+    int* idx = A->idx;
+    _tpl_float* wgt = A->wgt;
+    double w1[TPL_INTERP_MAX_SIZE], w2[TPL_INTERP_MAX_SIZE];
+    _tpl_index j1[TPL_INTERP_MAX_SIZE], j2[TPL_INTERP_MAX_SIZE];
+    for (_tpl_index r = 0; r < n; ++r) {
+        double fl1 = floor(x1[r]);
+        double fl2 = floor(x2[r]);
+        TPL_INTERP_FUNC_WGTS(ker, x1[r] - fl1, w1);
+        TPL_INTERP_FUNC_WGTS(ker, x2[r] - fl2, w2);
+        _tpl_index i1 = (_tpl_index)fl1 - h;
+        _tpl_index i2 = (_tpl_index)fl2 - h;
+        for (_tpl_index k = 0; k < size; ++k) {
+            j1[k] = pvc_min(pvc_max(i1 + k, 0), len1 - 1);
+            j2[k] = pvc_min(pvc_max(i2 + k, 0), len2 - 1);
+        }
+        for (_tpl_index k2 = 0; k2 < size; ++k2) {
+            for (_tpl_index k1 = 0; k1 < size; ++k1) {
+                _tpl_index k = k1 + size*k2;
+                idx[k*ldr + r] = j1[k1] + len1*j2[k2];
+                wgt[k*ldr + r] = w1[k1]*w2[k2];
+            }
+        }
+    }
+    for (_tpl_index k = 0; k < nnz; ++k) {
+        for (_tpl_index r = n; r < ldr; ++r) {
+            idx[k*ldr + r] = 0;
+            wgt[k*ldr + r] = 0;
+        }
+    }
+
+    /* Build the transpose in compressed sparse row format with entries
+       sorted by increasing column index in each row. */
+    long* tptr = A->tptr;
+    int* tidx = A->tidx;
+    _tpl_float* twgt = A->twgt;
+    for (_tpl_index c = 0; c <= ncols; ++c) {
+        tptr[c] = 0;
+    }
+    for (_tpl_index k = 0; k < nnz; ++k) {
+        for (_tpl_index r = 0; r < n; ++r) {
+            ++tptr[idx[k*ldr + r] + 1];
+        }
+    }
+    for (_tpl_index c = 0; c < ncols; ++c) {
+        tptr[c + 1] += tptr[c];
+    }
+    for (_tpl_index r = 0; r < n; ++r) {
+        for (_tpl_index k = 0; k < nnz; ++k) {
+            long e = tptr[idx[k*ldr + r]]++;
+            tidx[e] = r;
+            twgt[e] = wgt[k*ldr + r];
+        }
+    }
+    for (_tpl_index c = ncols; c > 0; --c) {
+        tptr[c] = tptr[c - 1];
+    }
+    tptr[0] = 0;
+    return 0;
+}
+
+/*
+ * Compute rows `r0 ≤ r < r1` of the product by the matrix.
+ */
+static void
+_tpl_private(apply_rows)(TPL_InterpolationMatrix const* A,
+                         _tpl_index r0,
+                         _tpl_index r1,
+                         _tpl_float*restrict dst,
+                         _tpl_float const*restrict src)
+{
+    _tpl_index ldr = A->ldr;
+    _tpl_index nnz = A->nnz;
+    int const* idx = A->idx;
+    _tpl_float const* wgt = A->wgt;
+    _tpl_float acc[ROWS_BLOCK];
+    for (_tpl_index r = r0; r < r1; r += ROWS_BLOCK) {
+        _tpl_index m = pvc_min(ROWS_BLOCK, r1 - r);
+        for (_tpl_index i = 0; i < m; ++i) {
+            acc[i] = 0;
+        }
+        for (_tpl_index k = 0; k < nnz; ++k) {
+            int const*restrict j = &idx[k*ldr + r];
+            _tpl_float const*restrict w = &wgt[k*ldr + r];
+            for (_tpl_index i = 0; i < m; ++i) {
+                acc[i] += w[i]*src[j[i]];
+            }
+        }
+        for (_tpl_index i = 0; i < m; ++i) {
+            dst[r + i] = acc[i];
+        }
+    }
+}
+
+/*
+ * Compute elements `c0 ≤ c < c1` of the product by the transpose of the
+ * matrix.
+ */
+static void
+_tpl_private(apply_adj_cols)(TPL_InterpolationMatrix const* A,
+                             _tpl_index c0,
+                             _tpl_index c1,
+                             _tpl_float*restrict dst,
+                             _tpl_float const*restrict src)
+{
+    long const* tptr = A->tptr;
+    int const* tidx = A->tidx;
+    _tpl_float const* twgt = A->twgt;
+    for (_tpl_index c = c0; c < c1; ++c) {
+        _tpl_float s = 0;
+        for (long e = tptr[c]; e < tptr[c + 1]; ++e) {
+            s += twgt[e]*src[tidx[e]];
+        }
+        dst[c] = s;
+    }
+}
+
+int
+_tpl_public(apply_interpolation_matrix)(TPL_InterpolationMatrix const* A,
+                                        _tpl_float*restrict dst,
+                                        _tpl_float const*restrict src)
+{
+    if (A->type != _tpl_type) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    _tpl_private(apply_rows)(A, 0, A->nrows, dst, src);
+    TPL_STATS_END(TPL_STATS_APPLY_INTERPOLATION_MATRIX, A->nrows);
+    return 0;
+}
+
+int
+_tpl_public(apply_interpolation_matrix_adj)(TPL_InterpolationMatrix const* A,
+                                            _tpl_float*restrict dst,
+                                            _tpl_float const*restrict src)
+{
+    if (A->type != _tpl_type) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    _tpl_private(apply_adj_cols)(A, 0, A->ncols, dst, src);
+    TPL_STATS_END(TPL_STATS_APPLY_INTERPOLATION_MATRIX_ADJ, A->ncols);
+    return 0;
+}
+
+/*
+ * Arguments of the parallel products for the workers.
+ */
+struct _tpl_private(apply_task) {
+    TPL_InterpolationMatrix const* A;
+    _tpl_float* dst;
+    _tpl_float const* src;
+};
+
+/*
+ * Each thread computes a block of consecutive rows, made of whole SIMD
+ * vectors so that threads neither share cache lines of the destination nor
+ * split the packed slots.
+ */
+static void
+_tpl_private(apply_rows_worker)(void* arg, long rank, long nranks)
+{
+    struct _tpl_private(apply_task) const* t = arg;
+    _tpl_index n = t->A->nrows, q = ROWS_ALIGN;
+    _tpl_index r0, r1;
+    tpl_pool_split((n + q - 1)/q, rank, nranks, &r0, &r1);
+    r0 = pvc_min(r0*q, n);
+    r1 = pvc_min(r1*q, n);
+    if (r0 < r1) {
+        _tpl_private(apply_rows)(t->A, r0, r1, t->dst, t->src);
+    }
+}
+
+/*
+ * Each thread computes a block of consecutive columns of the product by the
+ * transpose.  As the number of entries per column varies (many columns have
+ * none), blocks are chosen to have about the same number of entries.
+ */
+static void
+_tpl_private(apply_adj_cols_worker)(void* arg, long rank, long nranks)
+{
+    struct _tpl_private(apply_task) const* t = arg;
+    long const* tptr = t->A->tptr;
+    _tpl_index ncols = t->A->ncols;
+    long e0, e1;
+    tpl_pool_split(tptr[ncols], rank, nranks, &e0, &e1);
+    _tpl_index c0 = (rank == 0 ? 0 : lower_bound(tptr, ncols, e0));
+    _tpl_index c1 = (rank == nranks - 1 ? ncols :
+                     lower_bound(tptr, ncols, e1));
+    if (c0 < c1) {
+        _tpl_private(apply_adj_cols)(t->A, c0, c1, t->dst, t->src);
+    }
+}
+
+int
+_tpl_public(apply_interpolation_matrix_parallel)(
+    TPL_Pool* pool,
+    TPL_InterpolationMatrix const* A,
+    _tpl_float*restrict dst,
+    _tpl_float const*restrict src)
+{
+    if (A->type != _tpl_type) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    struct _tpl_private(apply_task) t = {.A = A, .dst = dst, .src = src};
+    tpl_pool_run(pool, _tpl_private(apply_rows_worker), &t);
+    TPL_STATS_END(TPL_STATS_APPLY_INTERPOLATION_MATRIX_PARALLEL, A->nrows);
+    return 0;
+}
+
+int
+_tpl_public(apply_interpolation_matrix_adj_parallel)(
+    TPL_Pool* pool,
+    TPL_InterpolationMatrix const* A,
+    _tpl_float*restrict dst,
+    _tpl_float const*restrict src)
+{
+    if (A->type != _tpl_type) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    struct _tpl_private(apply_task) t = {.A = A, .dst = dst, .src = src};
+    tpl_pool_run(pool, _tpl_private(apply_adj_cols_worker), &t);
+    TPL_STATS_END(TPL_STATS_APPLY_INTERPOLATION_MATRIX_ADJ_PARALLEL,
+                  A->ncols);
+    return 0;
+}
+
+#undef _tpl_float
+#undef _tpl_type
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_SPARSE_C */
@@ -0,0 +1,92 @@
+/*
+ * starlet.c -
+ *
+ * Implementation of the starlet (isotropic undecimated wavelet) transform.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_STARLET_C
+#define _TPL_STARLET_C 1
+
+#include "tpl-image.h"
+#include "tpl-inline.h"
+
+#define _tpl_index       long
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#include __FILE__
+
+#else /* _TPL_STARLET_C defined */
+
+void
+_tpl_public(starlet_2d)(int nscales,
+                        _tpl_float*restrict wav,
+                        _tpl_float const*restrict src,
+                        _tpl_index len1,
+                        _tpl_index len2,
+                        _tpl_float*restrict wrk)
+{
+    /* B3-spline kernel. */
+    static const _tpl_float ker[5] = {1.0/16, 4.0/16, 6.0/16, 4.0/16, 1.0/16};
+    _tpl_index npix = len1*len2;
+    _tpl_float* tmp = wrk;
+    _tpl_float* lin = wrk + npix;
+    _tpl_float* coarse = wav + nscales*npix;
+    _tpl_float const* cur = src;
+    if (npix < 1) {
+        return;
+    }
+    for (int j = 0; j < nscales; ++j) {
+        /* Smooth current approximation with holes of size `2^j - 1`, store
+           the result in the plane of this scale and then split it into the
+           details (in this plane) and the next approximation (in the last
+           plane). */
+        _tpl_index d = (_tpl_index)1 << j;
+        _tpl_float* det = wav + j*npix;
+        tpl_filter_2d_dilated(1, tmp, len1, len2, ker, 5, d,
+                              cur, len1, len2, -2*d, 0, lin);
+        tpl_filter_2d_dilated(2, det, len1, len2, ker, 5, d,
+                              tmp, len1, len2, 0, -2*d, lin);
+        for (_tpl_index i = 0; i < npix; ++i) {
+            _tpl_float t = det[i];
+            det[i] = cur[i] - t;
+            coarse[i] = t;
+        }
+        cur = coarse;
+    }
+    if (nscales < 1) {
+        tpl_copy_contiguous(npix, coarse, src);
+    }
+}
+
+void
+_tpl_public(starlet_2d_rec)(int nscales,
+                            _tpl_float*restrict dst,
+                            _tpl_float const*restrict wav,
+                            _tpl_index len1,
+                            _tpl_index len2)
+{
+    _tpl_index npix = len1*len2;
+    tpl_copy_contiguous(npix, dst, wav + pvc_max(nscales, 0)*npix);
+    for (int j = nscales - 1; j >= 0; --j) {
+        _tpl_float const* det = wav + j*npix;
+        for (_tpl_index i = 0; i < npix; ++i) {
+            dst[i] += det[i];
+        }
+    }
+}
+
+#undef _tpl_float
+#undef _tpl_public
+
+#endif /* _TPL_STARLET_C */
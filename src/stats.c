@@ -0,0 +1,227 @@
+/*
+ * stats.c -
+ *
+ * Implementation of the optional instrumentation of TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tpl-stats.h"
+
+#if TPL_STATS && (defined(__x86_64__) || defined(__i386__))
+#  include <x86intrin.h>
+#  define read_cycles()  ((unsigned long long)__rdtsc())
+#else
+#  define read_cycles()  0ULL
+#endif
+
+static char const* const names[TPL_STATS_ENTRIES] = {
+    "tpl_filter",
+    "tpl_filter_dilated",
+    "tpl_filter_reduce",
+    "tpl_filter_var",
+    "tpl_filter_bank",
+    "tpl_filter_2d",
+    "tpl_filter_2d_parallel",
+    "tpl_filter_2d_batch",
+    "tpl_filter_2d_ref",
+    "tpl_filter_2d_calib",
+    "tpl_filter_2d_reduce",
+    "tpl_filter_2d_var",
+    "tpl_filter_2d_dilated",
+    "tpl_filter_bank_2d",
+    "tpl_resample_1d",
+    "tpl_resample_1d_adj",
+    "tpl_resample_1d_parallel",
+    "tpl_resample_1d_adj_parallel",
+    "tpl_shear_2d",
+    "tpl_shear_2d_adj",
+    "tpl_shear_2d_parallel",
+    "tpl_shear_2d_adj_parallel",
+    "tpl_rotate_2d",
+    "tpl_rotate_2d_adj",
+    "tpl_rotate_2d_parallel",
+    "tpl_rotate_2d_adj_parallel",
+    "tpl_rotate_2d_batch",
+    "tpl_interp_grad_2d",
+    "tpl_apply_interpolation_matrix",
+    "tpl_apply_interpolation_matrix_adj",
+    "tpl_apply_interpolation_matrix_parallel",
+    "tpl_apply_interpolation_matrix_adj_parallel",
+};
+
+char const*
+tpl_stats_name(TPL_StatsEntry id)
+{
+    return ((unsigned)id < TPL_STATS_ENTRIES ? names[id] : NULL);
+}
+
+#if TPL_STATS
+
+/*
+ * Counters of a thread.  Blocks are allocated on first use by each thread,
+ * pushed onto a lock-free list and never freed so that the statistics of
+ * terminated threads are kept.  Only the owner thread writes the counters
+ * (with relaxed atomic stores so that concurrent queries are well defined).
+ * A reset increments the global generation number, a block whose generation
+ * differs is considered as empty and is cleared by its owner at the next
+ * record.
+ */
+typedef struct Block Block;
+struct Block {
+    Block* next;
+    unsigned long generation;
+    TPL_Stats stats[TPL_STATS_ENTRIES];
+};
+
+static Block* blocks = NULL;
+static unsigned long generation = 0;
+static _Thread_local Block* own_block = NULL;
+
+#define LOAD(var)       __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define STORE(var, val) __atomic_store_n(&(var), (val), __ATOMIC_RELAXED)
+#define INCR(var, val)  STORE(var, (var) + (val))
+
+static Block*
+get_block(void)
+{
+    Block* b = own_block;
+    if (b == NULL) {
+        b = calloc(1, sizeof(Block));
+        if (b == NULL) {
+            return NULL;
+        }
+        b->generation = LOAD(generation);
+        b->next = __atomic_load_n(&blocks, __ATOMIC_ACQUIRE);
+        while (!__atomic_compare_exchange_n(&blocks, &b->next, b, 1,
+                                            __ATOMIC_RELEASE,
+                                            __ATOMIC_ACQUIRE)) {
+            ;
+        }
+        own_block = b;
+    }
+    return b;
+}
+
+static unsigned long long
+read_nsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000000000ULL*(unsigned long long)ts.tv_sec + ts.tv_nsec;
+}
+
+void
+tpl_stats_start(TPL_StatsTimer* tmr)
+{
+    tmr->nsec = read_nsec();
+    tmr->cycles = read_cycles();
+}
+
+void
+tpl_stats_record(TPL_StatsEntry id, long nelem, TPL_StatsTimer const* tmr)
+{
+    unsigned long long cycles = read_cycles() - tmr->cycles;
+    unsigned long long nsec = read_nsec() - tmr->nsec;
+    Block* b = get_block();
+    if (b == NULL) {
+        return;
+    }
+    unsigned long gen = LOAD(generation);
+    if (b->generation != gen) {
+        /* Lazily clear the counters after a reset.  The generation is
+           updated last so that queries never see partially cleared
+           counters as valid. */
+        for (int k = 0; k < TPL_STATS_ENTRIES; ++k) {
+            TPL_Stats* s = &b->stats[k];
+            STORE(s->calls, 0);
+            STORE(s->elements, 0);
+            STORE(s->nsec, 0);
+            STORE(s->cycles, 0);
+            for (int j = 0; j < TPL_STATS_BUCKETS; ++j) {
+                STORE(s->hist[j], 0);
+            }
+        }
+        __atomic_store_n(&b->generation, gen, __ATOMIC_RELEASE);
+    }
+    int j = (nsec > 1 ? 63 - __builtin_clzll(nsec) : 0);
+    if (j >= TPL_STATS_BUCKETS) {
+        j = TPL_STATS_BUCKETS - 1;
+    }
+    TPL_Stats* s = &b->stats[id];
+    INCR(s->calls, 1);
+    INCR(s->elements, (nelem > 0 ? (unsigned long long)nelem : 0));
+    INCR(s->nsec, nsec);
+    INCR(s->cycles, cycles);
+    INCR(s->hist[j], 1);
+}
+
+int
+tpl_stats_enabled(void)
+{
+    return 1;
+}
+
+int
+tpl_stats_query(TPL_StatsEntry id, TPL_Stats* st)
+{
+    if ((unsigned)id >= TPL_STATS_ENTRIES) {
+        return -1;
+    }
+    memset(st, 0, sizeof(*st));
+    unsigned long gen = LOAD(generation);
+    for (Block* b = __atomic_load_n(&blocks, __ATOMIC_ACQUIRE);
+         b != NULL; b = b->next) {
+        if (__atomic_load_n(&b->generation, __ATOMIC_ACQUIRE) != gen) {
+            continue;
+        }
+        TPL_Stats* s = &b->stats[id];
+        st->calls += LOAD(s->calls);
+        st->elements += LOAD(s->elements);
+        st->nsec += LOAD(s->nsec);
+        st->cycles += LOAD(s->cycles);
+        for (int j = 0; j < TPL_STATS_BUCKETS; ++j) {
+            st->hist[j] += LOAD(s->hist[j]);
+        }
+    }
+    return 0;
+}
+
+void
+tpl_stats_reset(void)
+{
+    __atomic_add_fetch(&generation, 1, __ATOMIC_RELAXED);
+}
+
+#else /* TPL_STATS */
+
+int
+tpl_stats_enabled(void)
+{
+    return 0;
+}
+
+int
+tpl_stats_query(TPL_StatsEntry id, TPL_Stats* st)
+{
+    if ((unsigned)id >= TPL_STATS_ENTRIES) {
+        return -1;
+    }
+    memset(st, 0, sizeof(*st));
+    return 0;
+}
+
+void
+tpl_stats_reset(void)
+{
+}
+
+#endif /* TPL_STATS */
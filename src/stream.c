@@ -0,0 +1,265 @@
+/*
+ * stream.c -
+ *
+ * Out-of-core filtering of images in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_STREAM_C
+#define _TPL_STREAM_C 1
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "tpl-alloc.h"
+#include "tpl-image.h"
+#include "tpl-pipeline.h"
+
+#define _tpl_index       long
+
+/*
+ * Header of a strip in the rings of the pipeline: rows `first:last-1` of
+ * the destination computed from rows `a:b-1` of the source.  The pixels of
+ * the strip follow the header.
+ */
+typedef struct {
+    _Alignas(TPL_ALIGNMENT) long first, last;
+    long a, b;
+} Strip;
+
+#define PIXELS(s)  ((void*)((Strip*)(s) + 1))
+
+/* Record the first error. */
+static void
+set_error(int* error, int code)
+{
+    int none = 0;
+    __atomic_compare_exchange_n(error, &none, code, 0,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static int
+read_all(int fd, void* buf, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t n = pread(fd, buf, size, offset);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            return (n == 0 ? EIO : errno);
+        }
+        buf = (char*)buf + n;
+        size -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+static int
+write_all(int fd, void const* buf, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t n = pwrite(fd, buf, size, offset);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        buf = (char const*)buf + n;
+        size -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+static void
+nap(void)
+{
+    struct timespec ts = {0, 20000};
+    nanosleep(&ts, NULL);
+}
+
+#define _tpl_float          float
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_STREAM_C defined */
+
+/*
+ * Context shared by the stages.  Only the filtering stage uses the
+ * workspaces.
+ */
+struct _tpl_private(stream) {
+    int dim;
+    int dst_fd, src_fd;
+    _tpl_index dst_len1, dst_len2;
+    _tpl_float const* ker;
+    _tpl_index ker_len;
+    _tpl_index src_len1, src_len2;
+    _tpl_index k1, k2;
+    _tpl_float* wrk;
+    _tpl_float* tmp;
+    int error;
+};
+
+/* 1st stage: read the source rows needed by a strip. */
+static void
+_tpl_private(read_strip)(void* arg, void* dst, void const* src)
+{
+    struct _tpl_private(stream)* ctx = arg;
+    Strip const* in = src;
+    Strip* out = dst;
+    _tpl_index n = ctx->src_len2;
+    _tpl_index lo = in->first + ctx->k2;
+    _tpl_index hi = in->last - 1 + ctx->k2 +
+        (ctx->dim == 2 ? ctx->ker_len - 1 : 0);
+    out->first = in->first;
+    out->last = in->last;
+    out->a = (lo < 0 ? 0 : lo < n ? lo : n - 1);
+    out->b = (hi < 0 ? 0 : hi < n ? hi : n - 1) + 1;
+    size_t row = ctx->src_len1*sizeof(_tpl_float);
+    int code = read_all(ctx->src_fd, PIXELS(out), (out->b - out->a)*row,
+                        out->a*row);
+    if (code != 0) {
+        set_error(&ctx->error, code);
+    }
+}
+
+/* 2nd stage: filter a strip, as a sub-image with a shifted offset. */
+static void
+_tpl_private(filter_strip)(void* arg, void* dst, void const* src)
+{
+    struct _tpl_private(stream)* ctx = arg;
+    Strip const* in = src;
+    Strip* out = dst;
+    *out = *in;
+    _tpl_public(filter_2d)(ctx->dim, PIXELS(out), ctx->dst_len1,
+                           in->last - in->first, ctx->ker, ctx->ker_len,
+                           PIXELS(in), ctx->src_len1, in->b - in->a,
+                           ctx->k1, ctx->k2 + in->first - in->a,
+                           ctx->wrk, ctx->tmp);
+}
+
+/* 3rd stage: write a filtered strip. */
+static void
+_tpl_private(write_strip)(void* arg, void* dst, void const* src)
+{
+    struct _tpl_private(stream)* ctx = arg;
+    Strip const* in = src;
+    size_t row = ctx->dst_len1*sizeof(_tpl_float);
+    int code = write_all(ctx->dst_fd, PIXELS(in),
+                         (in->last - in->first)*row, in->first*row);
+    if (code != 0) {
+        set_error(&ctx->error, code);
+    }
+    *(Strip*)dst = *in;
+}
+
+int
+_tpl_public(filter_2d_stream)(int dim,
+                              int dst_fd,
+                              _tpl_index dst_len1,
+                              _tpl_index dst_len2,
+                              _tpl_float const* ker,
+                              _tpl_index ker_len,
+                              int src_fd,
+                              _tpl_index src_len1,
+                              _tpl_index src_len2,
+                              _tpl_index k1,
+                              _tpl_index k2,
+                              _tpl_index strip_len)
+{
+    if ((dim != 1 && dim != 2) || dst_len1 < 1 || dst_len2 < 1 ||
+        ker_len < 1 || src_len1 < 1 || src_len2 < 1 || strip_len < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (strip_len > dst_len2) {
+        strip_len = dst_len2;
+    }
+    _tpl_index nstrips = (dst_len2 + strip_len - 1)/strip_len;
+    _tpl_index len = (dim == 1 ? dst_len1 : strip_len);
+    size_t sizes[2] = {
+        sizeof(Strip) + src_len1*(strip_len + ker_len - 1)*sizeof(_tpl_float),
+        sizeof(Strip) + dst_len1*strip_len*sizeof(_tpl_float)
+    };
+    struct _tpl_private(stream) ctx = {
+        .dim = dim, .dst_fd = dst_fd, .src_fd = src_fd,
+        .dst_len1 = dst_len1, .dst_len2 = dst_len2,
+        .ker = ker, .ker_len = ker_len,
+        .src_len1 = src_len1, .src_len2 = src_len2, .k1 = k1, .k2 = k2,
+        .error = 0
+    };
+    TPL_Stage* stages[3] = {_tpl_private(read_strip),
+                            _tpl_private(filter_strip),
+                            _tpl_private(write_strip)};
+    void* args[3] = {&ctx, &ctx, &ctx};
+    TPL_Ring* input = tpl_create_ring(2, sizeof(Strip));
+    TPL_Ring* output = tpl_create_ring(2, sizeof(Strip));
+    /* The workspaces of the filtering stage are carved from one arena. */
+    size_t wrk_size = (len + ker_len - 1)*sizeof(_tpl_float);
+    size_t tmp_size = strip_len*sizeof(_tpl_float);
+    TPL_Arena* arena = tpl_create_arena(TPL_ARENA_SIZE(wrk_size) +
+                                        TPL_ARENA_SIZE(tmp_size));
+    if (arena != NULL) {
+        ctx.wrk = tpl_arena_alloc(arena, wrk_size);
+        ctx.tmp = tpl_arena_alloc(arena, tmp_size);
+    }
+    TPL_Pipeline* pipe = NULL;
+    if (input != NULL && output != NULL && arena != NULL) {
+        /* Two slots per intermediate ring for double buffering. */
+        pipe = tpl_create_pipeline(3, stages, args, sizes, 2,
+                                   input, output, NULL, 10000);
+    }
+    if (pipe != NULL) {
+        _tpl_index nin = 0, nout = 0;
+        while (nout < nstrips) {
+            Strip* s = (nin < nstrips ? tpl_ring_acquire(input) : NULL);
+            if (s != NULL) {
+                s->first = nin*strip_len;
+                s->last = (nin + 1 < nstrips ? s->first + strip_len :
+                           dst_len2);
+                tpl_ring_publish(input);
+                ++nin;
+            }
+            Strip const* r = tpl_ring_peek(output);
+            if (r != NULL) {
+                tpl_ring_release(output);
+                ++nout;
+            }
+            if (s == NULL && r == NULL) {
+                nap();
+            }
+        }
+        tpl_destroy_pipeline(pipe);
+    } else {
+        ctx.error = errno;
+    }
+    tpl_destroy_ring(input);
+    tpl_destroy_ring(output);
+    tpl_destroy_arena(arena);
+    if (ctx.error != 0) {
+        errno = ctx.error;
+        return -1;
+    }
+    return 0;
+}
+
+#undef _tpl_float
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_STREAM_C defined */
@@ -0,0 +1,112 @@
+/*
+ * tpl-alloc.h -
+ *
+ * Definitions for aligned memory and workspaces in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#ifndef _TPL_ALLOC_H
+#define _TPL_ALLOC_H 1
+
+#include <stddef.h>
+#include <tpl-base.h>
+
+_TPL_EXTERN_C_BEGIN
+
+/**
+ * Allocate aligned memory.
+ *
+ * The returned block is aligned on ::TPL_ALIGNMENT bytes and its size is
+ * rounded up to a multiple of ::TPL_ALIGNMENT bytes, so that images and
+ * workspaces start on a cache line and the last packed vector never
+ * straddles the end of the block.
+ *
+ * @param size   Number of bytes.
+ *
+ * @return The address of the block to be freed by tpl_free(), `NULL` on
+ *         error with `errno` set.
+ */
+extern void* tpl_alloc(size_t size);
+
+/**
+ * Free memory allocated by tpl_alloc().
+ *
+ * @param ptr    Address of block (can be `NULL`).
+ */
+extern void tpl_free(void* ptr);
+
+/**
+ * Opaque structure for a workspace arena.
+ *
+ * An arena is a single block of aligned memory from which workspaces are
+ * carved by incrementing an offset.  Allocating from an arena is just a few
+ * instructions, nothing is freed individually and the arena is reset at once
+ * (e.g., for every frame) by tpl_arena_reset().  An arena is not thread-safe,
+ * each thread shall have its own.
+ */
+typedef struct TPL_Arena TPL_Arena;
+
+/**
+ * Create a workspace arena.
+ *
+ * @param size   Capacity in bytes.
+ *
+ * @return A new arena, `NULL` on error with `errno` set.
+ */
+extern TPL_Arena* tpl_create_arena(size_t size);
+
+/**
+ * Destroy a workspace arena and all workspaces allocated from it.
+ *
+ * @param arena  Arena (can be `NULL`).
+ */
+extern void tpl_destroy_arena(TPL_Arena* arena);
+
+/**
+ * Allocate a workspace from an arena.
+ *
+ * @param arena  Arena.
+ * @param size   Number of bytes.
+ *
+ * @return The address of a block aligned on ::TPL_ALIGNMENT bytes, `NULL`
+ *         with `errno` set to `ENOMEM` if the arena is exhausted.
+ */
+extern void* tpl_arena_alloc(TPL_Arena* arena, size_t size);
+
+/**
+ * Release all workspaces of an arena.
+ *
+ * @param arena  Arena.
+ */
+extern void tpl_arena_reset(TPL_Arena* arena);
+
+/**
+ * Get the number of bytes used in an arena.
+ *
+ * @param arena  Arena.
+ *
+ * @return The number of bytes allocated since the creation or the last
+ *         reset of the arena, including padding.
+ */
+extern size_t tpl_arena_used(TPL_Arena const* arena);
+
+/**
+ * @def TPL_ARENA_SIZE(size)
+ *
+ * @brief Number of bytes taken in an arena by a workspace.
+ *
+ * This is useful to compute the capacity of an arena for a given set of
+ * workspaces.
+ */
+#define TPL_ARENA_SIZE(size) \
+    ((((size_t)(size) + TPL_ALIGNMENT - 1)/TPL_ALIGNMENT)*TPL_ALIGNMENT)
+
+_TPL_EXTERN_C_END
+
+#endif /* _TPL_ALLOC_H */
@@ -29,4 +29,48 @@
 #  define _TPL_EXTERN_C_END
 #endif
 
+/**
+ * @def TPL_ALIGNMENT
+ *
+ * @brief Memory alignment (in bytes) suitable for all SIMD vectors.
+ */
+#define TPL_ALIGNMENT 64
+
+/**
+ * @def TPL_ALIGNED_LENGTH(len, size)
+ *
+ * @brief Number of elements rounded up for alignment.
+ *
+ * Yields `len` rounded up to a multiple of `TPL_ALIGNMENT/size` with `size`
+ * the size of the elements in bytes.  This is the stride between the parts
+ * of a workspace used by the threads of a pool: if the workspace is aligned
+ * on ::TPL_ALIGNMENT bytes, so are all the parts and no cache lines are
+ * shared by different threads.
+ */
+#define TPL_ALIGNED_LENGTH(len, size)                           \
+    ((((len) + (long)(TPL_ALIGNMENT/(size)) - 1)/               \
+      (long)(TPL_ALIGNMENT/(size)))*(long)(TPL_ALIGNMENT/(size)))
+
+/**
+ * @def TPL_FORCE_INLINE
+ *
+ * @brief Qualifier for functions which must be inlined (e.g., to have
+ * loop bounds known at compile time).
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#  define TPL_FORCE_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#  define TPL_FORCE_INLINE __forceinline
+#else
+#  define TPL_FORCE_INLINE inline
+#endif
+
+/**
+ * Identifiers of element types.
+ */
+typedef enum {
+    TPL_FLOAT  = 1, /**< Single precision floating-point (`float`). */
+    TPL_DOUBLE = 2  /**< Double precision floating-point (`double`). */
+} TPL_ElementType;
+
 #endif /* _TPL_BASE_H */
@@ -15,7 +15,9 @@
 #ifndef _TPL_FILTER_H
 #define _TPL_FILTER_H 1
 
+#include <stddef.h>
 #include <tpl-base.h>
+#include <tpl-reduce.h>
 
 _TPL_EXTERN_C_BEGIN
 
@@ -79,12 +81,187 @@ _TPL_EXTERN_C_BEGIN
              float:  tpl_filter_x5_f,                   \
              double: tpl_filter_x5_d)(n,dst,ker,src)
 
+/**
+ * @def TPL_STREAMING_THRESHOLD
+ *
+ * @brief Default size (in bytes) of the destination above which 2-D filters
+ * use non-temporal stores, see tpl_set_streaming_threshold().
+ */
+#ifndef TPL_STREAMING_THRESHOLD
+#  define TPL_STREAMING_THRESHOLD ((size_t)16 << 20)
+#endif
+
+/**
+ * Set the threshold of the large-image mode of the filters.
+ *
+ * When the destination of tpl_filter_2d() is at least `size` bytes, hence
+ * too large to stay in the last level cache, the rows filtered along the 1st
+ * dimension are written with non-temporal stores (see tpl_filter_nt()) and
+ * the strided loads along the 2nd dimension are prefetched.  Use `0` to
+ * always select the large-image mode and `SIZE_MAX` to never select it.
+ *
+ * The threshold does not apply to tpl_filter() which always writes through
+ * the cache, as most of its callers filter lines in a workspace that is read
+ * back right after; call tpl_filter_nt() to write a large final destination.
+ *
+ * @param size   Size of destination in bytes.
+ */
+extern void tpl_set_streaming_threshold(size_t size);
+
+/**
+ * Get the threshold of the large-image mode of the filters.
+ *
+ * @return The size set by the last call to tpl_set_streaming_threshold(),
+ *         ::TPL_STREAMING_THRESHOLD by default.
+ */
+extern size_t tpl_get_streaming_threshold(void);
+
+/**
+ * @def tpl_filter_nt(m,n,dst,ker,src)
+ *
+ * @brief Apply simple filter with non-temporal stores.
+ *
+ * The call `tpl_filter_nt(m,n,dst,ker,src)` yields the same result as
+ * `tpl_filter(m,n,dst,ker,src)` but the vectorized kernels write `dst` with
+ * non-temporal stores which bypass the cache.  This is faster for a
+ * destination much larger than the last level cache and which is not read
+ * soon after.
+ *
+ * @param m     Number of coefficients in kernel.
+ * @param n     Number of elements in destination.
+ * @param dst   Destination array.  Must have at least `n` elements.
+ * @param ker   Kernel coefficients.  Must have at least `m` elements.
+ * @param src   Source array. Must have at least `m + n - 1` elements.
+ */
+#define tpl_filter_nt(m,n,dst,ker,src)                  \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_nt_f,                   \
+             double: tpl_filter_nt_d)(m,n,dst,ker,src)
+
+/**
+ * @def tpl_filter_dilated(m,n,dst,ker,src,d)
+ *
+ * @brief Apply dilated (à-trous) filter.
+ *
+ * The call `tpl_filter_dilated(m,n,dst,ker,src,d)` is the same as
+ * `tpl_filter(m,n,dst,ker,src)` but with holes of `d - 1` samples between
+ * the filter coefficients:
+ *
+ * ```.c
+ * dst[i] = ker[0]*src[i] + ker[1]*src[i+d] + ... + ker[m-1]*src[i+(m-1)*d];
+ * ```
+ *
+ * @param m     Number of coefficients in kernel.
+ * @param n     Number of elements in destination.
+ * @param dst   Destination array.  Must have at least `n` elements.
+ * @param ker   Kernel coefficients.  Must have at least `m` elements.
+ * @param src   Source array. Must have at least `(m - 1)*d + n` elements.
+ * @param d     Dilation factor (`d = 1` for no holes).
+ */
+#define tpl_filter_dilated(m,n,dst,ker,src,d)           \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_dilated_f,              \
+             double: tpl_filter_dilated_d)(m,n,dst,ker,src,d)
+
+#define tpl_filter_x1_dilated(n,dst,ker,src,d)          \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_x1_dilated_f,           \
+             double: tpl_filter_x1_dilated_d)(n,dst,ker,src,d)
+
+#define tpl_filter_x2_dilated(n,dst,ker,src,d)          \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_x2_dilated_f,           \
+             double: tpl_filter_x2_dilated_d)(n,dst,ker,src,d)
+
+#define tpl_filter_x3_dilated(n,dst,ker,src,d)          \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_x3_dilated_f,           \
+             double: tpl_filter_x3_dilated_d)(n,dst,ker,src,d)
+
+#define tpl_filter_x4_dilated(n,dst,ker,src,d)          \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_x4_dilated_f,           \
+             double: tpl_filter_x4_dilated_d)(n,dst,ker,src,d)
+
+#define tpl_filter_x5_dilated(n,dst,ker,src,d)          \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_x5_dilated_f,           \
+             double: tpl_filter_x5_dilated_d)(n,dst,ker,src,d)
+
+/**
+ * @def tpl_filter_reduce(m,n,dst,ker,src,mom)
+ *
+ * @brief Apply simple filter and reduce the result.
+ *
+ * The call `tpl_filter_reduce(m,n,dst,ker,src,mom)` is the same as
+ * `tpl_filter(m,n,dst,ker,src)` except that the moments of `dst` (taken as a
+ * single row of pixels at indices `(i,0)`, see ::TPL_Moments) are accumulated
+ * in `mom` by chunks just after having been filtered, while they are still in
+ * cache.
+ *
+ * @param m     Number of coefficients in kernel.
+ * @param n     Number of elements in destination.
+ * @param dst   Destination array.  Must have at least `n` elements.
+ * @param ker   Kernel coefficients.  Must have at least `m` elements.
+ * @param src   Source array. Must have at least `m + n - 1` elements.
+ * @param mom   Moments to update, must have been initialized by
+ *              tpl_initialize_moments() or by a previous reduction.
+ */
+#define tpl_filter_reduce(m,n,dst,ker,src,mom)          \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_reduce_f,               \
+             double: tpl_filter_reduce_d)(m,n,dst,ker,src,mom)
+
+/**
+ * @def tpl_filter_var(m,n,dst,dst_var,ker,src,src_var)
+ *
+ * @brief Apply simple filter and propagate the variance.
+ *
+ * The call `tpl_filter_var(m,n,dst,dst_var,ker,src,src_var)` is the same as
+ * `tpl_filter(m,n,dst,ker,src)` and also stores in `dst_var` the variance of
+ * the result given the variance `src_var` of independent source values, that
+ * is `src_var` filtered by the squared kernel.  Short kernels are squared
+ * once for the call and the values and the variances are filtered in turn by
+ * chunks that stay in cache, longer kernels compute both results in the same
+ * loop.
+ *
+ * @param m        Number of coefficients in kernel.
+ * @param n        Number of elements in destination.
+ * @param dst      Destination array.  Must have at least `n` elements.
+ * @param dst_var  Destination variance.  Must have at least `n` elements.
+ * @param ker      Kernel coefficients.  Must have at least `m` elements.
+ * @param src      Source array. Must have at least `m + n - 1` elements.
+ * @param src_var  Source variance. Must have at least `m + n - 1` elements.
+ */
+#define tpl_filter_var(m,n,dst,dst_var,ker,src,src_var)         \
+    _Generic(*(dst),                                            \
+             float:  tpl_filter_var_f,                          \
+             double: tpl_filter_var_d)(m,n,dst,dst_var,ker,src,src_var)
+
 // Single precision versions.
 extern void tpl_filter_f(long m,
                          long n,
                          float *restrict dst,
                          float const*restrict ker,
                          float const*restrict src);
+extern void tpl_filter_reduce_f(long m,
+                                long n,
+                                float *restrict dst,
+                                float const*restrict ker,
+                                float const*restrict src,
+                                TPL_Moments* mom);
+extern void tpl_filter_var_f(long m,
+                             long n,
+                             float *restrict dst,
+                             float *restrict dst_var,
+                             float const*restrict ker,
+                             float const*restrict src,
+                             float const*restrict src_var);
+extern void tpl_filter_nt_f(long m,
+                            long n,
+                            float *restrict dst,
+                            float const*restrict ker,
+                            float const*restrict src);
 extern void tpl_filter_ref_f(long m,
                              long n,
                              float *restrict dst,
@@ -111,12 +288,81 @@ extern void tpl_filter_x5_f(long n,
                             float const*restrict ker,
                             float const*restrict src);
 
+extern void tpl_filter_x1_nt_f(long n,
+                               float *restrict dst,
+                               float const*restrict ker,
+                               float const*restrict src);
+extern void tpl_filter_x2_nt_f(long n,
+                               float *restrict dst,
+                               float const*restrict ker,
+                               float const*restrict src);
+extern void tpl_filter_x3_nt_f(long n,
+                               float *restrict dst,
+                               float const*restrict ker,
+                               float const*restrict src);
+extern void tpl_filter_x4_nt_f(long n,
+                               float *restrict dst,
+                               float const*restrict ker,
+                               float const*restrict src);
+extern void tpl_filter_x5_nt_f(long n,
+                               float *restrict dst,
+                               float const*restrict ker,
+                               float const*restrict src);
+extern void tpl_filter_dilated_f(long m,
+                                 long n,
+                                 float *restrict dst,
+                                 float const*restrict ker,
+                                 float const*restrict src,
+                                 long d);
+extern void tpl_filter_x1_dilated_f(long n,
+                                    float *restrict dst,
+                                    float const*restrict ker,
+                                    float const*restrict src,
+                                    long d);
+extern void tpl_filter_x2_dilated_f(long n,
+                                    float *restrict dst,
+                                    float const*restrict ker,
+                                    float const*restrict src,
+                                    long d);
+extern void tpl_filter_x3_dilated_f(long n,
+                                    float *restrict dst,
+                                    float const*restrict ker,
+                                    float const*restrict src,
+                                    long d);
+extern void tpl_filter_x4_dilated_f(long n,
+                                    float *restrict dst,
+                                    float const*restrict ker,
+                                    float const*restrict src,
+                                    long d);
+extern void tpl_filter_x5_dilated_f(long n,
+                                    float *restrict dst,
+                                    float const*restrict ker,
+                                    float const*restrict src,
+                                    long d);
 // Double precision versions.
 extern void tpl_filter_d(long m,
                          long n,
                          double *restrict dst,
                          double const*restrict ker,
                          double const*restrict src);
+extern void tpl_filter_reduce_d(long m,
+                                long n,
+                                double *restrict dst,
+                                double const*restrict ker,
+                                double const*restrict src,
+                                TPL_Moments* mom);
+extern void tpl_filter_var_d(long m,
+                             long n,
+                             double *restrict dst,
+                             double *restrict dst_var,
+                             double const*restrict ker,
+                             double const*restrict src,
+                             double const*restrict src_var);
+extern void tpl_filter_nt_d(long m,
+                            long n,
+                            double *restrict dst,
+                            double const*restrict ker,
+                            double const*restrict src);
 extern void tpl_filter_ref_d(long m,
                              long n,
                              double *restrict dst,
@@ -142,6 +388,230 @@ extern void tpl_filter_x5_d(long n,
                             double *restrict dst,
                             double const*restrict ker,
                             double const*restrict src);
+
+extern void tpl_filter_x1_nt_d(long n,
+                               double *restrict dst,
+                               double const*restrict ker,
+                               double const*restrict src);
+extern void tpl_filter_x2_nt_d(long n,
+                               double *restrict dst,
+                               double const*restrict ker,
+                               double const*restrict src);
+extern void tpl_filter_x3_nt_d(long n,
+                               double *restrict dst,
+                               double const*restrict ker,
+                               double const*restrict src);
+extern void tpl_filter_x4_nt_d(long n,
+                               double *restrict dst,
+                               double const*restrict ker,
+                               double const*restrict src);
+extern void tpl_filter_x5_nt_d(long n,
+                               double *restrict dst,
+                               double const*restrict ker,
+                               double const*restrict src);
+extern void tpl_filter_dilated_d(long m,
+                                 long n,
+                                 double *restrict dst,
+                                 double const*restrict ker,
+                                 double const*restrict src,
+                                 long d);
+extern void tpl_filter_x1_dilated_d(long n,
+                                    double *restrict dst,
+                                    double const*restrict ker,
+                                    double const*restrict src,
+                                    long d);
+extern void tpl_filter_x2_dilated_d(long n,
+                                    double *restrict dst,
+                                    double const*restrict ker,
+                                    double const*restrict src,
+                                    long d);
+extern void tpl_filter_x3_dilated_d(long n,
+                                    double *restrict dst,
+                                    double const*restrict ker,
+                                    double const*restrict src,
+                                    long d);
+extern void tpl_filter_x4_dilated_d(long n,
+                                    double *restrict dst,
+                                    double const*restrict ker,
+                                    double const*restrict src,
+                                    long d);
+extern void tpl_filter_x5_dilated_d(long n,
+                                    double *restrict dst,
+                                    double const*restrict ker,
+                                    double const*restrict src,
+                                    long d);
+
+/**
+ * @def tpl_filter_bank(nk,m,n,dst,ker,src)
+ *
+ * @brief Apply several filters to the same source.
+ *
+ * The call `tpl_filter_bank(nk,m,n,dst,ker,src)` is equivalent to:
+ *
+ * ```.c
+ * for (long k = 0; k < nk; ++k) {
+ *     tpl_filter(m, n, dst + k*n, ker + k*m, src);
+ * }
+ * ```
+ *
+ * but the filters are applied by groups so that each chunk of source values
+ * is loaded once for several filters.
+ *
+ * @param nk    Number of filters.
+ * @param m     Number of coefficients of each filter.
+ * @param n     Number of elements of each output.
+ * @param dst   Destination array of `nk*n` elements.
+ * @param ker   Coefficients of the filters (`nk*m` elements, those of the
+ *              `k`-th filter start at `ker + k*m`).
+ * @param src   Source array. Must have at least `m + n - 1` elements.
+ */
+#define tpl_filter_bank(nk,m,n,dst,ker,src)             \
+    _Generic(*(dst),                                    \
+             float:  tpl_filter_bank_f,                 \
+             double: tpl_filter_bank_d)(nk,m,n,dst,ker,src)
+
+extern void tpl_filter_bank_f(long nk,
+                              long m,
+                              long n,
+                              float *restrict dst,
+                              float const*restrict ker,
+                              float const*restrict src);
+extern void tpl_filter_bank_d(long nk,
+                              long m,
+                              long n,
+                              double *restrict dst,
+                              double const*restrict ker,
+                              double const*restrict src);
+
+/**
+ * @def tpl_box_filter(m,n,dst,src)
+ *
+ * @brief Apply box filter (moving average).
+ *
+ * The call `tpl_box_filter(m,n,dst,src)` is equivalent to
+ * `tpl_filter(m,n,dst,ker,src)` with all `m` coefficients of `ker` equal to
+ * `1/m` but uses a running sum so that the cost per output does not depend on
+ * `m`.  The running sum is recomputed periodically to avoid the drift due to
+ * rounding errors.
+ *
+ * @param m     Width of the box.
+ * @param n     Number of elements in destination.
+ * @param dst   Destination array.  Must have at least `n` elements.
+ * @param src   Source array. Must have at least `m + n - 1` elements.
+ */
+#define tpl_box_filter(m,n,dst,src)                     \
+    _Generic(*(dst),                                    \
+             float:  tpl_box_filter_f,                  \
+             double: tpl_box_filter_d)(m,n,dst,src)
+
+extern void tpl_box_filter_f(long m,
+                             long n,
+                             float *restrict dst,
+                             float const*restrict src);
+extern void tpl_box_filter_d(long m,
+                             long n,
+                             double *restrict dst,
+                             double const*restrict src);
+
+/**
+ * @def tpl_min_filter(m,n,dst,src,wrk)
+ *
+ * @brief Apply sliding minimum filter.
+ *
+ * The call `tpl_min_filter(m,n,dst,src,wrk)` stores in `dst[i]` the minimum
+ * of `src[i]`, `src[i+1]`, ..., `src[i+m-1]` for `i = 0, ..., n-1`.  The
+ * algorithm of van Herk (1992) and Gil & Werman (1993) is used so that the
+ * number of comparisons per output (3) does not depend on `m`.
+ *
+ * @param m     Width of the window.
+ * @param n     Number of elements in destination.
+ * @param dst   Destination array.  Must have at least `n` elements.  Can be
+ *              the same as `src`.
+ * @param src   Source array. Must have at least `m + n - 1` elements.
+ * @param wrk   Workspace.  Must have at least `m + n` elements.
+ *
+ * @see tpl_max_filter.
+ */
+#define tpl_min_filter(m,n,dst,src,wrk)                 \
+    _Generic(*(dst),                                    \
+             float:  tpl_min_filter_f,                  \
+             double: tpl_min_filter_d)(m,n,dst,src,wrk)
+
+/**
+ * @def tpl_max_filter(m,n,dst,src,wrk)
+ *
+ * @brief Apply sliding maximum filter.
+ *
+ * This macro is the same as tpl_min_filter() but for the maximum.
+ */
+#define tpl_max_filter(m,n,dst,src,wrk)                 \
+    _Generic(*(dst),                                    \
+             float:  tpl_max_filter_f,                  \
+             double: tpl_max_filter_d)(m,n,dst,src,wrk)
+
+extern void tpl_min_filter_f(long m,
+                             long n,
+                             float* dst,
+                             float const* src,
+                             float*restrict wrk);
+extern void tpl_min_filter_d(long m,
+                             long n,
+                             double* dst,
+                             double const* src,
+                             double*restrict wrk);
+extern void tpl_max_filter_f(long m,
+                             long n,
+                             float* dst,
+                             float const* src,
+                             float*restrict wrk);
+extern void tpl_max_filter_d(long m,
+                             long n,
+                             double* dst,
+                             double const* src,
+                             double*restrict wrk);
+
+/**
+ * @def tpl_gauss_filter(n,dst,src,sigma,order)
+ *
+ * @brief Apply recursive Gaussian filter.
+ *
+ * The call `tpl_gauss_filter(n,dst,src,sigma,order)` smoothes the `n`
+ * elements of `src` by a Gaussian of standard deviation `sigma` (in samples)
+ * and stores the result in `dst`.  If `order` is 1 or 2, the first or second
+ * derivative of the smoothed signal is computed by central differences.
+ *
+ * The filter is the 3rd order recursive filter of Young & van Vliet (1995)
+ * with the exact initial conditions of Triggs & Sdika (2006) for the
+ * anti-causal pass.  The cost per element does not depend on `sigma`.  The
+ * source is extended by its end values as in tpl_load_contiguous_flat().
+ * The impulse response approximates the Gaussian within a few percent of its
+ * peak, the approximation is worse for `sigma < 2`.
+ *
+ * @param n     Number of elements.
+ * @param dst   Destination array.  Must have at least `n` elements and can be
+ *              the same as `src`.
+ * @param src   Source array.  Must have at least `n` elements.
+ * @param sigma Standard deviation of the Gaussian, must be at least 0.5.
+ * @param order Order of derivative: 0, 1 or 2.
+ *
+ * @return 0 on success, -1 if `sigma` or `order` is invalid.
+ */
+#define tpl_gauss_filter(n,dst,src,sigma,order)         \
+    _Generic(*(dst),                                    \
+             float:  tpl_gauss_filter_f,                \
+             double: tpl_gauss_filter_d)(n,dst,src,sigma,order)
+
+extern int tpl_gauss_filter_f(long n,
+                              float* dst,
+                              float const* src,
+                              double sigma,
+                              int order);
+extern int tpl_gauss_filter_d(long n,
+                              double* dst,
+                              double const* src,
+                              double sigma,
+                              int order);
+
 _TPL_EXTERN_C_END
 
 #endif /* _TPL_FILTER_H */
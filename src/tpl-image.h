@@ -14,6 +14,8 @@
 #define _TPL_IMAGE_H 1
 
 #include <pvc.h>
+#include <tpl-pool.h>
+#include <tpl-reduce.h>
 
 _PVC_EXTERN_C_BEGIN
 
@@ -49,7 +51,7 @@ _PVC_EXTERN_C_BEGIN
     _Generic(*(dst),                                    \
              float:  tpl_filter_2d_f,                   \
              double: tpl_filter_2d_d)                   \
-    (dim, dst, dst_len1, dst_len2, ker,                 \
+    (dim, dst, dst_len1, dst_len2, ker, ker_len,        \
      src, src_len1, src_len2, k1, k2, wrk1, wrk2)
 
 extern void
@@ -82,6 +84,229 @@ tpl_filter_2d_d(int dim,
                 double*restrict wrk1,
                 double*restrict wrk2);
 
+/**
+ * Apply a simple filter along a dimension of an image using a pool of
+ * threads.
+ *
+ * This function yields the same result as tpl_filter_2d() but the rows of
+ * the destination (i.e., along its 2nd dimension) are split in contiguous
+ * blocks processed by the threads of `pool`.  Each thread uses its own part
+ * of the workspaces.
+ *
+ * @param pool       Pool of threads (can be `NULL` to run in the calling
+ *                   thread).
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination array.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param ker        Filter coefficients.
+ * @param ker_len    Number of filter coefficients.
+ * @param src        Source array.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk1       Primary workspace.  Must have at least
+ *                   `n*TPL_ALIGNED_LENGTH(len, sizeof(*dst))` elements with
+ *                   `n = tpl_pool_size(pool)` and `len` the size needed by
+ *                   tpl_filter_2d().
+ * @param wrk2       Secondary workspace.  Unused (can be `NULL`) if
+ *                   `dim = 1`, must have at least
+ *                   `n*TPL_ALIGNED_LENGTH(dst_len2, sizeof(*dst))` elements
+ *                   if `dim = 2`.
+ *
+ * @see tpl_create_pool.
+ */
+#define tpl_filter_2d_parallel(pool, dim, dst, dst_len1, dst_len2,      \
+                               ker, ker_len,                            \
+                               src, src_len1, src_len2,                 \
+                               k1, k2, wrk1, wrk2)                      \
+    _Generic(*(dst),                                                    \
+             float:  tpl_filter_2d_parallel_f,                          \
+             double: tpl_filter_2d_parallel_d)                          \
+    (pool, dim, dst, dst_len1, dst_len2, ker, ker_len,                  \
+     src, src_len1, src_len2, k1, k2, wrk1, wrk2)
+
+extern void
+tpl_filter_2d_parallel_f(TPL_Pool* pool,
+                         int dim,
+                         float*restrict dst,
+                         long dst_len1,
+                         long dst_len2,
+                         float const*restrict ker,
+                         long ker_len,
+                         float const*restrict src,
+                         long src_len1,
+                         long src_len2,
+                         long k1,
+                         long k2,
+                         float*restrict wrk1,
+                         float*restrict wrk2);
+
+extern void
+tpl_filter_2d_parallel_d(TPL_Pool* pool,
+                         int dim,
+                         double*restrict dst,
+                         long dst_len1,
+                         long dst_len2,
+                         double const*restrict ker,
+                         long ker_len,
+                         double const*restrict src,
+                         long src_len1,
+                         long src_len2,
+                         long k1,
+                         long k2,
+                         double*restrict wrk1,
+                         double*restrict wrk2);
+
+/**
+ * Apply a simple filter along a dimension of a batch of images.
+ *
+ * This function yields the same results as `nimgs` calls to tpl_filter_2d()
+ * with the same filter and offsets, the `j`-th call filtering `src[j]` into
+ * `dst[j]`.  The images may have different sizes, they are processed in
+ * parallel by the threads of `pool` with load balancing (see
+ * tpl_pool_run_jobs()).
+ *
+ * @param pool       Pool of threads (can be `NULL` to run in the calling
+ *                   thread).
+ * @param nimgs      Number of images.
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination arrays.
+ * @param dst_len1   Lengths of 1st dimension of destination arrays.
+ * @param dst_len2   Lengths of 2nd dimension of destination arrays.
+ * @param ker        Filter coefficients.
+ * @param ker_len    Number of filter coefficients.
+ * @param src        Source arrays.
+ * @param src_len1   Lengths of 1st dimension of source arrays.
+ * @param src_len2   Lengths of 2nd dimension of source arrays.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk1       Primary workspace.  Must have at least
+ *                   `n*TPL_ALIGNED_LENGTH(len + ker_len - 1, sizeof(**dst))`
+ *                   elements with `n = tpl_pool_size(pool)` and `len` the
+ *                   maximum length of the dimension of interest of the
+ *                   destination arrays.
+ * @param wrk2       Secondary workspace.  Unused (can be `NULL`) if
+ *                   `dim = 1`, must have at least
+ *                   `n*TPL_ALIGNED_LENGTH(len2, sizeof(**dst))` elements with
+ *                   `len2` the maximum of `dst_len2` if `dim = 2`.
+ *
+ * @see tpl_filter_2d_parallel for splitting a single image.
+ */
+#define tpl_filter_2d_batch(pool, nimgs, dim, dst, dst_len1, dst_len2,  \
+                            ker, ker_len,                               \
+                            src, src_len1, src_len2,                    \
+                            k1, k2, wrk1, wrk2)                         \
+    _Generic(**(dst),                                                   \
+             float:  tpl_filter_2d_batch_f,                             \
+             double: tpl_filter_2d_batch_d)                             \
+    (pool, nimgs, dim, dst, dst_len1, dst_len2, ker, ker_len,           \
+     src, src_len1, src_len2, k1, k2, wrk1, wrk2)
+
+extern void
+tpl_filter_2d_batch_f(TPL_Pool* pool,
+                      long nimgs,
+                      int dim,
+                      float* const dst[],
+                      long const dst_len1[],
+                      long const dst_len2[],
+                      float const*restrict ker,
+                      long ker_len,
+                      float const* const src[],
+                      long const src_len1[],
+                      long const src_len2[],
+                      long k1,
+                      long k2,
+                      float*restrict wrk1,
+                      float*restrict wrk2);
+
+extern void
+tpl_filter_2d_batch_d(TPL_Pool* pool,
+                      long nimgs,
+                      int dim,
+                      double* const dst[],
+                      long const dst_len1[],
+                      long const dst_len2[],
+                      double const*restrict ker,
+                      long ker_len,
+                      double const* const src[],
+                      long const src_len1[],
+                      long const src_len2[],
+                      long k1,
+                      long k2,
+                      double*restrict wrk1,
+                      double*restrict wrk2);
+
+/**
+ * Apply a simple filter along a dimension of an image stored in a file.
+ *
+ * This function yields the same result as tpl_filter_2d() for images too
+ * large to fit in memory.  The source and destination are raw column-major
+ * arrays of elements of the same type as `ker` at the beginning of the files
+ * `src_fd` and `dst_fd`.  The destination is computed by strips of
+ * `strip_len` consecutive rows (along the 2nd dimension) from the source
+ * rows needed by each strip (`ker_len - 1` rows overlap between strips if
+ * `dim = 2`).  Reading, filtering and writing are done by different threads
+ * (see tpl_create_pipeline()) with two buffers per stage, so that I/O
+ * overlaps computations.  The memory used is of the order of
+ * `2*(src_len1*(strip_len + ker_len) + dst_len1*strip_len)` elements
+ * whatever the size of the images.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst_fd     File descriptor of destination, open for writing.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param ker        Filter coefficients.
+ * @param ker_len    Number of filter coefficients.
+ * @param src_fd     File descriptor of source, open for reading.  Must
+ *                   support positioned reads (e.g. a regular file).
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param strip_len  Number of destination rows per strip.
+ *
+ * @return `0` on success, `-1` on error with `errno` set.
+ */
+#define tpl_filter_2d_stream(dim, dst_fd, dst_len1, dst_len2,           \
+                             ker, ker_len,                              \
+                             src_fd, src_len1, src_len2,                \
+                             k1, k2, strip_len)                         \
+    _Generic(*(ker),                                                    \
+             float:  tpl_filter_2d_stream_f,                            \
+             double: tpl_filter_2d_stream_d)                            \
+    (dim, dst_fd, dst_len1, dst_len2, ker, ker_len,                     \
+     src_fd, src_len1, src_len2, k1, k2, strip_len)
+
+extern int
+tpl_filter_2d_stream_f(int dim,
+                       int dst_fd,
+                       long dst_len1,
+                       long dst_len2,
+                       float const* ker,
+                       long ker_len,
+                       int src_fd,
+                       long src_len1,
+                       long src_len2,
+                       long k1,
+                       long k2,
+                       long strip_len);
+
+extern int
+tpl_filter_2d_stream_d(int dim,
+                       int dst_fd,
+                       long dst_len1,
+                       long dst_len2,
+                       double const* ker,
+                       long ker_len,
+                       int src_fd,
+                       long src_len1,
+                       long src_len2,
+                       long k1,
+                       long k2,
+                       long strip_len);
+
 /**
  * Apply a simple filter along a dimension of an image.
  *
@@ -115,7 +340,7 @@ tpl_filter_2d_d(int dim,
     _Generic(*(dst),                                    \
              float:  tpl_filter_2d_ref_f,               \
              double: tpl_filter_2d_ref_d)               \
-    (dim, dst, dst_len1, dst_len2, ker,                 \
+    (dim, dst, dst_len1, dst_len2, ker, ker_len,        \
      src, src_len1, src_len2, k1, k2, wrk1, wrk2)
 
 extern void
@@ -148,6 +373,777 @@ tpl_filter_2d_ref_d(int dim,
                     double*restrict wrk1,
                     double*restrict wrk2);
 
+/**
+ * Apply a simple filter along a dimension of a raw detector image.
+ *
+ * This function is the same as tpl_filter_2d() except that the per-pixel
+ * affine calibration `(src - off)*scl` is applied to the source values while
+ * they are loaded into the workspace (see tpl_load_contiguous_flat_calib()
+ * and tpl_load_strided_flat_calib()), so that the calibrated and filtered
+ * image is obtained in a single sweep over the raw image.  Typically `off` is
+ * the dark and `scl` the gain divided by the flat field.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination array.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param ker        Filter coefficients.
+ * @param ker_len    Number of filter coefficients.
+ * @param src        Source (raw) array.
+ * @param off        Calibration offsets, same size as `src`.
+ * @param scl        Calibration factors, same size as `src`.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk1       Primary workspace, same as for tpl_filter_2d().
+ * @param wrk2       Secondary workspace, same as for tpl_filter_2d().
+ */
+#define tpl_filter_2d_calib(dim, dst, dst_len1, dst_len2,       \
+                            ker, ker_len, src, off, scl,        \
+                            src_len1, src_len2,                 \
+                            k1, k2, wrk1, wrk2)                 \
+    _Generic(*(dst),                                            \
+             float:  tpl_filter_2d_calib_f,                     \
+             double: tpl_filter_2d_calib_d)                     \
+    (dim, dst, dst_len1, dst_len2, ker, ker_len, src, off, scl, \
+     src_len1, src_len2, k1, k2, wrk1, wrk2)
+
+extern void
+tpl_filter_2d_calib_f(int dim,
+                      float*restrict dst,
+                      long dst_len1,
+                      long dst_len2,
+                      float const*restrict ker,
+                      long ker_len,
+                      float const*restrict src,
+                      float const*restrict off,
+                      float const*restrict scl,
+                      long src_len1,
+                      long src_len2,
+                      long k1,
+                      long k2,
+                      float*restrict wrk1,
+                      float*restrict wrk2);
+
+extern void
+tpl_filter_2d_calib_d(int dim,
+                      double*restrict dst,
+                      long dst_len1,
+                      long dst_len2,
+                      double const*restrict ker,
+                      long ker_len,
+                      double const*restrict src,
+                      double const*restrict off,
+                      double const*restrict scl,
+                      long src_len1,
+                      long src_len2,
+                      long k1,
+                      long k2,
+                      double*restrict wrk1,
+                      double*restrict wrk2);
+
+/**
+ * Apply a simple filter along a dimension of an image and reduce the result.
+ *
+ * This function is the same as tpl_filter_2d() except that the moments of the
+ * destination (see ::TPL_Moments) are accumulated line by line right after
+ * each line has been filtered, while it is still in cache, which saves a
+ * second sweep over the destination to compute its centroid, extrema, etc.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination array.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param ker        Filter coefficients.
+ * @param ker_len    Number of filter coefficients.
+ * @param src        Source array.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk1       Primary workspace, same as for tpl_filter_2d().
+ * @param wrk2       Secondary workspace, same as for tpl_filter_2d().
+ * @param mom        Moments to update, must have been initialized by
+ *                   tpl_initialize_moments() or by a previous reduction.
+ */
+#define tpl_filter_2d_reduce(dim, dst, dst_len1, dst_len2,      \
+                             ker, ker_len,                      \
+                             src, src_len1, src_len2,           \
+                             k1, k2, wrk1, wrk2, mom)           \
+    _Generic(*(dst),                                            \
+             float:  tpl_filter_2d_reduce_f,                    \
+             double: tpl_filter_2d_reduce_d)                    \
+    (dim, dst, dst_len1, dst_len2, ker, ker_len,                \
+     src, src_len1, src_len2, k1, k2, wrk1, wrk2, mom)
+
+extern void
+tpl_filter_2d_reduce_f(int dim,
+                       float*restrict dst,
+                       long dst_len1,
+                       long dst_len2,
+                       float const*restrict ker,
+                       long ker_len,
+                       float const*restrict src,
+                       long src_len1,
+                       long src_len2,
+                       long k1,
+                       long k2,
+                       float*restrict wrk1,
+                       float*restrict wrk2,
+                       TPL_Moments* mom);
+
+extern void
+tpl_filter_2d_reduce_d(int dim,
+                       double*restrict dst,
+                       long dst_len1,
+                       long dst_len2,
+                       double const*restrict ker,
+                       long ker_len,
+                       double const*restrict src,
+                       long src_len1,
+                       long src_len2,
+                       long k1,
+                       long k2,
+                       double*restrict wrk1,
+                       double*restrict wrk2,
+                       TPL_Moments* mom);
+
+/**
+ * Apply a simple filter along a dimension of an image and propagate the
+ * variance.
+ *
+ * This function is the same as tpl_filter_2d() applied to `src` and also
+ * stores in `dst_var` the variance of the result given the variance
+ * `src_var` of independent source values, that is `src_var` filtered with
+ * the squared kernel.  Lines of data and variance are processed together by
+ * tpl_filter_var() so that indexing, boundary conditions and loop overheads
+ * are shared.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination array.
+ * @param dst_var    Destination variance, same size as `dst`.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param ker        Filter coefficients.
+ * @param ker_len    Number of filter coefficients.
+ * @param src        Source array.
+ * @param src_var    Source variance, same size as `src`.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk1       Primary workspace, twice the size needed by
+ *                   tpl_filter_2d().
+ * @param wrk2       Secondary workspace, twice the size needed by
+ *                   tpl_filter_2d().
+ */
+#define tpl_filter_2d_var(dim, dst, dst_var, dst_len1, dst_len2,        \
+                          ker, ker_len, src, src_var,                   \
+                          src_len1, src_len2, k1, k2, wrk1, wrk2)       \
+    _Generic(*(dst),                                                    \
+             float:  tpl_filter_2d_var_f,                               \
+             double: tpl_filter_2d_var_d)                               \
+    (dim, dst, dst_var, dst_len1, dst_len2, ker, ker_len, src, src_var, \
+     src_len1, src_len2, k1, k2, wrk1, wrk2)
+
+extern void
+tpl_filter_2d_var_f(int dim,
+                    float*restrict dst,
+                    float*restrict dst_var,
+                    long dst_len1,
+                    long dst_len2,
+                    float const*restrict ker,
+                    long ker_len,
+                    float const*restrict src,
+                    float const*restrict src_var,
+                    long src_len1,
+                    long src_len2,
+                    long k1,
+                    long k2,
+                    float*restrict wrk1,
+                    float*restrict wrk2);
+
+extern void
+tpl_filter_2d_var_d(int dim,
+                    double*restrict dst,
+                    double*restrict dst_var,
+                    long dst_len1,
+                    long dst_len2,
+                    double const*restrict ker,
+                    long ker_len,
+                    double const*restrict src,
+                    double const*restrict src_var,
+                    long src_len1,
+                    long src_len2,
+                    long k1,
+                    long k2,
+                    double*restrict wrk1,
+                    double*restrict wrk2);
+
+/**
+ * Types of masks of valid pixels.
+ */
+typedef enum {
+    TPL_MASK_UINT8 = 0, /**< One byte per pixel, nonzero for valid pixels. */
+    TPL_MASK_BITS  = 1  /**< One bit per pixel, set for valid pixels; the bit
+                             of pixel `p` (linear index in column-major order)
+                             is bit `p & 7` of byte `p >> 3`. */
+} TPL_MaskType;
+
+/**
+ * Apply a separable normalized convolution to an image with bad pixels.
+ *
+ * The result is the ratio of the separable filter applied to the data
+ * multiplied by the mask and of the same filter applied to the mask:
+ *
+ * ```
+ * dst = (ker2 * (ker1 * (msk·src))) / (ker2 * (ker1 * msk))
+ * ```
+ *
+ * with `ker1` and `ker2` applied along the 1st and 2nd dimensions as in
+ * tpl_filter_2d() (offsets `k1` and `k2`, flat boundary conditions).  The
+ * result is zero where there are no valid pixels in the support of the
+ * filter.  Numerator and denominator are computed in the same sweep: each
+ * source row is read once with its mask and filtered along the 1st dimension
+ * into ring buffers of `ker2_len` rows which are then combined.
+ *
+ * @param dst        Destination array.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param ker1       Filter coefficients along 1st dimension.
+ * @param ker1_len   Number of filter coefficients along 1st dimension.
+ * @param ker2       Filter coefficients along 2nd dimension.
+ * @param ker2_len   Number of filter coefficients along 2nd dimension.
+ * @param src        Source array.
+ * @param msk_type   Type of mask.
+ * @param msk        Mask of valid source pixels.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk        Workspace of at least `2*(ker2_len + 1)*dst_len1 +
+ *                   2*(ker1_len - 1)` elements.
+ *
+ * @return 0 on success, -1 if `msk_type` is invalid.
+ */
+#define tpl_masked_filter_2d(dst, dst_len1, dst_len2,                   \
+                             ker1, ker1_len, ker2, ker2_len,            \
+                             src, msk_type, msk, src_len1, src_len2,    \
+                             k1, k2, wrk)                               \
+    _Generic(*(dst),                                                    \
+             float:  tpl_masked_filter_2d_f,                            \
+             double: tpl_masked_filter_2d_d)                            \
+    (dst, dst_len1, dst_len2, ker1, ker1_len, ker2, ker2_len,           \
+     src, msk_type, msk, src_len1, src_len2, k1, k2, wrk)
+
+extern int
+tpl_masked_filter_2d_f(float*restrict dst,
+                       long dst_len1,
+                       long dst_len2,
+                       float const*restrict ker1,
+                       long ker1_len,
+                       float const*restrict ker2,
+                       long ker2_len,
+                       float const*restrict src,
+                       TPL_MaskType msk_type,
+                       void const* msk,
+                       long src_len1,
+                       long src_len2,
+                       long k1,
+                       long k2,
+                       float*restrict wrk);
+
+extern int
+tpl_masked_filter_2d_d(double*restrict dst,
+                       long dst_len1,
+                       long dst_len2,
+                       double const*restrict ker1,
+                       long ker1_len,
+                       double const*restrict ker2,
+                       long ker2_len,
+                       double const*restrict src,
+                       TPL_MaskType msk_type,
+                       void const* msk,
+                       long src_len1,
+                       long src_len2,
+                       long k1,
+                       long k2,
+                       double*restrict wrk);
+
+/**
+ * Gradient operators for tpl_gradient_2d().
+ */
+typedef enum {
+    TPL_SOBEL  = 0, /**< Sobel operator, smoothing by `[1,2,1]/4`. */
+    TPL_SCHARR = 1  /**< Scharr operator, smoothing by `[3,10,3]/16`. */
+} TPL_GradientOperator;
+
+/**
+ * Compute the gradient of an image by a Sobel or Scharr operator.
+ *
+ * The components of the gradient are the central differences `(a[i+1] -
+ * a[i-1])/2` along one dimension of the image smoothed along the other
+ * dimension by the normalized weights of the operator, so they are in units
+ * of the image per pixel.  Boundary conditions are flat.  The magnitude and
+ * the orientation of the gradient are optionally computed in the same sweep.
+ * The vertical smoothing and differences of three consecutive rows of the
+ * image are shared by the two components.
+ *
+ * @param op         Gradient operator.
+ * @param gx         Destination for the derivative along 1st dimension.
+ * @param gy         Destination for the derivative along 2nd dimension.
+ * @param mag        Destination for the magnitude `sqrt(gx^2 + gy^2)` or
+ *                   `NULL`.
+ * @param ang        Destination for the orientation `atan2(gy,gx)` (in
+ *                   radians) or `NULL`.
+ * @param src        Source image.
+ * @param len1       Length of 1st dimension of the images.
+ * @param len2       Length of 2nd dimension of the images.
+ * @param wrk        Workspace of at least `2*(len1 + 2)` elements.
+ *
+ * @return 0 on success, -1 if `op` is invalid.
+ */
+#define tpl_gradient_2d(op, gx, gy, mag, ang, src, len1, len2, wrk)     \
+    _Generic(*(gx),                                                     \
+             float:  tpl_gradient_2d_f,                                 \
+             double: tpl_gradient_2d_d)                                 \
+    (op, gx, gy, mag, ang, src, len1, len2, wrk)
+
+extern int
+tpl_gradient_2d_f(TPL_GradientOperator op,
+                  float*restrict gx,
+                  float*restrict gy,
+                  float*restrict mag,
+                  float*restrict ang,
+                  float const*restrict src,
+                  long len1,
+                  long len2,
+                  float*restrict wrk);
+
+extern int
+tpl_gradient_2d_d(TPL_GradientOperator op,
+                  double*restrict gx,
+                  double*restrict gy,
+                  double*restrict mag,
+                  double*restrict ang,
+                  double const*restrict src,
+                  long len1,
+                  long len2,
+                  double*restrict wrk);
+
+/**
+ * Apply a bank of filters along a dimension of an image.
+ *
+ * This function yields the same results as `nk` calls to tpl_filter_2d()
+ * with the same source but the filters are applied by groups so that each
+ * source value is loaded once for several filters.  The `nk` results are
+ * stored in consecutive images of `dst_len1*dst_len2` pixels.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param nk         Number of filters.
+ * @param dst        Destination array of `nk*dst_len1*dst_len2` elements.
+ * @param dst_len1   Length of 1st dimension of destination images.
+ * @param dst_len2   Length of 2nd dimension of destination images.
+ * @param ker        Filter coefficients (`nk*ker_len` elements, those of the
+ *                   `k`-th filter start at `ker + k*ker_len`).
+ * @param ker_len    Number of coefficients of each filter.
+ * @param src        Source array.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk        Workspace.  Must have at least `dst_len1 + ker_len - 1`
+ *                   elements if `dim = 1`, `nk*dst_len1` elements if
+ *                   `dim = 2`.
+ */
+#define tpl_filter_bank_2d(dim, nk, dst, dst_len1, dst_len2,    \
+                           ker, ker_len,                        \
+                           src, src_len1, src_len2,             \
+                           k1, k2, wrk)                         \
+    _Generic(*(dst),                                            \
+             float:  tpl_filter_bank_2d_f,                      \
+             double: tpl_filter_bank_2d_d)                      \
+    (dim, nk, dst, dst_len1, dst_len2, ker, ker_len,            \
+     src, src_len1, src_len2, k1, k2, wrk)
+
+extern void
+tpl_filter_bank_2d_f(int dim,
+                     long nk,
+                     float*restrict dst,
+                     long dst_len1,
+                     long dst_len2,
+                     float const*restrict ker,
+                     long ker_len,
+                     float const*restrict src,
+                     long src_len1,
+                     long src_len2,
+                     long k1,
+                     long k2,
+                     float*restrict wrk);
+
+extern void
+tpl_filter_bank_2d_d(int dim,
+                     long nk,
+                     double*restrict dst,
+                     long dst_len1,
+                     long dst_len2,
+                     double const*restrict ker,
+                     long ker_len,
+                     double const*restrict src,
+                     long src_len1,
+                     long src_len2,
+                     long k1,
+                     long k2,
+                     double*restrict wrk);
+
+/**
+ * Apply a dilated (à-trous) filter along a dimension of an image.
+ *
+ * This function is the same as tpl_filter_2d() except that there are holes
+ * of `dil - 1` pixels between the filter coefficients, that is the
+ * coefficient `ker[k]` applies to the source pixel at offset `k*dil` along
+ * the dimension of interest.  When `dim = 2`, whole rows are combined so
+ * that all columns are processed together.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination array.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param ker        Filter coefficients.
+ * @param ker_len    Number of filter coefficients.
+ * @param dil        Dilation factor (`dil = 1` for no holes).
+ * @param src        Source array.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk        Workspace.  Must have at least `dst_len1 + (ker_len -
+ *                   1)*dil` elements if `dim = 1`, `dst_len1` elements if
+ *                   `dim = 2`.
+ */
+#define tpl_filter_2d_dilated(dim, dst, dst_len1, dst_len2,     \
+                              ker, ker_len, dil,                \
+                              src, src_len1, src_len2,          \
+                              k1, k2, wrk)                      \
+    _Generic(*(dst),                                            \
+             float:  tpl_filter_2d_dilated_f,                   \
+             double: tpl_filter_2d_dilated_d)                   \
+    (dim, dst, dst_len1, dst_len2, ker, ker_len, dil,           \
+     src, src_len1, src_len2, k1, k2, wrk)
+
+extern void
+tpl_filter_2d_dilated_f(int dim,
+                        float*restrict dst,
+                        long dst_len1,
+                        long dst_len2,
+                        float const*restrict ker,
+                        long ker_len,
+                        long dil,
+                        float const*restrict src,
+                        long src_len1,
+                        long src_len2,
+                        long k1,
+                        long k2,
+                        float*restrict wrk);
+
+extern void
+tpl_filter_2d_dilated_d(int dim,
+                        double*restrict dst,
+                        long dst_len1,
+                        long dst_len2,
+                        double const*restrict ker,
+                        long ker_len,
+                        long dil,
+                        double const*restrict src,
+                        long src_len1,
+                        long src_len2,
+                        long k1,
+                        long k2,
+                        double*restrict wrk);
+
+/**
+ * Compute the starlet transform of an image.
+ *
+ * The starlet (or isotropic undecimated wavelet) transform is computed by
+ * the à-trous algorithm with the B3-spline kernel `[1,4,6,4,1]/16` applied
+ * separably with holes of size `2^j - 1` at scale `j` and flat boundary
+ * conditions.  The result consists in `nscales + 1` planes of `len1*len2`
+ * pixels stored contiguously in `wav`: the details at scales `0`, ...,
+ * `nscales - 1` followed by the last smooth approximation.  The sum of all
+ * planes yields the original image (see tpl_starlet_2d_rec()).
+ *
+ * @param nscales    Number of scales.
+ * @param wav        Destination array of `(nscales + 1)*len1*len2` elements.
+ * @param src        Source image.
+ * @param len1       Length of 1st dimension of the image.
+ * @param len2       Length of 2nd dimension of the image.
+ * @param wrk        Workspace.  Must have at least `len1*len2 + len1 +
+ *                   2^(nscales + 1)` elements.
+ */
+#define tpl_starlet_2d(nscales, wav, src, len1, len2, wrk)      \
+    _Generic(*(wav),                                            \
+             float:  tpl_starlet_2d_f,                          \
+             double: tpl_starlet_2d_d)                          \
+    (nscales, wav, src, len1, len2, wrk)
+
+extern void
+tpl_starlet_2d_f(int nscales,
+                 float*restrict wav,
+                 float const*restrict src,
+                 long len1,
+                 long len2,
+                 float*restrict wrk);
+
+extern void
+tpl_starlet_2d_d(int nscales,
+                 double*restrict wav,
+                 double const*restrict src,
+                 long len1,
+                 long len2,
+                 double*restrict wrk);
+
+/**
+ * Reconstruct an image from its starlet transform.
+ *
+ * @param nscales    Number of scales.
+ * @param dst        Destination image of `len1*len2` elements.
+ * @param wav        Starlet transform computed by tpl_starlet_2d().
+ * @param len1       Length of 1st dimension of the image.
+ * @param len2       Length of 2nd dimension of the image.
+ */
+#define tpl_starlet_2d_rec(nscales, dst, wav, len1, len2)       \
+    _Generic(*(dst),                                            \
+             float:  tpl_starlet_2d_rec_f,                      \
+             double: tpl_starlet_2d_rec_d)                      \
+    (nscales, dst, wav, len1, len2)
+
+extern void
+tpl_starlet_2d_rec_f(int nscales,
+                     float*restrict dst,
+                     float const*restrict wav,
+                     long len1,
+                     long len2);
+
+extern void
+tpl_starlet_2d_rec_d(int nscales,
+                     double*restrict dst,
+                     double const*restrict wav,
+                     long len1,
+                     long len2);
+
+/**
+ * Apply a box filter (moving average) along a dimension of an image.
+ *
+ * This function yields the same result as tpl_filter_2d() with `box_len`
+ * coefficients all equal to `1/box_len` but uses running sums so that the
+ * cost per pixel does not depend on `box_len`.  When `dim = 2`, running sums
+ * of whole rows are updated so that all columns are processed together.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination array.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param box_len    Width of the box.
+ * @param src        Source array.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk        Workspace.  Must have at least `dst_len1 + box_len - 1`
+ *                   elements if `dim = 1`, `dst_len1` elements if `dim = 2`.
+ */
+#define tpl_box_filter_2d(dim, dst, dst_len1, dst_len2, \
+                          box_len,                      \
+                          src, src_len1, src_len2,      \
+                          k1, k2, wrk)                  \
+    _Generic(*(dst),                                    \
+             float:  tpl_box_filter_2d_f,               \
+             double: tpl_box_filter_2d_d)               \
+    (dim, dst, dst_len1, dst_len2, box_len,             \
+     src, src_len1, src_len2, k1, k2, wrk)
+
+extern void
+tpl_box_filter_2d_f(int dim,
+                    float*restrict dst,
+                    long dst_len1,
+                    long dst_len2,
+                    long box_len,
+                    float const*restrict src,
+                    long src_len1,
+                    long src_len2,
+                    long k1,
+                    long k2,
+                    float*restrict wrk);
+
+extern void
+tpl_box_filter_2d_d(int dim,
+                    double*restrict dst,
+                    long dst_len1,
+                    long dst_len2,
+                    long box_len,
+                    double const*restrict src,
+                    long src_len1,
+                    long src_len2,
+                    long k1,
+                    long k2,
+                    double*restrict wrk);
+
+/**
+ * Apply a sliding minimum filter along a dimension of an image.
+ *
+ * This function is the morphological counterpart of tpl_filter_2d(): it
+ * yields the minimum (instead of the weighted sum) of the `box_len` source
+ * values in the window, with the same offsets and flat boundary conditions.
+ * The algorithm of van Herk and Gil & Werman is used so that the cost per
+ * pixel does not depend on `box_len`.  Lines are processed by blocks of 16
+ * interleaved in the workspace so that the comparisons are vectorized.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination array.
+ * @param dst_len1   Length of 1st dimension of destination array.
+ * @param dst_len2   Length of 2nd dimension of destination array.
+ * @param box_len    Width of the window.
+ * @param src        Source array.
+ * @param src_len1   Length of 1st dimension of source array.
+ * @param src_len2   Length of 2nd dimension of source array.
+ * @param k1         Offset along 1st dimension.
+ * @param k2         Offset along 2nd dimension.
+ * @param wrk        Workspace.  Must have at least `32*(dst_len + box_len)`
+ *                   elements with `dst_len` the length of the dimension of
+ *                   interest in the destination array.
+ *
+ * @see tpl_max_filter_2d.
+ */
+#define tpl_min_filter_2d(dim, dst, dst_len1, dst_len2, \
+                          box_len,                      \
+                          src, src_len1, src_len2,      \
+                          k1, k2, wrk)                  \
+    _Generic(*(dst),                                    \
+             float:  tpl_min_filter_2d_f,               \
+             double: tpl_min_filter_2d_d)               \
+    (dim, dst, dst_len1, dst_len2, box_len,             \
+     src, src_len1, src_len2, k1, k2, wrk)
+
+/**
+ * Apply a sliding maximum filter along a dimension of an image.
+ *
+ * This function is the same as tpl_min_filter_2d() but for the maximum.
+ */
+#define tpl_max_filter_2d(dim, dst, dst_len1, dst_len2, \
+                          box_len,                      \
+                          src, src_len1, src_len2,      \
+                          k1, k2, wrk)                  \
+    _Generic(*(dst),                                    \
+             float:  tpl_max_filter_2d_f,               \
+             double: tpl_max_filter_2d_d)               \
+    (dim, dst, dst_len1, dst_len2, box_len,             \
+     src, src_len1, src_len2, k1, k2, wrk)
+
+extern void
+tpl_min_filter_2d_f(int dim,
+                    float*restrict dst,
+                    long dst_len1,
+                    long dst_len2,
+                    long box_len,
+                    float const*restrict src,
+                    long src_len1,
+                    long src_len2,
+                    long k1,
+                    long k2,
+                    float*restrict wrk);
+
+extern void
+tpl_min_filter_2d_d(int dim,
+                    double*restrict dst,
+                    long dst_len1,
+                    long dst_len2,
+                    long box_len,
+                    double const*restrict src,
+                    long src_len1,
+                    long src_len2,
+                    long k1,
+                    long k2,
+                    double*restrict wrk);
+
+extern void
+tpl_max_filter_2d_f(int dim,
+                    float*restrict dst,
+                    long dst_len1,
+                    long dst_len2,
+                    long box_len,
+                    float const*restrict src,
+                    long src_len1,
+                    long src_len2,
+                    long k1,
+                    long k2,
+                    float*restrict wrk);
+
+extern void
+tpl_max_filter_2d_d(int dim,
+                    double*restrict dst,
+                    long dst_len1,
+                    long dst_len2,
+                    long box_len,
+                    double const*restrict src,
+                    long src_len1,
+                    long src_len2,
+                    long k1,
+                    long k2,
+                    double*restrict wrk);
+
+/**
+ * Apply a recursive Gaussian filter along a dimension of an image.
+ *
+ * Column-major storage order is assumed for multi-dimensional arrays.  The
+ * image is smoothed by a Gaussian of standard deviation `sigma` along the
+ * dimension of interest, optionally followed by a central difference if
+ * `order` is 1 or 2 (see tpl_gauss_filter()).  Boundary conditions are the
+ * same as for tpl_filter_2d(): the image is extended by its edge values.
+ *
+ * Several lines are filtered at the same time so that the recursion is
+ * vectorized: rows of the image when `dim = 2`, blocks of 8 columns
+ * (transposed in the workspace) when `dim = 1`.
+ *
+ * @param dim        Dimension of interest (1 or 2).
+ * @param dst        Destination array (can be the same as `src`).
+ * @param src        Source array.
+ * @param len1       Length of 1st dimension of the arrays.
+ * @param len2       Length of 2nd dimension of the arrays.
+ * @param sigma      Standard deviation of the Gaussian (at least 0.5).
+ * @param order      Order of derivative: 0, 1 or 2.
+ * @param wrk        Workspace.  Must have at least `8*(len1 + 5)` elements
+ *                   if `dim = 1`, `5*len1` elements if `dim = 2`.
+ *
+ * @return 0 on success, -1 if an argument is invalid.
+ */
+#define tpl_gauss_filter_2d(dim, dst, src, len1, len2,  \
+                            sigma, order, wrk)          \
+    _Generic(*(dst),                                    \
+             float:  tpl_gauss_filter_2d_f,             \
+             double: tpl_gauss_filter_2d_d)             \
+    (dim, dst, src, len1, len2, sigma, order, wrk)
+
+extern int
+tpl_gauss_filter_2d_f(int dim,
+                      float* dst,
+                      float const* src,
+                      long len1,
+                      long len2,
+                      double sigma,
+                      int order,
+                      float*restrict wrk);
+
+extern int
+tpl_gauss_filter_2d_d(int dim,
+                      double* dst,
+                      double const* src,
+                      long len1,
+                      long len2,
+                      double sigma,
+                      int order,
+                      double*restrict wrk);
+
 /*
  * Nomenclature for specialized 2D separable linear filters.
  *
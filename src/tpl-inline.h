@@ -17,6 +17,12 @@
 #include <pvc-meta.h>
 #include <pvc-math.h>
 
+#if defined(__GNUC__) || defined(__clang__)
+#  define _TPL_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#  define _TPL_PREFETCH(addr) ((void)(addr))
+#endif
+
 /**
  * @def tpl_copy_contiguous(len,dst,src)
  *
@@ -265,6 +271,204 @@
 
 #endif /* _TPL_DOXYGEN_PARSING */
 
+/**
+ * @def tpl_load_strided_flat_prefetch(m, y, n, x, k, s, d)
+ *
+ * @brief Load strided values with software prefetching.
+ *
+ * The call `tpl_load_strided_flat_prefetch(m,y,n,x,k,s,d)` is the same as
+ * `tpl_load_strided_flat(m,y,n,x,k,s)` except that, when loading the `i`-th
+ * value, the source value needed `d` iterations later is prefetched.  This
+ * is useful when the stride `s` spans more than a memory page, which defeats
+ * hardware prefetchers, and the source is not in cache.
+ *
+ * @param m   Number of elements to copy.
+ * @param y   Address of first element of destination array.
+ * @param n   Number of strided elements in source array.
+ * @param x   Address of first element of source array.
+ * @param k   Index offset.
+ * @param s   Index increment in the source array.
+ * @param d   Prefetch distance (in number of elements).
+ *
+ * @see tpl_load_strided_flat.
+ */
+#ifdef _TPL_DOXYGEN_PARSING
+
+#define tpl_load_strided_flat_prefetch(m, y, n, x, k, s, d) ...
+
+#else /* _TPL_DOXYGEN_PARSING not defined */
+
+#define tpl_load_strided_flat_prefetch(m, y, n, x, k, s, d)             \
+    _Generic(*(y),                                                      \
+             float:  tpl_load_strided_flat_prefetch_f,                  \
+             double: tpl_load_strided_flat_prefetch_d)(m, y, n, x, k, s, d)
+
+#endif /* _TPL_DOXYGEN_PARSING */
+
+/**
+ * @def tpl_load_contiguous_flat_adj(m, y, n, x, k)
+ *
+ * @brief Apply the adjoint of tpl_load_contiguous_flat().
+ *
+ * The call `tpl_load_contiguous_flat_adj(m,y,n,x,k)` overwrites the `n`
+ * elements of the array `x` with the result of the adjoint (transpose) of the
+ * linear operator implemented by `tpl_load_contiguous_flat(m,y,n,x,k)`
+ * applied to the `m` elements of the array `y`.  It expands to inline code
+ * which is equivalent to:
+ *
+ * ```.c
+ * for (long j = 0; j < n; ++j) {
+ *     x[j] = 0;
+ * }
+ * for (long i = 0; i < m; ++i) {
+ *     long j = clamp(i + off, 0, srclen - 1);
+ *     x[j] += y[i];
+ * }
+ * ```
+ *
+ * where `clamp(a,lo,hi)` yields `min(max(a,lo),hi)`.
+ *
+ * @param m   Number of elements in `y`.
+ * @param y   Address of first element of source array.
+ * @param n   Number of elements in destination array.
+ * @param x   Address of first element of destination array.
+ * @param k   Index offset.
+ *
+ * @see tpl_load_contiguous_flat, tpl_load_strided_flat_adj.
+ */
+#ifdef _TPL_DOXYGEN_PARSING
+
+#define tpl_load_contiguous_flat_adj(m, y, n, x, k) ...
+
+#else /* _TPL_DOXYGEN_PARSING not defined */
+
+#define tpl_load_contiguous_flat_adj(m, y, n, x, k)                     \
+    _Generic(*(x),                                                      \
+             float:  tpl_load_contiguous_flat_adj_f,                    \
+             double: tpl_load_contiguous_flat_adj_d)(m, y, n, x, k)
+
+#endif /* _TPL_DOXYGEN_PARSING */
+
+/**
+ * @def tpl_load_strided_flat_adj(m, y, n, x, k, s)
+ *
+ * @brief Apply the adjoint of tpl_load_strided_flat().
+ *
+ * The call `tpl_load_strided_flat_adj(m,y,n,x,k,s)` is similar to
+ * `tpl_load_contiguous_flat_adj(m,y,n,x,k)` except that the elements of the
+ * destination `x` are strided.  It expands to inline code which is
+ * equivalent to:
+ *
+ * ```.c
+ * for (long j = 0; j < n; ++j) {
+ *     x[j*s] = 0;
+ * }
+ * for (long i = 0; i < m; ++i) {
+ *     long j = clamp(i + off, 0, srclen - 1);
+ *     x[j*s] += y[i];
+ * }
+ * ```
+ *
+ * @param m   Number of elements in `y`.
+ * @param y   Address of first element of source array.
+ * @param n   Number of strided elements in destination array.
+ * @param x   Address of first element of destination array.
+ * @param k   Index offset.
+ * @param s   Index increment in the destination array.
+ *
+ * @see tpl_load_strided_flat, tpl_load_contiguous_flat_adj.
+ */
+#ifdef _TPL_DOXYGEN_PARSING
+
+#define tpl_load_strided_flat_adj(m, y, n, x, k, s) ...
+
+#else /* _TPL_DOXYGEN_PARSING not defined */
+
+#define tpl_load_strided_flat_adj(m, y, n, x, k, s)                     \
+    _Generic(*(x),                                                      \
+             float:  tpl_load_strided_flat_adj_f,                       \
+             double: tpl_load_strided_flat_adj_d)(m, y, n, x, k, s)
+
+#endif /* _TPL_DOXYGEN_PARSING */
+
+/**
+ * @def tpl_load_contiguous_flat_calib(m, y, n, x, k, a, b)
+ *
+ * @brief Load contiguous calibrated values assuming flat boundary conditions.
+ *
+ * The call `tpl_load_contiguous_flat_calib(m,y,n,x,k,a,b)` is the same as
+ * `tpl_load_contiguous_flat(m,y,n,x,k)` except that the per-pixel affine
+ * calibration `(x[j] - a[j])*b[j]` is applied to the source values while they
+ * are loaded.  It expands to inline code which is equivalent to:
+ *
+ * ```.c
+ * for (long i = 0; i < m; ++i) {
+ *     long j = clamp(i + off, 0, srclen - 1);
+ *     dst[i] = (src[j] - a[j])*b[j];
+ * }
+ * ```
+ *
+ * where `clamp(a,lo,hi)` yields `min(max(a,lo),hi)`.  For detector frames,
+ * `a` is the dark and `b` is the gain divided by the flat, precomputed once.
+ *
+ * @param m   Number of elements to copy.
+ * @param y   Address of first element of destination array.
+ * @param n   Number of elements in source array.
+ * @param x   Address of first element of source array.
+ * @param k   Index offset.
+ * @param a   Address of first element of calibration offsets.
+ * @param b   Address of first element of calibration factors.
+ *
+ * @see tpl_load_contiguous_flat, tpl_load_strided_flat_calib.
+ */
+#ifdef _TPL_DOXYGEN_PARSING
+
+#define tpl_load_contiguous_flat_calib(m, y, n, x, k, a, b) ...
+
+#else /* _TPL_DOXYGEN_PARSING not defined */
+
+#define tpl_load_contiguous_flat_calib(m, y, n, x, k, a, b)             \
+    _Generic(*(y),                                                      \
+             float:  tpl_load_contiguous_flat_calib_f,                  \
+             double: tpl_load_contiguous_flat_calib_d)(m, y, n, x, k, a, b)
+
+#endif /* _TPL_DOXYGEN_PARSING */
+
+/**
+ * @def tpl_load_strided_flat_calib(m, y, n, x, k, s, a, b)
+ *
+ * @brief Load strided calibrated values assuming flat boundary conditions.
+ *
+ * The call `tpl_load_strided_flat_calib(m,y,n,x,k,s,a,b)` is the same as
+ * `tpl_load_strided_flat(m,y,n,x,k,s)` except that the per-pixel affine
+ * calibration `(x[j*s] - a[j*s])*b[j*s]` is applied to the source values
+ * while they are loaded.  The calibration arrays have the same layout as the
+ * source.
+ *
+ * @param m   Number of elements to copy.
+ * @param y   Address of first element of destination array.
+ * @param n   Number of strided elements in source array.
+ * @param x   Address of first element of source array.
+ * @param k   Index offset.
+ * @param s   Index increment in the source and calibration arrays.
+ * @param a   Address of first element of calibration offsets.
+ * @param b   Address of first element of calibration factors.
+ *
+ * @see tpl_load_strided_flat, tpl_load_contiguous_flat_calib.
+ */
+#ifdef _TPL_DOXYGEN_PARSING
+
+#define tpl_load_strided_flat_calib(m, y, n, x, k, s, a, b) ...
+
+#else /* _TPL_DOXYGEN_PARSING not defined */
+
+#define tpl_load_strided_flat_calib(m, y, n, x, k, s, a, b)             \
+    _Generic(*(y),                                                      \
+             float:  tpl_load_strided_flat_calib_f,                     \
+             double: tpl_load_strided_flat_calib_d)(m, y, n, x, k, s, a, b)
+
+#endif /* _TPL_DOXYGEN_PARSING */
+
 #ifndef _TPL_DOXYGEN_PARSING
 
 #define _TPL_DEFINE_INLINE_FUNCTIONS 1
@@ -396,6 +600,171 @@ _tpl_func(load_strided_flat)(long                     _tpl_m,
     }
 }
 
+static inline void
+_tpl_func(load_strided_flat_prefetch)(long                     _tpl_m,
+                                      _tpl_type*restrict       _tpl_y,
+                                      long                     _tpl_n,
+                                      _tpl_type const*restrict _tpl_x,
+                                      long                     _tpl_k,
+                                      long                     _tpl_s,
+                                      long                     _tpl_d)
+{
+    long _tpl_i1 = pvc_max(-_tpl_k, 0);
+    long _tpl_i2 = pvc_min(_tpl_n - _tpl_k, _tpl_m);
+    long _tpl_ip = pvc_max(_tpl_i2 - pvc_max(_tpl_d, 0), _tpl_i1);
+    if (_tpl_i1 > 0) {
+        _tpl_type _tpl_v = _tpl_x[0];
+        long _tpl_i0 = pvc_min(_tpl_i1, _tpl_m);
+        for (long _tpl_i = 0; _tpl_i < _tpl_i0; ++_tpl_i) {
+            _tpl_y[_tpl_i] = _tpl_v;
+        }
+    }
+    for (long _tpl_i = _tpl_i1; _tpl_i < _tpl_ip; ++_tpl_i) {
+        _TPL_PREFETCH(&_tpl_x[(_tpl_i + _tpl_k + _tpl_d)*_tpl_s]);
+        _tpl_y[_tpl_i] = _tpl_x[(_tpl_i + _tpl_k)*_tpl_s];
+    }
+    for (long _tpl_i = _tpl_ip; _tpl_i < _tpl_i2; ++_tpl_i) {
+        _tpl_y[_tpl_i] = _tpl_x[(_tpl_i + _tpl_k)*_tpl_s];
+    }
+    if (_tpl_i2 < _tpl_m) {
+        _tpl_type _tpl_v = _tpl_x[(_tpl_n - 1)*_tpl_s];
+        long _tpl_i3 = pvc_max(_tpl_i2, 0);
+        for (long _tpl_i = _tpl_i3; _tpl_i < _tpl_m; ++_tpl_i) {
+            _tpl_y[_tpl_i] = _tpl_v;
+        }
+    }
+}
+
+static inline void
+_tpl_func(load_contiguous_flat_adj)(long                     _tpl_m,
+                                    _tpl_type const*restrict _tpl_y,
+                                    long                     _tpl_n,
+                                    _tpl_type*restrict       _tpl_x,
+                                    long                     _tpl_k)
+{
+    long _tpl_i1 = pvc_max(-_tpl_k, 0);
+    long _tpl_i2 = pvc_min(_tpl_n - _tpl_k, _tpl_m);
+    long _tpl_j1 = pvc_min(pvc_max(_tpl_k, 0), _tpl_n);
+    long _tpl_j2 = pvc_max(pvc_min(_tpl_m + _tpl_k, _tpl_n), _tpl_j1);
+    _tpl_type _tpl_s0 = 0, _tpl_s1 = 0;
+    long _tpl_i0 = pvc_min(_tpl_i1, _tpl_m);
+    for (long _tpl_i = 0; _tpl_i < _tpl_i0; ++_tpl_i) {
+        _tpl_s0 += _tpl_y[_tpl_i];
+    }
+    for (long _tpl_i = pvc_max(_tpl_i2, 0); _tpl_i < _tpl_m; ++_tpl_i) {
+        _tpl_s1 += _tpl_y[_tpl_i];
+    }
+    for (long _tpl_j = 0; _tpl_j < _tpl_j1; ++_tpl_j) {
+        _tpl_x[_tpl_j] = 0;
+    }
+    for (long _tpl_i = _tpl_i1; _tpl_i < _tpl_i2; ++_tpl_i) {
+        _tpl_x[_tpl_i + _tpl_k] = _tpl_y[_tpl_i];
+    }
+    for (long _tpl_j = _tpl_j2; _tpl_j < _tpl_n; ++_tpl_j) {
+        _tpl_x[_tpl_j] = 0;
+    }
+    _tpl_x[0] += _tpl_s0;
+    _tpl_x[_tpl_n - 1] += _tpl_s1;
+}
+
+static inline void
+_tpl_func(load_strided_flat_adj)(long                     _tpl_m,
+                                 _tpl_type const*restrict _tpl_y,
+                                 long                     _tpl_n,
+                                 _tpl_type*restrict       _tpl_x,
+                                 long                     _tpl_k,
+                                 long                     _tpl_s)
+{
+    long _tpl_i1 = pvc_max(-_tpl_k, 0);
+    long _tpl_i2 = pvc_min(_tpl_n - _tpl_k, _tpl_m);
+    long _tpl_j1 = pvc_min(pvc_max(_tpl_k, 0), _tpl_n);
+    long _tpl_j2 = pvc_max(pvc_min(_tpl_m + _tpl_k, _tpl_n), _tpl_j1);
+    _tpl_type _tpl_s0 = 0, _tpl_s1 = 0;
+    long _tpl_i0 = pvc_min(_tpl_i1, _tpl_m);
+    for (long _tpl_i = 0; _tpl_i < _tpl_i0; ++_tpl_i) {
+        _tpl_s0 += _tpl_y[_tpl_i];
+    }
+    for (long _tpl_i = pvc_max(_tpl_i2, 0); _tpl_i < _tpl_m; ++_tpl_i) {
+        _tpl_s1 += _tpl_y[_tpl_i];
+    }
+    for (long _tpl_j = 0; _tpl_j < _tpl_j1; ++_tpl_j) {
+        _tpl_x[_tpl_j*_tpl_s] = 0;
+    }
+    for (long _tpl_i = _tpl_i1; _tpl_i < _tpl_i2; ++_tpl_i) {
+        _tpl_x[(_tpl_i + _tpl_k)*_tpl_s] = _tpl_y[_tpl_i];
+    }
+    for (long _tpl_j = _tpl_j2; _tpl_j < _tpl_n; ++_tpl_j) {
+        _tpl_x[_tpl_j*_tpl_s] = 0;
+    }
+    _tpl_x[0] += _tpl_s0;
+    _tpl_x[(_tpl_n - 1)*_tpl_s] += _tpl_s1;
+}
+
+static inline void
+_tpl_func(load_contiguous_flat_calib)(long                     _tpl_m,
+                                      _tpl_type*restrict       _tpl_y,
+                                      long                     _tpl_n,
+                                      _tpl_type const*restrict _tpl_x,
+                                      long                     _tpl_k,
+                                      _tpl_type const*restrict _tpl_a,
+                                      _tpl_type const*restrict _tpl_b)
+{
+    long _tpl_i1 = pvc_max(-_tpl_k, 0);
+    long _tpl_i2 = pvc_min(_tpl_n - _tpl_k, _tpl_m);
+    if (_tpl_i1 > 0) {
+        _tpl_type _tpl_v = (_tpl_x[0] - _tpl_a[0])*_tpl_b[0];
+        long _tpl_i0 = pvc_min(_tpl_i1, _tpl_m);
+        for (long _tpl_i = 0; _tpl_i < _tpl_i0; ++_tpl_i) {
+            _tpl_y[_tpl_i] = _tpl_v;
+        }
+    }
+    for (long _tpl_i = _tpl_i1; _tpl_i < _tpl_i2; ++_tpl_i) {
+        long _tpl_j = _tpl_i + _tpl_k;
+        _tpl_y[_tpl_i] = (_tpl_x[_tpl_j] - _tpl_a[_tpl_j])*_tpl_b[_tpl_j];
+    }
+    if (_tpl_i2 < _tpl_m) {
+        long _tpl_j = _tpl_n - 1;
+        _tpl_type _tpl_v = (_tpl_x[_tpl_j] - _tpl_a[_tpl_j])*_tpl_b[_tpl_j];
+        long _tpl_i3 = pvc_max(_tpl_i2, 0);
+        for (long _tpl_i = _tpl_i3; _tpl_i < _tpl_m; ++_tpl_i) {
+            _tpl_y[_tpl_i] = _tpl_v;
+        }
+    }
+}
+
+static inline void
+_tpl_func(load_strided_flat_calib)(long                     _tpl_m,
+                                   _tpl_type*restrict       _tpl_y,
+                                   long                     _tpl_n,
+                                   _tpl_type const*restrict _tpl_x,
+                                   long                     _tpl_k,
+                                   long                     _tpl_s,
+                                   _tpl_type const*restrict _tpl_a,
+                                   _tpl_type const*restrict _tpl_b)
+{
+    long _tpl_i1 = pvc_max(-_tpl_k, 0);
+    long _tpl_i2 = pvc_min(_tpl_n - _tpl_k, _tpl_m);
+    if (_tpl_i1 > 0) {
+        _tpl_type _tpl_v = (_tpl_x[0] - _tpl_a[0])*_tpl_b[0];
+        long _tpl_i0 = pvc_min(_tpl_i1, _tpl_m);
+        for (long _tpl_i = 0; _tpl_i < _tpl_i0; ++_tpl_i) {
+            _tpl_y[_tpl_i] = _tpl_v;
+        }
+    }
+    for (long _tpl_i = _tpl_i1; _tpl_i < _tpl_i2; ++_tpl_i) {
+        long _tpl_j = (_tpl_i + _tpl_k)*_tpl_s;
+        _tpl_y[_tpl_i] = (_tpl_x[_tpl_j] - _tpl_a[_tpl_j])*_tpl_b[_tpl_j];
+    }
+    if (_tpl_i2 < _tpl_m) {
+        long _tpl_j = (_tpl_n - 1)*_tpl_s;
+        _tpl_type _tpl_v = (_tpl_x[_tpl_j] - _tpl_a[_tpl_j])*_tpl_b[_tpl_j];
+        long _tpl_i3 = pvc_max(_tpl_i2, 0);
+        for (long _tpl_i = _tpl_i3; _tpl_i < _tpl_m; ++_tpl_i) {
+            _tpl_y[_tpl_i] = _tpl_v;
+        }
+    }
+}
+
 #undef _tpl_type
 #undef _tpl_func
 
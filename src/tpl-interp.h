@@ -20,10 +20,25 @@
 _TPL_EXTERN_C_BEGIN
 
 /**
- * Opaque structure for any interpolation function.
+ * Structure for any interpolation function.
+ *
+ * All structures implementing an interpolation function start with the
+ * fields defined by the macro `_TPL_INTERPOLATION_FUNCTION` so that a pointer
+ * to any of them can be cast as a pointer to this structure.
  */
 typedef struct TPL_InterpolationFunction TPL_InterpolationFunction;
 
+/**
+ * @def TPL_INTERP_MAX_SIZE
+ *
+ * @brief Maximum size of the support of an interpolation function.
+ *
+ * The functions interpolating images store the weights of the interpolation
+ * function in arrays of this fixed size and fail for an interpolation
+ * function whose `size` member is larger.
+ */
+#define TPL_INTERP_MAX_SIZE 16
+
 /**
  * @def TPL_INTERP_FUNC(ptr,x)
  *
@@ -55,6 +70,10 @@ typedef struct TPL_InterpolationFunction TPL_InterpolationFunction;
  * This macro stores in `w` the interpolation weights for the interpolation
  * function pointed by `ptr` at offset `t`.  Argument `ptr` is evaluated more
  * than once.  Argument `w` must have at least `ptr->size` elements.
+ *
+ * To interpolate a sequence of values `a` at coordinate `x = j + t` with
+ * `j = floor(x)` and `t = x - j`, the weight `w[k]` applies to `a[j + k - h]`
+ * for `k = 0, ..., ptr->size - 1` and with `h = (ptr->size - 1)/2`.
  */
 #define TPL_INTERP_FUNC_WGTS(ptr, t, w) \
     ((ptr)->func_wgts((TPL_InterpolationFunction const*)ptr, t, w))
@@ -70,9 +89,25 @@ typedef struct TPL_InterpolationFunction TPL_InterpolationFunction;
  * evaluated more than once.  Argument `w` must have at least `ptr->size`
  * elements.
  */
-#define TPL_INTERP_DERIV_WGTS(ptr, x) \
+#define TPL_INTERP_DERIV_WGTS(ptr, t, w) \
     ((ptr)->deriv_wgts((TPL_InterpolationFunction const*)ptr, t, w))
 
+/**
+ * @def TPL_INTERP_FUNC_DERIV_WGTS(ptr, t, w, d)
+ *
+ * @brief Compute interpolation weights of an interpolation function and of
+ * its derivative.
+ *
+ * This macro stores in `w` (resp. `d`) the interpolation weights for the
+ * interpolation function (resp. for its derivative) pointed by `ptr` at offset
+ * `t`.  The result is the same as calling `TPL_INTERP_FUNC_WGTS(ptr,t,w)` and
+ * `TPL_INTERP_DERIV_WGTS(ptr,t,d)` but common sub-expressions are only
+ * computed once.  Argument `ptr` is evaluated more than once.  Arguments `w`
+ * and `d` must have at least `ptr->size` elements.
+ */
+#define TPL_INTERP_FUNC_DERIV_WGTS(ptr, t, w, d) \
+    ((ptr)->func_deriv_wgts((TPL_InterpolationFunction const*)ptr, t, w, d))
+
 /**
  * Opaque structure for a cardinal cubic spline interpolation function.
  */
@@ -89,7 +124,13 @@ typedef struct TPL_CardinalCubicSpline TPL_CardinalCubicSpline;
     double (*func)(TPL_InterpolationFunction const*, double);             \
     void (*func_wgts)(TPL_InterpolationFunction const*, double, double*); \
     double (*deriv)(TPL_InterpolationFunction const*, double);            \
-    void (*deriv_wgts)(TPL_InterpolationFunction const*, double, double*)
+    void (*deriv_wgts)(TPL_InterpolationFunction const*, double, double*); \
+    void (*func_deriv_wgts)(TPL_InterpolationFunction const*, double,     \
+                            double*, double*)
+
+struct TPL_InterpolationFunction {
+    _TPL_INTERPOLATION_FUNCTION;
+};
 
 /**
  * Structure for a cardinal cubic spline interpolation function.
@@ -131,6 +172,110 @@ struct TPL_CardinalCubicSpline {
 extern void
 tpl_initialize_cardinal_cubic_spline(TPL_CardinalCubicSpline* ker, double c);
 
+/**
+ * Opaque structure for a quantized interpolation function.
+ */
+typedef struct TPL_QuantizedInterpolation TPL_QuantizedInterpolation;
+
+/**
+ * Structure for a quantized interpolation function.
+ *
+ * This structure shall be initialized by
+ * tpl_initialize_quantized_interpolation() and its resources released by
+ * tpl_finalize_quantized_interpolation().
+ *
+ * Member `func_table` (resp. `deriv_table`) stores the interpolation weights
+ * of the function (resp. of its derivative) for the `steps + 1` offsets `t =
+ * r/steps` with `r = 0, ..., steps`.  The weights for the `r`-th offset
+ * start at index `r*stride`, `stride ≥ size` being chosen so that the weights
+ * for any offset are suitably aligned for SIMD vectors.
+ */
+struct TPL_QuantizedInterpolation {
+    _TPL_INTERPOLATION_FUNCTION;
+    TPL_InterpolationFunction const* base;
+    long steps;
+    long stride;
+    double* func_table;
+    double* deriv_table;
+};
+
+/**
+ * @def TPL_QUANTIZED_FUNC_WGTS(ptr,t)
+ *
+ * @brief Get the tabulated interpolation weights of a quantized
+ * interpolation function.
+ *
+ * This macro expands as an expression which yields the address of the
+ * tabulated interpolation weights for the quantized interpolation function
+ * pointed by `ptr` at offset `t` rounded to the nearest quantization step.
+ * Argument `t` must be in the range `[0,1]`.  Argument `ptr` is evaluated
+ * more than once.  This is the same as `TPL_INTERP_FUNC_WGTS(ptr,t,w)` but
+ * without copying the weights.
+ */
+#define TPL_QUANTIZED_FUNC_WGTS(ptr, t) \
+    ((ptr)->func_table + (ptr)->stride*(long)((t)*(ptr)->steps + 0.5))
+
+/**
+ * @def TPL_QUANTIZED_DERIV_WGTS(ptr,t)
+ *
+ * @brief Get the tabulated interpolation weights of the derivative of a
+ * quantized interpolation function.
+ *
+ * This macro is similar to TPL_QUANTIZED_FUNC_WGTS() but for the derivative
+ * of the interpolation function.
+ */
+#define TPL_QUANTIZED_DERIV_WGTS(ptr, t) \
+    ((ptr)->deriv_table + (ptr)->stride*(long)((t)*(ptr)->steps + 0.5))
+
+/**
+ * Initialize a quantized interpolation function.
+ *
+ * A quantized interpolation function behaves as the interpolation function
+ * `base` except that the offsets for which the interpolation weights are
+ * computed are rounded to the nearest multiple of `1/steps`.  The weights
+ * (for the function and for its derivative) are tabulated at initialization
+ * so that computing the interpolation weights amounts to a single table
+ * lookup.  The values of the function and of its derivative are not
+ * quantized.  For instance:
+ *
+ * ```.c
+ * TPL_CardinalCubicSpline phi;
+ * TPL_QuantizedInterpolation q;
+ * tpl_initialize_cardinal_cubic_spline(&phi, 0.0);
+ * if (tpl_initialize_quantized_interpolation(
+ *         &q, (TPL_InterpolationFunction const*)&phi, 256) != 0) {
+ *     ... // handle error
+ * }
+ * TPL_INTERP_FUNC_WGTS(&q, t, w); // same as for phi but t = round(256t)/256
+ * ...
+ * tpl_finalize_quantized_interpolation(&q);
+ * ```
+ *
+ * The base interpolation function must remain valid while `obj` is in use.
+ *
+ * @param obj    The quantized interpolation function to initialize.
+ * @param base   The interpolation function to quantize.
+ * @param steps  The number of quantization steps per unit of offset (e.g.,
+ *               256 or 1024).
+ *
+ * @return `0` on success, `-1` on failure (invalid argument or insufficient
+ *         memory).  In case of failure, the structure is left in a state
+ *         such that tpl_finalize_quantized_interpolation() can be safely
+ *         called.
+ */
+extern int
+tpl_initialize_quantized_interpolation(TPL_QuantizedInterpolation* obj,
+                                       TPL_InterpolationFunction const* base,
+                                       long steps);
+
+/**
+ * Release resources of a quantized interpolation function.
+ *
+ * @param obj    The quantized interpolation function.
+ */
+extern void
+tpl_finalize_quantized_interpolation(TPL_QuantizedInterpolation* obj);
+
 _TPL_EXTERN_C_END
 
 #endif /* _TPL_INTERP_H */
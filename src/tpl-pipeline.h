@@ -0,0 +1,167 @@
+/*
+ * tpl-pipeline.h -
+ *
+ * Definitions for the streaming of frames in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#ifndef _TPL_PIPELINE_H
+#define _TPL_PIPELINE_H 1
+
+#include <stddef.h>
+#include <tpl-base.h>
+
+_TPL_EXTERN_C_BEGIN
+
+/**
+ * Opaque structure for a ring of frames.
+ *
+ * A ring is a lock-free single-producer single-consumer queue of
+ * preallocated slots of fixed size.  The producer fills the slot given by
+ * tpl_ring_acquire() and makes it available to the consumer by
+ * tpl_ring_publish(), the consumer processes the slot given by
+ * tpl_ring_peek() and gives it back to the producer by tpl_ring_release().
+ * Slots are processed in order and frames are never copied nor allocated
+ * while streaming.  Producer and consumer may be different threads but
+ * there must be at most one of each.
+ */
+typedef struct TPL_Ring TPL_Ring;
+
+/**
+ * Create a ring of frames.
+ *
+ * @param nslots     Number of slots.
+ * @param slot_size  Size of a slot in bytes.  Slots are aligned on cache
+ *                   lines.
+ *
+ * @return A new ring, `NULL` on error with `errno` set.
+ */
+extern TPL_Ring* tpl_create_ring(long nslots, size_t slot_size);
+
+/**
+ * Destroy a ring of frames.
+ *
+ * @param ring   Ring of frames (can be `NULL`).
+ */
+extern void tpl_destroy_ring(TPL_Ring* ring);
+
+/**
+ * Get a free slot of a ring of frames.
+ *
+ * This function is for the producer, it does not block.  The same slot is
+ * returned until tpl_ring_publish() is called.
+ *
+ * @param ring   Ring of frames.
+ *
+ * @return The address of the next slot to fill, `NULL` if the ring is full.
+ */
+extern void* tpl_ring_acquire(TPL_Ring* ring);
+
+/**
+ * Publish the slot filled by the producer.
+ *
+ * @param ring   Ring of frames.
+ */
+extern void tpl_ring_publish(TPL_Ring* ring);
+
+/**
+ * Get the oldest published slot of a ring of frames.
+ *
+ * This function is for the consumer, it does not block.  The same slot is
+ * returned until tpl_ring_release() is called.
+ *
+ * @param ring   Ring of frames.
+ *
+ * @return The address of the next slot to process, `NULL` if the ring is
+ *         empty.
+ */
+extern void* tpl_ring_peek(TPL_Ring* ring);
+
+/**
+ * Give back the slot processed by the consumer to the producer.
+ *
+ * @param ring   Ring of frames.
+ */
+extern void tpl_ring_release(TPL_Ring* ring);
+
+/**
+ * Prototype of a stage of a pipeline.
+ *
+ * A stage computes the frame `dst` of the next ring from the frame `src` of
+ * the previous ring.  Each stage is run by its own thread, its argument
+ * (e.g. filter coefficients and workspaces) is therefore not shared.
+ *
+ * @param arg    Argument of the stage.
+ * @param dst    Output frame.
+ * @param src    Input frame.
+ */
+typedef void TPL_Stage(void* arg, void* dst, void const* src);
+
+/**
+ * Opaque structure for a pipeline of stages.
+ *
+ * A pipeline runs a chain of stages (e.g. calibration, filtering,
+ * resampling and reductions) on a stream of frames: each stage runs in its
+ * own thread and consecutive stages are connected by rings, so that
+ * different stages process consecutive frames simultaneously and the
+ * throughput is that of the slowest stage.
+ */
+typedef struct TPL_Pipeline TPL_Pipeline;
+
+/**
+ * Create a pipeline of stages.
+ *
+ * The stage `s` (for `s = 0, ..., nstages - 1`) reads its frames from the
+ * ring `s` and writes its results in the ring `s + 1`.  The rings `0` and
+ * `nstages` are `input` and `output`, the intermediate rings are created
+ * with `depth` slots, the slots of the ring `s` being of `sizes[s-1]` bytes.
+ * The caller is the producer of `input` and the consumer of `output`.  The
+ * threads wait for frames by spinning for `spin_ns` nanoseconds and then by
+ * sleeping for short periods.
+ *
+ * @param nstages  Number of stages.
+ * @param stages   Functions of the stages.
+ * @param args     Arguments of the stages.
+ * @param sizes    Sizes (in bytes) of the intermediate frames (`nstages - 1`
+ *                 values, can be `NULL` if `nstages = 1`).
+ * @param depth    Number of slots of the intermediate rings.
+ * @param input    Ring of input frames.
+ * @param output   Ring of output frames.
+ * @param cpus     Optional CPUs to pin the threads on (thread of stage `s`
+ *                 is pinned on CPU `cpus[s]`), unused if `NULL`.
+ * @param spin_ns  Time (in nanoseconds) during which a thread busy-waits
+ *                 for a frame or a free slot, must be non-negative.
+ *
+ * @return A new pipeline, `NULL` on error with `errno` set.
+ */
+extern TPL_Pipeline* tpl_create_pipeline(long nstages,
+                                         TPL_Stage* const stages[],
+                                         void* const args[],
+                                         size_t const sizes[],
+                                         long depth,
+                                         TPL_Ring* input,
+                                         TPL_Ring* output,
+                                         int const* cpus,
+                                         long spin_ns);
+
+/**
+ * Destroy a pipeline of stages.
+ *
+ * The threads are stopped after their current frame and joined.  Frames
+ * still in the intermediate rings are lost, the caller should consume all
+ * expected output frames before destroying the pipeline.  The rings
+ * `input` and `output` are not destroyed.
+ *
+ * @param pipe   Pipeline of stages (can be `NULL`).
+ */
+extern void tpl_destroy_pipeline(TPL_Pipeline* pipe);
+
+_TPL_EXTERN_C_END
+
+#endif /* _TPL_PIPELINE_H */
@@ -0,0 +1,147 @@
+/*
+ * tpl-pool.h -
+ *
+ * Definitions for the pool of threads of TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#ifndef _TPL_POOL_H
+#define _TPL_POOL_H 1
+
+#include <tpl-base.h>
+
+_TPL_EXTERN_C_BEGIN
+
+/**
+ * Opaque structure for a pool of threads.
+ *
+ * A pool of threads is designed for low-latency fork/join parallelism in
+ * real-time loops: the workers are created once, optionally pinned to given
+ * CPUs, and they busy-wait for new tasks during a configurable time after
+ * each task before sleeping (on a futex under Linux).  The calling thread
+ * takes part in the work as rank `0`, the workers have ranks `1` to
+ * `nworkers`.  Work is split statically (see tpl_pool_split()) so that the
+ * same thread always processes the same part of the data for the same
+ * problem size, which is deterministic and cache friendly.
+ *
+ * A pool must only be used by one thread at a time.
+ */
+typedef struct TPL_Pool TPL_Pool;
+
+/**
+ * Prototype of a task run by a pool of threads.
+ *
+ * @param arg     Task argument.
+ * @param rank    Rank of the calling thread (`0 ≤ rank < nranks`).
+ * @param nranks  Number of threads running the task.
+ */
+typedef void TPL_Task(void* arg, long rank, long nranks);
+
+/**
+ * Prototype of a job of a batch run by a pool of threads.
+ *
+ * @param arg     Argument of the batch.
+ * @param job     Index of the job (`0 ≤ job < njobs`).
+ * @param rank    Rank of the thread running the job (`0 ≤ rank < nranks`),
+ *                e.g. to select a per-thread workspace.
+ */
+typedef void TPL_Job(void* arg, long job, long rank);
+
+/**
+ * Create a pool of threads.
+ *
+ * @param nworkers  Number of worker threads (may be `0` to run everything in
+ *                  the calling thread).
+ * @param cpus      Optional CPUs to pin the workers on (worker of rank `r`
+ *                  is pinned on CPU `cpus[r-1]`), unused if `NULL`.  The
+ *                  calling thread is not pinned by the library.
+ * @param spin_ns   Time (in nanoseconds) during which a thread busy-waits
+ *                  before going to sleep, must be non-negative.
+ *
+ * @return A pool of threads, `NULL` on error with `errno` set (e.g. if a
+ *         thread cannot be created or pinned).
+ */
+extern TPL_Pool* tpl_create_pool(long nworkers, int const* cpus, long spin_ns);
+
+/**
+ * Destroy a pool of threads.
+ *
+ * The workers are stopped and joined and the resources are released.
+ *
+ * @param pool   Pool of threads (can be `NULL`).
+ */
+extern void tpl_destroy_pool(TPL_Pool* pool);
+
+/**
+ * Get the size of a pool of threads.
+ *
+ * @param pool   Pool of threads (can be `NULL`).
+ *
+ * @return The number of ranks of the pool, that is the number of workers
+ *         plus one for the calling thread (`1` if `pool` is `NULL`).
+ */
+extern long tpl_pool_size(TPL_Pool const* pool);
+
+/**
+ * Run a task in parallel.
+ *
+ * This function calls `task(arg,rank,nranks)` for all ranks of the pool, the
+ * calling thread running rank `0`, and returns when all calls are done.  If
+ * `pool` is `NULL`, the task is run in the calling thread with `nranks = 1`.
+ *
+ * @param pool   Pool of threads (can be `NULL`).
+ * @param task   Task to run.
+ * @param arg    Argument of the task.
+ */
+extern void tpl_pool_run(TPL_Pool* pool, TPL_Task* task, void* arg);
+
+/**
+ * Run a batch of independent jobs with load balancing.
+ *
+ * This function calls `job(arg,j,rank)` exactly once for each `j` in
+ * `0:njobs-1` and returns when all jobs are done.  The jobs are initially
+ * split in contiguous parts as by tpl_pool_split(), each thread runs the
+ * jobs of its own part in increasing order and, when done, steals the last
+ * remaining jobs of the other threads.  This balances the load of batches
+ * of jobs of uneven costs (e.g. images of different sizes) while keeping
+ * the static assignment when the costs are even.  If `pool` is `NULL`, the
+ * jobs are run in order in the calling thread.
+ *
+ * @param pool   Pool of threads (can be `NULL`).
+ * @param njobs  Number of jobs, must be less than `2^31`.
+ * @param job    Job to run.
+ * @param arg    Argument of the jobs.
+ */
+extern void tpl_pool_run_jobs(TPL_Pool* pool, long njobs, TPL_Job* job,
+                              void* arg);
+
+/**
+ * Static partition of a range.
+ *
+ * Yields the part `first:last-1` of the range `0:n-1` processed by thread
+ * of rank `rank` among `nranks`.  Parts are contiguous, ordered by rank and
+ * their lengths differ by at most one.
+ *
+ * @param n       Length of range.
+ * @param rank    Rank of the thread.
+ * @param nranks  Number of threads.
+ * @param first   Address to store the first index of the part.
+ * @param last    Address to store the last index (exclusive) of the part.
+ */
+static inline void
+tpl_pool_split(long n, long rank, long nranks, long* first, long* last)
+{
+    long q = n/nranks, r = n%nranks;
+    *first = rank*q + (rank < r ? rank : r);
+    *last = *first + q + (rank < r ? 1 : 0);
+}
+
+_TPL_EXTERN_C_END
+
+#endif /* _TPL_POOL_H */
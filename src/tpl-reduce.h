@@ -0,0 +1,84 @@
+/*
+ * tpl-reduce.h -
+ *
+ * Definitions for reductions (sums, extrema and moments) in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#ifndef _TPL_REDUCE_H
+#define _TPL_REDUCE_H 1
+
+#include <tpl-base.h>
+
+_TPL_EXTERN_C_BEGIN
+
+/**
+ * Sums, extrema and moments of the values of an image.
+ *
+ * Indices `i1` and `i2` are the 0-based pixel indices along the 1st and 2nd
+ * dimensions.  For instance, the centroid is `(sum_1/sum, sum_2/sum)`.
+ * Structures are accumulated by tpl_update_moments() and by the filters
+ * with reductions, they must be initialized by tpl_initialize_moments().
+ */
+typedef struct {
+    long   count;  /**< Number of values. */
+    double sum;    /**< Sum of values. */
+    double min;    /**< Minimum value. */
+    double max;    /**< Maximum value. */
+    double sum_1;  /**< Sum of `v*i1`. */
+    double sum_2;  /**< Sum of `v*i2`. */
+    double sum_11; /**< Sum of `v*i1*i1`. */
+    double sum_12; /**< Sum of `v*i1*i2`. */
+    double sum_22; /**< Sum of `v*i2*i2`. */
+} TPL_Moments;
+
+/**
+ * Initialize moments.
+ *
+ * @param mom   Address of structure to initialize (all sums and count set to
+ *              zero, `min = +Inf` and `max = -Inf`).
+ */
+extern void tpl_initialize_moments(TPL_Moments* mom);
+
+/**
+ * @def tpl_update_moments(mom, n, v, dim, i1, i2)
+ *
+ * @brief Accumulate moments of a line of pixels.
+ *
+ * The `n` values `v[k]` are those of pixels at indices `(i1 + k, i2)` if
+ * `dim = 1` and `(i1, i2 + k)` if `dim = 2`.
+ *
+ * @param mom   Address of moments to update.
+ * @param n     Number of values.
+ * @param v     Values.
+ * @param dim   Dimension of the line (1 or 2).
+ * @param i1    Index along 1st dimension of first value.
+ * @param i2    Index along 2nd dimension of first value.
+ */
+#define tpl_update_moments(mom, n, v, dim, i1, i2)                      \
+    _Generic(*(v),                                                      \
+             float:  tpl_update_moments_f,                              \
+             double: tpl_update_moments_d)(mom, n, v, dim, i1, i2)
+
+extern void tpl_update_moments_f(TPL_Moments* mom,
+                                 long n,
+                                 float const* v,
+                                 int dim,
+                                 long i1,
+                                 long i2);
+extern void tpl_update_moments_d(TPL_Moments* mom,
+                                 long n,
+                                 double const* v,
+                                 int dim,
+                                 long i1,
+                                 long i2);
+
+_TPL_EXTERN_C_END
+
+#endif /* _TPL_REDUCE_H */
@@ -0,0 +1,148 @@
+/*
+ * tpl-shm.h -
+ *
+ * Definitions for frames in shared memory in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#ifndef _TPL_SHM_H
+#define _TPL_SHM_H 1
+
+#include <tpl-base.h>
+
+_TPL_EXTERN_C_BEGIN
+
+/**
+ * View of a 2-dimensional image stored elsewhere.
+ *
+ * Element `(i1,i2)` is at index `i1 + pitch*i2` of `data`.  TPL functions
+ * taking images assume `pitch = len1` which is the case of the frames
+ * written by tpl_create_shm_writer(), these frames can thus be directly
+ * given to the filters and the warps without being copied.
+ */
+typedef struct {
+    void* data;              /**< Address of first element. */
+    long len1;               /**< Length of 1st dimension. */
+    long len2;               /**< Length of 2nd dimension. */
+    long pitch;              /**< Number of elements between consecutive
+                                  rows (along the 2nd dimension). */
+    TPL_ElementType type;    /**< Type of elements. */
+    unsigned long serial;    /**< Frame number (starting at 0). */
+    unsigned long version;   /**< Version of the buffer, see
+                                  tpl_shm_source_check(). */
+} TPL_ImageView;
+
+/**
+ * Opaque structure for a writer of frames in shared memory.
+ *
+ * A writer creates a POSIX shared memory segment with a cyclic list of
+ * `nbufs` frame buffers.  It is a stand-in for a camera server publishing
+ * frames for other processes (or threads).
+ */
+typedef struct TPL_ShmWriter TPL_ShmWriter;
+
+/**
+ * Opaque structure for a source of frames in shared memory.
+ */
+typedef struct TPL_ShmSource TPL_ShmSource;
+
+/**
+ * Create a writer of frames in shared memory.
+ *
+ * @param name   Name of the shared memory segment (of the form
+ *               `"/somename"`), it must not exist.
+ * @param type   Type of elements.
+ * @param len1   Length of 1st dimension of frames.
+ * @param len2   Length of 2nd dimension of frames.
+ * @param nbufs  Number of frame buffers.
+ *
+ * @return A new writer, `NULL` on error with `errno` set.
+ */
+extern TPL_ShmWriter* tpl_create_shm_writer(char const* name,
+                                            TPL_ElementType type,
+                                            long len1,
+                                            long len2,
+                                            long nbufs);
+
+/**
+ * Destroy a writer of frames in shared memory.
+ *
+ * The shared memory segment is unlinked, it remains accessible to the
+ * attached sources until they are detached.
+ *
+ * @param wrt    Writer (can be `NULL`).
+ */
+extern void tpl_destroy_shm_writer(TPL_ShmWriter* wrt);
+
+/**
+ * Start writing the next frame in shared memory.
+ *
+ * The next buffer in cyclic order is marked as being overwritten and its
+ * view is stored in `view`.  The caller shall write the frame and then call
+ * tpl_shm_writer_publish().
+ *
+ * @param wrt    Writer.
+ * @param view   Address to store the view of the buffer.
+ */
+extern void tpl_shm_writer_start(TPL_ShmWriter* wrt, TPL_ImageView* view);
+
+/**
+ * Publish the frame written in shared memory.
+ *
+ * @param wrt    Writer.
+ */
+extern void tpl_shm_writer_publish(TPL_ShmWriter* wrt);
+
+/**
+ * Attach a source of frames in shared memory.
+ *
+ * @param name   Name of the shared memory segment.
+ *
+ * @return A new source, `NULL` on error with `errno` set.
+ */
+extern TPL_ShmSource* tpl_attach_shm_source(char const* name);
+
+/**
+ * Detach a source of frames in shared memory.
+ *
+ * @param src    Source (can be `NULL`).
+ */
+extern void tpl_detach_shm_source(TPL_ShmSource* src);
+
+/**
+ * Get the last published frame of a source.
+ *
+ * The frame is not copied, `view->data` points to the buffer in shared
+ * memory which is mapped read-only.  As the writer does not wait for the
+ * readers, the buffer may be overwritten while it is being processed, which
+ * can be detected by tpl_shm_source_check() after processing.
+ *
+ * @param src    Source.
+ * @param view   Address to store the view of the frame.
+ *
+ * @return `0` on success, `-1` if no frames have been published yet.
+ */
+extern int tpl_shm_source_last(TPL_ShmSource* src, TPL_ImageView* view);
+
+/**
+ * Check whether a frame is still valid.
+ *
+ * @param src    Source.
+ * @param view   View of a frame given by tpl_shm_source_last().
+ *
+ * @return `1` if the contents of the frame has not been overwritten since
+ *         the view was taken (so the results computed from the frame are
+ *         correct), `0` otherwise.
+ */
+extern int tpl_shm_source_check(TPL_ShmSource const* src,
+                                TPL_ImageView const* view);
+
+_TPL_EXTERN_C_END
+
+#endif /* _TPL_SHM_H */
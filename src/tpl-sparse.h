@@ -0,0 +1,264 @@
+/*
+ * tpl-sparse.h -
+ *
+ * Definitions for sparse interpolation matrices in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_SPARSE_H
+#define _TPL_SPARSE_H 1
+
+#include <tpl-base.h>
+#include <tpl-interp.h>
+#include <tpl-pool.h>
+
+_TPL_EXTERN_C_BEGIN
+
+/**
+ * Opaque structure for a sparse interpolation matrix.
+ */
+typedef struct TPL_InterpolationMatrix TPL_InterpolationMatrix;
+
+/**
+ * Structure for a sparse interpolation matrix.
+ *
+ * A sparse interpolation matrix stores, once for all, the indices and the
+ * weights of the interpolation of an image at a fixed set of positions.
+ * Each row of the matrix has the same number `nnz` of entries (the
+ * `ker->size^2` neighbors of the position).  Entries are stored in ELLPACK
+ * format by *slots*: the `k`-th entry of the `r`-th row has column index
+ * `idx[k*ldr + r]` and weight `wgt[k*ldr + r]`, where the leading dimension
+ * `ldr ≥ nrows` is a multiple of the number of elements of a SIMD vector
+ * (padding entries have a zero weight).  This layout lets the product by the
+ * matrix be vectorized across consecutive rows without any horizontal
+ * reduction.
+ *
+ * The transpose of the matrix is stored in compressed sparse row format:
+ * entries of the `c`-th row of the transpose are in the range
+ * `tptr[c] ≤ e < tptr[c+1]` and have column index `tidx[e]` and weight
+ * `twgt[e]`.  The product by the transpose is thus a gather for each
+ * destination element.
+ *
+ * Arrays `wgt` and `twgt` have elements of type given by `type`.
+ *
+ * This structure shall be initialized by
+ * tpl_initialize_interpolation_matrix_f() or
+ * tpl_initialize_interpolation_matrix_d() and its resources released by
+ * tpl_finalize_interpolation_matrix().
+ */
+struct TPL_InterpolationMatrix {
+    long nrows;
+    long ncols;
+    long nnz;
+    long ldr;
+    TPL_ElementType type;
+    int* idx;
+    void* wgt;
+    long* tptr;
+    int* tidx;
+    void* twgt;
+};
+
+/**
+ * Initialize a sparse interpolation matrix.
+ *
+ * The matrix implements the interpolation of an image of `len1*len2`
+ * elements at the `n` positions `(x1[i],x2[i])` with the interpolation
+ * function `ker` and assuming *flat* boundary conditions.  That is to say,
+ * the product by the matrix yields the same result as the value computed by
+ * tpl_interp_grad_2d() (up to rounding errors) but without recomputing the
+ * interpolation weights and indices.
+ *
+ * Column-major storage order is assumed for multi-dimensional arrays.  The
+ * number of pixels `len1*len2` and the number of positions `n` must be
+ * representable by an `int` and the size of the interpolation function must
+ * not exceed ::TPL_INTERP_MAX_SIZE.
+ *
+ * @param A      The matrix to initialize.
+ * @param n      Number of positions (rows of the matrix).
+ * @param x1     Coordinates of the positions along 1st dimension.
+ * @param x2     Coordinates of the positions along 2nd dimension.
+ * @param len1   Length of 1st dimension of interpolated images.
+ * @param len2   Length of 2nd dimension of interpolated images.
+ * @param ker    Interpolation function.
+ *
+ * @return `0` on success, `-1` on failure (invalid argument or insufficient
+ *         memory).  In case of failure, the structure is left in a state
+ *         such that tpl_finalize_interpolation_matrix() can be safely called.
+ */
+extern int
+tpl_initialize_interpolation_matrix_f(TPL_InterpolationMatrix* A,
+                                      long n,
+                                      double const* x1,
+                                      double const* x2,
+                                      long len1,
+                                      long len2,
+                                      TPL_InterpolationFunction const* ker);
+
+extern int
+tpl_initialize_interpolation_matrix_d(TPL_InterpolationMatrix* A,
+                                      long n,
+                                      double const* x1,
+                                      double const* x2,
+                                      long len1,
+                                      long len2,
+                                      TPL_InterpolationFunction const* ker);
+
+/**
+ * Release resources of a sparse interpolation matrix.
+ *
+ * @param A      The sparse interpolation matrix.
+ */
+extern void
+tpl_finalize_interpolation_matrix(TPL_InterpolationMatrix* A);
+
+/**
+ * @def tpl_apply_interpolation_matrix(A, dst, src)
+ *
+ * @brief Multiply a vector by a sparse interpolation matrix.
+ *
+ * The call `tpl_apply_interpolation_matrix(A,dst,src)` overwrites the
+ * `A->nrows` elements of `dst` with the product of the matrix `A` by the
+ * `A->ncols` elements of `src`.  The matrix must have been initialized for
+ * the same element type as `dst` and `src`.  The destination elements are
+ * computed independently by blocks of consecutive rows.
+ *
+ * @param A      The sparse interpolation matrix.
+ * @param dst    Destination array of `A->nrows` elements.
+ * @param src    Source array of `A->ncols` elements.
+ *
+ * @return `0` on success, `-1` if the matrix has not been initialized for
+ *         the element type of `dst` and `src`.
+ */
+#define tpl_apply_interpolation_matrix(A, dst, src)             \
+    _Generic(*(dst),                                            \
+             float:  tpl_apply_interpolation_matrix_f,          \
+             double: tpl_apply_interpolation_matrix_d)(A, dst, src)
+
+extern int
+tpl_apply_interpolation_matrix_f(TPL_InterpolationMatrix const* A,
+                                 float*restrict dst,
+                                 float const*restrict src);
+
+extern int
+tpl_apply_interpolation_matrix_d(TPL_InterpolationMatrix const* A,
+                                 double*restrict dst,
+                                 double const*restrict src);
+
+/**
+ * @def tpl_apply_interpolation_matrix_adj(A, dst, src)
+ *
+ * @brief Multiply a vector by the transpose of a sparse interpolation
+ * matrix.
+ *
+ * The call `tpl_apply_interpolation_matrix_adj(A,dst,src)` overwrites the
+ * `A->ncols` elements of `dst` with the product of the transpose of the
+ * matrix `A` by the `A->nrows` elements of `src`.  Each destination element is
+ * computed independently as a gather of the source elements.
+ *
+ * @param A      The sparse interpolation matrix.
+ * @param dst    Destination array of `A->ncols` elements.
+ * @param src    Source array of `A->nrows` elements.
+ *
+ * @return `0` on success, `-1` if the matrix has not been initialized for
+ *         the element type of `dst` and `src`.
+ */
+#define tpl_apply_interpolation_matrix_adj(A, dst, src)         \
+    _Generic(*(dst),                                            \
+             float:  tpl_apply_interpolation_matrix_adj_f,      \
+             double: tpl_apply_interpolation_matrix_adj_d)(A, dst, src)
+
+extern int
+tpl_apply_interpolation_matrix_adj_f(TPL_InterpolationMatrix const* A,
+                                     float*restrict dst,
+                                     float const*restrict src);
+
+extern int
+tpl_apply_interpolation_matrix_adj_d(TPL_InterpolationMatrix const* A,
+                                     double*restrict dst,
+                                     double const*restrict src);
+
+/**
+ * @def tpl_apply_interpolation_matrix_parallel(pool, A, dst, src)
+ *
+ * @brief Multiply a vector by a sparse interpolation matrix with a pool of
+ * threads.
+ *
+ * This is the same as tpl_apply_interpolation_matrix() except that the rows
+ * are split in blocks of whole SIMD vectors computed by the threads of
+ * `pool`.  The result is identical to that of the serial version.
+ *
+ * @param pool   Pool of threads (`NULL` to run in the calling thread).
+ * @param A      The sparse interpolation matrix.
+ * @param dst    Destination array of `A->nrows` elements.
+ * @param src    Source array of `A->ncols` elements.
+ *
+ * @return `0` on success, `-1` if the matrix has not been initialized for
+ *         the element type of `dst` and `src`.
+ */
+#define tpl_apply_interpolation_matrix_parallel(pool, A, dst, src)      \
+    _Generic(*(dst),                                                    \
+             float:  tpl_apply_interpolation_matrix_parallel_f,         \
+             double: tpl_apply_interpolation_matrix_parallel_d)(        \
+                 pool, A, dst, src)
+
+extern int
+tpl_apply_interpolation_matrix_parallel_f(TPL_Pool* pool,
+                                          TPL_InterpolationMatrix const* A,
+                                          float*restrict dst,
+                                          float const*restrict src);
+
+extern int
+tpl_apply_interpolation_matrix_parallel_d(TPL_Pool* pool,
+                                          TPL_InterpolationMatrix const* A,
+                                          double*restrict dst,
+                                          double const*restrict src);
+
+/**
+ * @def tpl_apply_interpolation_matrix_adj_parallel(pool, A, dst, src)
+ *
+ * @brief Multiply a vector by the transpose of a sparse interpolation matrix
+ * with a pool of threads.
+ *
+ * This is the same as tpl_apply_interpolation_matrix_adj() except that the
+ * columns are split between the threads of `pool` in blocks of consecutive
+ * columns having about the same number of entries.  As each destination
+ * element is gathered by a single thread, the result is identical to that of
+ * the serial version.
+ *
+ * @param pool   Pool of threads (`NULL` to run in the calling thread).
+ * @param A      The sparse interpolation matrix.
+ * @param dst    Destination array of `A->ncols` elements.
+ * @param src    Source array of `A->nrows` elements.
+ *
+ * @return `0` on success, `-1` if the matrix has not been initialized for
+ *         the element type of `dst` and `src`.
+ */
+#define tpl_apply_interpolation_matrix_adj_parallel(pool, A, dst, src)  \
+    _Generic(*(dst),                                                    \
+             float:  tpl_apply_interpolation_matrix_adj_parallel_f,     \
+             double: tpl_apply_interpolation_matrix_adj_parallel_d)(    \
+                 pool, A, dst, src)
+
+extern int
+tpl_apply_interpolation_matrix_adj_parallel_f(
+    TPL_Pool* pool,
+    TPL_InterpolationMatrix const* A,
+    float*restrict dst,
+    float const*restrict src);
+
+extern int
+tpl_apply_interpolation_matrix_adj_parallel_d(
+    TPL_Pool* pool,
+    TPL_InterpolationMatrix const* A,
+    double*restrict dst,
+    double const*restrict src);
+
+_TPL_EXTERN_C_END
+
+#endif /* _TPL_SPARSE_H */
@@ -0,0 +1,175 @@
+/*
+ * tpl-stats.h -
+ *
+ * Definitions for the optional instrumentation of TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#ifndef _TPL_STATS_H
+#define _TPL_STATS_H 1
+
+#include <tpl-base.h>
+
+/**
+ * @def TPL_STATS
+ *
+ * @brief Compile-time switch for the instrumentation of TPL entry points.
+ *
+ * If the library is compiled with `-DTPL_STATS=1`, the number of calls, the
+ * number of elements and the elapsed time (in nanoseconds and in CPU cycles
+ * where a cycle counter is available) of instrumented functions are
+ * accumulated in per-thread counters along with a histogram of the
+ * durations of the calls.  Otherwise (the default), the instrumentation
+ * macros expand to nothing and the `tpl_stats` functions report no
+ * statistics.  Times are inclusive: an instrumented function calling
+ * another one (e.g., tpl_filter_2d() calling tpl_filter() for each line)
+ * accounts for the time spent in both.
+ */
+#ifndef TPL_STATS
+#  define TPL_STATS 0
+#endif
+
+_TPL_EXTERN_C_BEGIN
+
+/**
+ * Identifiers of instrumented entry points.  The single and double precision
+ * versions of a function share the same identifier.
+ */
+typedef enum {
+    TPL_STATS_FILTER = 0,
+    TPL_STATS_FILTER_DILATED,
+    TPL_STATS_FILTER_REDUCE,
+    TPL_STATS_FILTER_VAR,
+    TPL_STATS_FILTER_BANK,
+    TPL_STATS_FILTER_2D,
+    TPL_STATS_FILTER_2D_PARALLEL,
+    TPL_STATS_FILTER_2D_BATCH,
+    TPL_STATS_FILTER_2D_REF,
+    TPL_STATS_FILTER_2D_CALIB,
+    TPL_STATS_FILTER_2D_REDUCE,
+    TPL_STATS_FILTER_2D_VAR,
+    TPL_STATS_FILTER_2D_DILATED,
+    TPL_STATS_FILTER_BANK_2D,
+    TPL_STATS_RESAMPLE_1D,
+    TPL_STATS_RESAMPLE_1D_ADJ,
+    TPL_STATS_RESAMPLE_1D_PARALLEL,
+    TPL_STATS_RESAMPLE_1D_ADJ_PARALLEL,
+    TPL_STATS_SHEAR_2D,
+    TPL_STATS_SHEAR_2D_ADJ,
+    TPL_STATS_SHEAR_2D_PARALLEL,
+    TPL_STATS_SHEAR_2D_ADJ_PARALLEL,
+    TPL_STATS_ROTATE_2D,
+    TPL_STATS_ROTATE_2D_ADJ,
+    TPL_STATS_ROTATE_2D_PARALLEL,
+    TPL_STATS_ROTATE_2D_ADJ_PARALLEL,
+    TPL_STATS_ROTATE_2D_BATCH,
+    TPL_STATS_INTERP_GRAD_2D,
+    TPL_STATS_APPLY_INTERPOLATION_MATRIX,
+    TPL_STATS_APPLY_INTERPOLATION_MATRIX_ADJ,
+    TPL_STATS_APPLY_INTERPOLATION_MATRIX_PARALLEL,
+    TPL_STATS_APPLY_INTERPOLATION_MATRIX_ADJ_PARALLEL,
+    TPL_STATS_ENTRIES /**< Number of instrumented entry points. */
+} TPL_StatsEntry;
+
+/**
+ * @def TPL_STATS_BUCKETS
+ *
+ * @brief Number of buckets of the histograms of durations.
+ *
+ * Bucket `k > 0` counts the calls which lasted `t` nanoseconds with `2^k ≤ t
+ * < 2^(k+1)`, bucket `0` counts the calls shorter than 2 ns and the last
+ * bucket the calls longer than about 2 seconds.
+ */
+#define TPL_STATS_BUCKETS 32
+
+/**
+ * Statistics of an entry point.
+ */
+typedef struct {
+    unsigned long long calls;     /**< Number of calls. */
+    unsigned long long elements;  /**< Number of elements processed. */
+    unsigned long long nsec;      /**< Total elapsed time (ns). */
+    unsigned long long cycles;    /**< Total elapsed cycles (0 if not
+                                       available). */
+    unsigned long long hist[TPL_STATS_BUCKETS]; /**< Histogram of
+                                                     durations. */
+} TPL_Stats;
+
+/**
+ * Check whether instrumentation is available.
+ *
+ * @return `1` if the library has been compiled with `TPL_STATS` set,
+ *         `0` otherwise.
+ */
+extern int tpl_stats_enabled(void);
+
+/**
+ * Get the name of an entry point.
+ *
+ * @param id   Entry point identifier.
+ *
+ * @return The name of the function (without the type suffix), `NULL` if
+ *         `id` is invalid.
+ */
+extern char const* tpl_stats_name(TPL_StatsEntry id);
+
+/**
+ * Query the statistics of an entry point.
+ *
+ * The statistics are summed over all threads, including the terminated
+ * ones.  Counters of threads running an instrumented function during the
+ * query may be slightly out of date.
+ *
+ * @param id    Entry point identifier.
+ * @param st    Address to store the statistics.
+ *
+ * @return `0` on success, `-1` if `id` is invalid.
+ */
+extern int tpl_stats_query(TPL_StatsEntry id, TPL_Stats* st);
+
+/**
+ * Reset the statistics of all entry points for all threads.
+ *
+ * Counters are lazily cleared by their owner thread, this function is thus
+ * cheap and safe to call while other threads are running.
+ */
+extern void tpl_stats_reset(void);
+
+#if TPL_STATS
+
+/*
+ * Instrumentation of a function body, `TPL_STATS_BEGIN` must appear at the
+ * start of a block and `TPL_STATS_END` after the instrumented code in the
+ * same block.  These macros are for internal use.
+ */
+typedef struct {
+    unsigned long long nsec;
+    unsigned long long cycles;
+} TPL_StatsTimer;
+
+extern void tpl_stats_start(TPL_StatsTimer* tmr);
+extern void tpl_stats_record(TPL_StatsEntry id, long nelem,
+                             TPL_StatsTimer const* tmr);
+
+#  define TPL_STATS_BEGIN                       \
+    TPL_StatsTimer _tpl_stats_timer;            \
+    tpl_stats_start(&_tpl_stats_timer)
+#  define TPL_STATS_END(id, nelem)                      \
+    tpl_stats_record(id, nelem, &_tpl_stats_timer)
+
+#else /* TPL_STATS */
+
+#  define TPL_STATS_BEGIN           ((void)0)
+#  define TPL_STATS_END(id, nelem)  ((void)0)
+
+#endif /* TPL_STATS */
+
+_TPL_EXTERN_C_END
+
+#endif /* _TPL_STATS_H */
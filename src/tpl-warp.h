@@ -0,0 +1,872 @@
+/*
+ * tpl-warp.h -
+ *
+ * Definitions for geometric transforms of images in TPL library.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_WARP_H
+#define _TPL_WARP_H 1
+
+#include <tpl-base.h>
+#include <tpl-interp.h>
+#include <tpl-pool.h>
+
+_TPL_EXTERN_C_BEGIN
+
+/**
+ * @def tpl_shear_2d(dim, dst, src, len1, len2, a, b, ker, wrk)
+ *
+ * @brief Shear an image along one of its dimensions.
+ *
+ * The call `tpl_shear_2d(dim,dst,src,len1,len2,a,b,ker,wrk)` resamples each
+ * line of the image `src` along dimension `dim` with a fractional shift which
+ * depends linearly on the position of the line along the other dimension.
+ * For `dim = 1`:
+ *
+ * ```.c
+ * dst(i1,i2) = src(i1 + a + b*i2, i2)
+ * ```
+ *
+ * and for `dim = 2`:
+ *
+ * ```.c
+ * dst(i1,i2) = src(i1, i2 + a + b*i1)
+ * ```
+ *
+ * where non-integer coordinates are interpolated by the interpolation
+ * function `ker` and *flat* boundary conditions are assumed.
+ *
+ * For `dim = 1`, each line is loaded in the workspace and filtered by the
+ * vectorized code of tpl_filter() with the interpolation weights as
+ * coefficients, the operation can be done *in-place* (i.e., with `dst` and
+ * `src` being the same array).  For `dim = 2`, consecutive runs of lines
+ * with the same integer part of the shift are processed together so that the
+ * inner loop runs along the contiguous dimension, the operation cannot be
+ * done *in-place*.
+ *
+ * Column-major storage order is assumed for multi-dimensional arrays.
+ *
+ * @param dim    Dimension of interest (1 or 2).
+ * @param dst    Destination array of `len1*len2` elements.
+ * @param src    Source array of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of images.
+ * @param len2   Length of 2nd dimension of images.
+ * @param a      Shift at origin.
+ * @param b      Shear factor.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `ker->size*len1` elements.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_rotate_2d.
+ */
+#define tpl_shear_2d(dim, dst, src, len1, len2, a, b, ker, wrk)       \
+    _Generic(*(dst),                                                  \
+             float:  tpl_shear_2d_f,                                  \
+             double: tpl_shear_2d_d)                                  \
+    (dim, dst, src, len1, len2, a, b, ker, wrk)
+
+extern int
+tpl_shear_2d_f(int dim,
+               float* dst,
+               float const* src,
+               long len1,
+               long len2,
+               double a,
+               double b,
+               TPL_InterpolationFunction const* ker,
+               float*restrict wrk);
+
+extern int
+tpl_shear_2d_d(int dim,
+               double* dst,
+               double const* src,
+               long len1,
+               long len2,
+               double a,
+               double b,
+               TPL_InterpolationFunction const* ker,
+               double*restrict wrk);
+
+/**
+ * @def tpl_rotate_2d(dst, src, len1, len2, theta, c1, c2, ker, wrk)
+ *
+ * @brief Rotate an image by three successive shears.
+ *
+ * The call `tpl_rotate_2d(dst,src,len1,len2,theta,c1,c2,ker,wrk)` computes:
+ *
+ * ```.c
+ * dst(i1,i2) = src(c1 + cos(theta)*(i1 - c1) - sin(theta)*(i2 - c2),
+ *                  c2 + sin(theta)*(i1 - c1) + cos(theta)*(i2 - c2))
+ * ```
+ *
+ * that is the image `src` rotated by an angle `-theta` around the position
+ * `(c1,c2)`.  The rotation is decomposed in three successive shears (along
+ * the 1st, 2nd and 1st dimensions) with factors `-tan(theta/2)`, `sin(theta)`
+ * and `-tan(theta/2)`, each shear being a 1-dimensional fractional shift of
+ * the lines of the image, see tpl_shear_2d().  With an interpolation function
+ * of size 4, this amounts to 12 multiply-adds per pixel instead of 16 for a
+ * direct 2-dimensional interpolation.  The decomposition is exact but
+ * interpolation errors grow with the shear factors, hence this method is
+ * best suited for small angles (say `abs(theta) ≤ π/4`); larger angles
+ * should be reduced by exact rotations by multiples of `π/2`.
+ *
+ * Column-major storage order is assumed for multi-dimensional arrays.
+ *
+ * @param dst    Destination array of `len1*len2` elements.
+ * @param src    Source array of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of images.
+ * @param len2   Length of 2nd dimension of images.
+ * @param theta  Rotation angle (in radians).
+ * @param c1     Position of the center of rotation along 1st dimension.
+ * @param c2     Position of the center of rotation along 2nd dimension.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `len1*len2 + ker->size*len1`
+ *               elements.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_shear_2d.
+ */
+#define tpl_rotate_2d(dst, src, len1, len2, theta, c1, c2, ker, wrk)  \
+    _Generic(*(dst),                                                  \
+             float:  tpl_rotate_2d_f,                                 \
+             double: tpl_rotate_2d_d)                                 \
+    (dst, src, len1, len2, theta, c1, c2, ker, wrk)
+
+extern int
+tpl_rotate_2d_f(float*restrict dst,
+                float const*restrict src,
+                long len1,
+                long len2,
+                double theta,
+                double c1,
+                double c2,
+                TPL_InterpolationFunction const* ker,
+                float*restrict wrk);
+
+extern int
+tpl_rotate_2d_d(double*restrict dst,
+                double const*restrict src,
+                long len1,
+                long len2,
+                double theta,
+                double c1,
+                double c2,
+                TPL_InterpolationFunction const* ker,
+                double*restrict wrk);
+
+/**
+ * @def tpl_shear_2d_parallel(pool, dim, dst, src, len1, len2, a, b, ker, wrk)
+ *
+ * @brief Shear an image using a pool of threads.
+ *
+ * The call `tpl_shear_2d_parallel(pool,dim,dst,src,len1,len2,a,b,ker,wrk)`
+ * yields the same result as `tpl_shear_2d(dim,dst,src,len1,len2,a,b,ker,wrk)`
+ * but the rows of the destination are split in contiguous blocks processed
+ * by the threads of `pool`.  As for tpl_shear_2d(), the operation can be
+ * applied in-place if `dim = 1`.
+ *
+ * @param pool   Pool of threads (can be `NULL` to run in the calling
+ *               thread).
+ * @param dim    Dimension along which to shear (`1` or `2`).
+ * @param dst    Destination array of `len1*len2` elements.
+ * @param src    Source array of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of images.
+ * @param len2   Length of 2nd dimension of images.
+ * @param a      Offset of the shear.
+ * @param b      Factor of the shear.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `n*TPL_ALIGNED_LENGTH(ker->size*len1,
+ *               sizeof(*dst))` elements with `n = tpl_pool_size(pool)`.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_shear_2d, tpl_create_pool.
+ */
+#define tpl_shear_2d_parallel(pool, dim, dst, src, len1, len2, a, b, ker, wrk) \
+    _Generic(*(dst),                                                    \
+             float:  tpl_shear_2d_parallel_f,                           \
+             double: tpl_shear_2d_parallel_d)                           \
+    (pool, dim, dst, src, len1, len2, a, b, ker, wrk)
+
+extern int
+tpl_shear_2d_parallel_f(TPL_Pool* pool,
+                        int dim,
+                        float* dst,
+                        float const* src,
+                        long len1,
+                        long len2,
+                        double a,
+                        double b,
+                        TPL_InterpolationFunction const* ker,
+                        float*restrict wrk);
+
+extern int
+tpl_shear_2d_parallel_d(TPL_Pool* pool,
+                        int dim,
+                        double* dst,
+                        double const* src,
+                        long len1,
+                        long len2,
+                        double a,
+                        double b,
+                        TPL_InterpolationFunction const* ker,
+                        double*restrict wrk);
+
+/**
+ * @def tpl_rotate_2d_parallel(pool, dst, src, len1, len2, theta, c1, c2, ker, wrk)
+ *
+ * @brief Rotate an image by three successive shears using a pool of threads.
+ *
+ * The call `tpl_rotate_2d_parallel(pool,dst,src,len1,len2,theta,c1,c2,ker,wrk)`
+ * yields the same result as
+ * `tpl_rotate_2d(dst,src,len1,len2,theta,c1,c2,ker,wrk)`.  Each of the three
+ * shears is split by rows between the threads of `pool` and the threads are
+ * synchronized after each shear.
+ *
+ * @param pool   Pool of threads (can be `NULL` to run in the calling
+ *               thread).
+ * @param dst    Destination array of `len1*len2` elements.
+ * @param src    Source array of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of images.
+ * @param len2   Length of 2nd dimension of images.
+ * @param theta  Rotation angle (in radians).
+ * @param c1     Position of the center of rotation along 1st dimension.
+ * @param c2     Position of the center of rotation along 2nd dimension.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `TPL_ALIGNED_LENGTH(len1*len2, s) +
+ *               n*TPL_ALIGNED_LENGTH(ker->size*len1, s)` elements with
+ *               `n = tpl_pool_size(pool)` and `s = sizeof(*dst)`.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_rotate_2d, tpl_create_pool.
+ */
+#define tpl_rotate_2d_parallel(pool, dst, src, len1, len2, theta, c1, c2, ker, wrk) \
+    _Generic(*(dst),                                                    \
+             float:  tpl_rotate_2d_parallel_f,                          \
+             double: tpl_rotate_2d_parallel_d)                          \
+    (pool, dst, src, len1, len2, theta, c1, c2, ker, wrk)
+
+extern int
+tpl_rotate_2d_parallel_f(TPL_Pool* pool,
+                         float*restrict dst,
+                         float const*restrict src,
+                         long len1,
+                         long len2,
+                         double theta,
+                         double c1,
+                         double c2,
+                         TPL_InterpolationFunction const* ker,
+                         float*restrict wrk);
+
+extern int
+tpl_rotate_2d_parallel_d(TPL_Pool* pool,
+                         double*restrict dst,
+                         double const*restrict src,
+                         long len1,
+                         long len2,
+                         double theta,
+                         double c1,
+                         double c2,
+                         TPL_InterpolationFunction const* ker,
+                         double*restrict wrk);
+
+/**
+ * @def tpl_rotate_2d_batch(pool, nimgs, dst, src, len1, len2, theta, c1, c2, ker, wrk)
+ *
+ * @brief Rotate a batch of images.
+ *
+ * The call
+ * `tpl_rotate_2d_batch(pool,nimgs,dst,src,len1,len2,theta,c1,c2,ker,wrk)`
+ * yields the same results as `nimgs` calls to tpl_rotate_2d(), the `j`-th
+ * call rotating `src[j]` into `dst[j]` with dimensions `len1[j]` and
+ * `len2[j]`, angle `theta[j]` and center `(c1[j],c2[j])`.  The images may
+ * have different sizes, they are processed in parallel by the threads of
+ * `pool` with load balancing (see tpl_pool_run_jobs()).
+ *
+ * @param pool   Pool of threads (can be `NULL` to run in the calling
+ *               thread).
+ * @param nimgs  Number of images.
+ * @param dst    Destination arrays.
+ * @param src    Source arrays.
+ * @param len1   Lengths of 1st dimension of images.
+ * @param len2   Lengths of 2nd dimension of images.
+ * @param theta  Rotation angles (in radians).
+ * @param c1     Positions of the centers of rotation along 1st dimension.
+ * @param c2     Positions of the centers of rotation along 2nd dimension.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `n*TPL_ALIGNED_LENGTH(len,
+ *               sizeof(**dst))` elements with `n = tpl_pool_size(pool)` and
+ *               `len` the maximum of `len1[j]*len2[j] + ker->size*len1[j]`.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_rotate_2d, tpl_rotate_2d_parallel for splitting a single image.
+ */
+#define tpl_rotate_2d_batch(pool, nimgs, dst, src, len1, len2, theta, c1, c2, ker, wrk) \
+    _Generic(**(dst),                                                   \
+             float:  tpl_rotate_2d_batch_f,                             \
+             double: tpl_rotate_2d_batch_d)                             \
+    (pool, nimgs, dst, src, len1, len2, theta, c1, c2, ker, wrk)
+
+extern int
+tpl_rotate_2d_batch_f(TPL_Pool* pool,
+                      long nimgs,
+                      float* const dst[],
+                      float const* const src[],
+                      long const len1[],
+                      long const len2[],
+                      double const theta[],
+                      double const c1[],
+                      double const c2[],
+                      TPL_InterpolationFunction const* ker,
+                      float*restrict wrk);
+
+extern int
+tpl_rotate_2d_batch_d(TPL_Pool* pool,
+                      long nimgs,
+                      double* const dst[],
+                      double const* const src[],
+                      long const len1[],
+                      long const len2[],
+                      double const theta[],
+                      double const c1[],
+                      double const c2[],
+                      TPL_InterpolationFunction const* ker,
+                      double*restrict wrk);
+
+/**
+ * @def tpl_shear_2d_adj(dim, dst, src, len1, len2, a, b, ker, wrk)
+ *
+ * @brief Apply the adjoint of a shear of an image.
+ *
+ * The call `tpl_shear_2d_adj(dim,dst,src,len1,len2,a,b,ker,wrk)` overwrites
+ * `dst` with the adjoint (transpose) of the linear operator implemented by
+ * `tpl_shear_2d(dim,dst,src,len1,len2,a,b,ker,wrk)` applied to `src`.  The
+ * cost is about the same as the one of the direct operator.  For `dim = 1`,
+ * the lines of the images are processed independently and the operation can
+ * be done *in-place*.  For `dim = 2`, the rows of `src` are scattered into the
+ * rows of `dst` but each column of `dst` only depends on the same column of
+ * `src`, the operation cannot be done *in-place*.  See
+ * tpl_shear_2d_adj_parallel() to split the work between threads.
+ *
+ * @param dim    Dimension of interest (1 or 2).
+ * @param dst    Destination array of `len1*len2` elements.
+ * @param src    Source array of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of images.
+ * @param len2   Length of 2nd dimension of images.
+ * @param a      Shift at origin.
+ * @param b      Shear factor.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `2*len1 + 3*ker->size - 3` elements
+ *               if `dim = 1` and `ker->size*len1` elements if `dim = 2`.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_shear_2d, tpl_rotate_2d_adj.
+ */
+#define tpl_shear_2d_adj(dim, dst, src, len1, len2, a, b, ker, wrk)   \
+    _Generic(*(dst),                                                  \
+             float:  tpl_shear_2d_adj_f,                              \
+             double: tpl_shear_2d_adj_d)                              \
+    (dim, dst, src, len1, len2, a, b, ker, wrk)
+
+extern int
+tpl_shear_2d_adj_f(int dim,
+                   float* dst,
+                   float const* src,
+                   long len1,
+                   long len2,
+                   double a,
+                   double b,
+                   TPL_InterpolationFunction const* ker,
+                   float*restrict wrk);
+
+extern int
+tpl_shear_2d_adj_d(int dim,
+                   double* dst,
+                   double const* src,
+                   long len1,
+                   long len2,
+                   double a,
+                   double b,
+                   TPL_InterpolationFunction const* ker,
+                   double*restrict wrk);
+
+/**
+ * @def tpl_shear_2d_adj_parallel(pool, dim, dst, src, len1, len2, a, b, ker, wrk)
+ *
+ * @brief Apply the adjoint of a shear of an image using a pool of threads.
+ *
+ * The call
+ * `tpl_shear_2d_adj_parallel(pool,dim,dst,src,len1,len2,a,b,ker,wrk)` yields
+ * the same result as `tpl_shear_2d_adj(dim,dst,src,len1,len2,a,b,ker,wrk)`.
+ * Each thread of `pool` computes the part of `dst` it owns: a block of lines
+ * for `dim = 1`, a block of columns for `dim = 2` (including zeroing it), so
+ * no atomic operations are needed.  As for tpl_shear_2d_adj(), the operation
+ * can be applied in-place if `dim = 1`.
+ *
+ * @param pool   Pool of threads (can be `NULL` to run in the calling
+ *               thread).
+ * @param dim    Dimension of interest (1 or 2).
+ * @param dst    Destination array of `len1*len2` elements.
+ * @param src    Source array of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of images.
+ * @param len2   Length of 2nd dimension of images.
+ * @param a      Shift at origin.
+ * @param b      Shear factor.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `n*TPL_ALIGNED_LENGTH(len, s)`
+ *               elements with `n = tpl_pool_size(pool)`, `len =
+ *               max(2*len1 + 3*ker->size - 3, ker->size*len1)` and
+ *               `s = sizeof(*dst)`.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_shear_2d_adj, tpl_create_pool.
+ */
+#define tpl_shear_2d_adj_parallel(pool, dim, dst, src, len1, len2, a, b, ker, wrk) \
+    _Generic(*(dst),                                                    \
+             float:  tpl_shear_2d_adj_parallel_f,                       \
+             double: tpl_shear_2d_adj_parallel_d)                       \
+    (pool, dim, dst, src, len1, len2, a, b, ker, wrk)
+
+extern int
+tpl_shear_2d_adj_parallel_f(TPL_Pool* pool,
+                            int dim,
+                            float* dst,
+                            float const* src,
+                            long len1,
+                            long len2,
+                            double a,
+                            double b,
+                            TPL_InterpolationFunction const* ker,
+                            float*restrict wrk);
+
+extern int
+tpl_shear_2d_adj_parallel_d(TPL_Pool* pool,
+                            int dim,
+                            double* dst,
+                            double const* src,
+                            long len1,
+                            long len2,
+                            double a,
+                            double b,
+                            TPL_InterpolationFunction const* ker,
+                            double*restrict wrk);
+
+/**
+ * @def tpl_rotate_2d_adj(dst, src, len1, len2, theta, c1, c2, ker, wrk)
+ *
+ * @brief Apply the adjoint of the rotation of an image.
+ *
+ * The call `tpl_rotate_2d_adj(dst,src,len1,len2,theta,c1,c2,ker,wrk)`
+ * overwrites `dst` with the adjoint (transpose) of the linear operator
+ * implemented by `tpl_rotate_2d(dst,src,len1,len2,theta,c1,c2,ker,wrk)`
+ * applied to `src`.  This is done by applying the adjoint of the three
+ * shears in reverse order, see tpl_shear_2d_adj().
+ *
+ * @param dst    Destination array of `len1*len2` elements.
+ * @param src    Source array of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of images.
+ * @param len2   Length of 2nd dimension of images.
+ * @param theta  Rotation angle (in radians).
+ * @param c1     Position of the center of rotation along 1st dimension.
+ * @param c2     Position of the center of rotation along 2nd dimension.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `len1*len2 + max(2*len1 +
+ *               3*ker->size - 3, ker->size*len1)` elements.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_rotate_2d, tpl_shear_2d_adj.
+ */
+#define tpl_rotate_2d_adj(dst, src, len1, len2, theta, c1, c2, ker, wrk) \
+    _Generic(*(dst),                                                     \
+             float:  tpl_rotate_2d_adj_f,                                \
+             double: tpl_rotate_2d_adj_d)                                \
+    (dst, src, len1, len2, theta, c1, c2, ker, wrk)
+
+extern int
+tpl_rotate_2d_adj_f(float*restrict dst,
+                    float const*restrict src,
+                    long len1,
+                    long len2,
+                    double theta,
+                    double c1,
+                    double c2,
+                    TPL_InterpolationFunction const* ker,
+                    float*restrict wrk);
+
+extern int
+tpl_rotate_2d_adj_d(double*restrict dst,
+                    double const*restrict src,
+                    long len1,
+                    long len2,
+                    double theta,
+                    double c1,
+                    double c2,
+                    TPL_InterpolationFunction const* ker,
+                    double*restrict wrk);
+
+/**
+ * @def tpl_rotate_2d_adj_parallel(pool, dst, src, len1, len2, theta, c1, c2, ker, wrk)
+ *
+ * @brief Apply the adjoint of the rotation of an image using a pool of
+ * threads.
+ *
+ * The call
+ * `tpl_rotate_2d_adj_parallel(pool,dst,src,len1,len2,theta,c1,c2,ker,wrk)`
+ * yields the same result as
+ * `tpl_rotate_2d_adj(dst,src,len1,len2,theta,c1,c2,ker,wrk)`.  Each of the
+ * three adjoint shears is split between the threads of `pool` as by
+ * tpl_shear_2d_adj_parallel() and the threads are synchronized after each
+ * shear.
+ *
+ * @param pool   Pool of threads (can be `NULL` to run in the calling
+ *               thread).
+ * @param dst    Destination array of `len1*len2` elements.
+ * @param src    Source array of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of images.
+ * @param len2   Length of 2nd dimension of images.
+ * @param theta  Rotation angle (in radians).
+ * @param c1     Position of the center of rotation along 1st dimension.
+ * @param c2     Position of the center of rotation along 2nd dimension.
+ * @param ker    Interpolation function.
+ * @param wrk    Workspace with at least `TPL_ALIGNED_LENGTH(len1*len2, s) +
+ *               n*TPL_ALIGNED_LENGTH(len, s)` elements with
+ *               `n = tpl_pool_size(pool)`, `len = max(2*len1 +
+ *               3*ker->size - 3, ker->size*len1)` and `s = sizeof(*dst)`.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_rotate_2d_adj, tpl_create_pool.
+ */
+#define tpl_rotate_2d_adj_parallel(pool, dst, src, len1, len2, theta, c1, c2, ker, wrk) \
+    _Generic(*(dst),                                                    \
+             float:  tpl_rotate_2d_adj_parallel_f,                      \
+             double: tpl_rotate_2d_adj_parallel_d)                      \
+    (pool, dst, src, len1, len2, theta, c1, c2, ker, wrk)
+
+extern int
+tpl_rotate_2d_adj_parallel_f(TPL_Pool* pool,
+                             float*restrict dst,
+                             float const*restrict src,
+                             long len1,
+                             long len2,
+                             double theta,
+                             double c1,
+                             double c2,
+                             TPL_InterpolationFunction const* ker,
+                             float*restrict wrk);
+
+extern int
+tpl_rotate_2d_adj_parallel_d(TPL_Pool* pool,
+                             double*restrict dst,
+                             double const*restrict src,
+                             long len1,
+                             long len2,
+                             double theta,
+                             double c1,
+                             double c2,
+                             TPL_InterpolationFunction const* ker,
+                             double*restrict wrk);
+
+/**
+ * @def tpl_interp_grad_2d(n, val, der1, der2, x1, x2, src, len1, len2, ker)
+ *
+ * @brief Interpolate an image and its gradient at given positions.
+ *
+ * The call `tpl_interp_grad_2d(n,val,der1,der2,x1,x2,src,len1,len2,ker)`
+ * computes, for `i = 0, ..., n - 1`, the interpolated value `val[i]` of the
+ * image `src` at position `(x1[i],x2[i])` and the partial derivatives
+ * `der1[i]` and `der2[i]` of the interpolated image along the 1st and 2nd
+ * dimensions at the same position.  *Flat* boundary conditions are assumed.
+ *
+ * The interpolation weights of the function and of its derivative are
+ * computed together by `TPL_INTERP_FUNC_DERIV_WGTS` and each pixel of the
+ * `ker->size` by `ker->size` neighborhood of a position is read only once to
+ * compute the value and the two derivatives.
+ *
+ * Column-major storage order is assumed for multi-dimensional arrays.
+ *
+ * @param n      Number of positions.
+ * @param val    Destination array of `n` interpolated values.
+ * @param der1   Destination array of `n` derivatives along 1st dimension.
+ * @param der2   Destination array of `n` derivatives along 2nd dimension.
+ * @param x1     Coordinates of the positions along 1st dimension.
+ * @param x2     Coordinates of the positions along 2nd dimension.
+ * @param src    Source image of `len1*len2` elements.
+ * @param len1   Length of 1st dimension of source image.
+ * @param len2   Length of 2nd dimension of source image.
+ * @param ker    Interpolation function.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ */
+#define tpl_interp_grad_2d(n, val, der1, der2, x1, x2,                  \
+                           src, len1, len2, ker)                        \
+    _Generic(*(val),                                                    \
+             float:  tpl_interp_grad_2d_f,                              \
+             double: tpl_interp_grad_2d_d)                              \
+    (n, val, der1, der2, x1, x2, src, len1, len2, ker)
+
+extern int
+tpl_interp_grad_2d_f(long n,
+                     float*restrict val,
+                     float*restrict der1,
+                     float*restrict der2,
+                     double const*restrict x1,
+                     double const*restrict x2,
+                     float const*restrict src,
+                     long len1,
+                     long len2,
+                     TPL_InterpolationFunction const* ker);
+
+extern int
+tpl_interp_grad_2d_d(long n,
+                     double*restrict val,
+                     double*restrict der1,
+                     double*restrict der2,
+                     double const*restrict x1,
+                     double const*restrict x2,
+                     double const*restrict src,
+                     long len1,
+                     long len2,
+                     TPL_InterpolationFunction const* ker);
+
+/**
+ * @def tpl_resample_1d(dst, dst_len, src, src_len, off, step, ker)
+ *
+ * @brief Resample a 1-dimensional array.
+ *
+ * The call `tpl_resample_1d(dst,dst_len,src,src_len,off,step,ker)` computes:
+ *
+ * ```.c
+ * dst[j] = src(off + step*j)
+ * ```
+ *
+ * for `j = 0, ..., dst_len - 1` and where non-integer coordinates are
+ * interpolated by the interpolation function `ker` and *flat* boundary
+ * conditions are assumed.
+ *
+ * @param dst      Destination array.
+ * @param dst_len  Number of elements in destination array.
+ * @param src      Source array.
+ * @param src_len  Number of elements in source array.
+ * @param off      Coordinate in the source of the first destination element.
+ * @param step     Coordinate increment in the source between consecutive
+ *                 destination elements.
+ * @param ker      Interpolation function.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_resample_1d_adj.
+ */
+#define tpl_resample_1d(dst, dst_len, src, src_len, off, step, ker)     \
+    _Generic(*(dst),                                                    \
+             float:  tpl_resample_1d_f,                                 \
+             double: tpl_resample_1d_d)                                 \
+    (dst, dst_len, src, src_len, off, step, ker)
+
+extern int
+tpl_resample_1d_f(float*restrict dst,
+                  long dst_len,
+                  float const*restrict src,
+                  long src_len,
+                  double off,
+                  double step,
+                  TPL_InterpolationFunction const* ker);
+
+extern int
+tpl_resample_1d_d(double*restrict dst,
+                  long dst_len,
+                  double const*restrict src,
+                  long src_len,
+                  double off,
+                  double step,
+                  TPL_InterpolationFunction const* ker);
+
+/**
+ * @def tpl_resample_1d_parallel(pool, dst, dst_len, src, src_len, off, step, ker)
+ *
+ * @brief Resample a 1-dimensional array using a pool of threads.
+ *
+ * The call
+ * `tpl_resample_1d_parallel(pool,dst,dst_len,src,src_len,off,step,ker)`
+ * yields the same result as
+ * `tpl_resample_1d(dst,dst_len,src,src_len,off,step,ker)` but the
+ * destination is split in contiguous parts processed by the threads of
+ * `pool`.
+ *
+ * @param pool     Pool of threads (can be `NULL` to run in the calling
+ *                 thread).
+ * @param dst      Destination array.
+ * @param dst_len  Number of elements in destination array.
+ * @param src      Source array.
+ * @param src_len  Number of elements in source array.
+ * @param off      Coordinate in the source of the first destination element.
+ * @param step     Coordinate increment in the source between consecutive
+ *                 destination elements.
+ * @param ker      Interpolation function.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_resample_1d, tpl_create_pool.
+ */
+#define tpl_resample_1d_parallel(pool, dst, dst_len, src, src_len, off, step, ker) \
+    _Generic(*(dst),                                                    \
+             float:  tpl_resample_1d_parallel_f,                        \
+             double: tpl_resample_1d_parallel_d)                        \
+    (pool, dst, dst_len, src, src_len, off, step, ker)
+
+extern int
+tpl_resample_1d_parallel_f(TPL_Pool* pool,
+                           float*restrict dst,
+                           long dst_len,
+                           float const*restrict src,
+                           long src_len,
+                           double off,
+                           double step,
+                           TPL_InterpolationFunction const* ker);
+
+extern int
+tpl_resample_1d_parallel_d(TPL_Pool* pool,
+                           double*restrict dst,
+                           long dst_len,
+                           double const*restrict src,
+                           long src_len,
+                           double off,
+                           double step,
+                           TPL_InterpolationFunction const* ker);
+
+/**
+ * @def tpl_resample_1d_adj(dst, dst_len, src, src_len, off, step, ker)
+ *
+ * @brief Apply the adjoint of the resampling of a 1-dimensional array.
+ *
+ * The call `tpl_resample_1d_adj(dst,dst_len,src,src_len,off,step,ker)`
+ * overwrites `dst` with the adjoint (transpose) of the linear operator
+ * implemented by `tpl_resample_1d(…,src_len,…,dst_len,off,step,ker)` applied
+ * to `src`.  Note that `dst_len` and `src_len` are respectively the number of
+ * elements of the source and of the destination of the resampling.  Each
+ * value `src[j]` is spread with the same interpolation weights as the ones
+ * used by tpl_resample_1d() to compute the `j`-th resampled value, so that
+ * the cost is the same as the one of the resampling.
+ *
+ * @param dst      Destination array.
+ * @param dst_len  Number of elements in destination array.
+ * @param src      Source array.
+ * @param src_len  Number of elements in source array.
+ * @param off      Coordinate in the destination of the first source element.
+ * @param step     Coordinate increment in the destination between
+ *                 consecutive source elements.
+ * @param ker      Interpolation function.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_resample_1d.
+ */
+#define tpl_resample_1d_adj(dst, dst_len, src, src_len, off, step, ker) \
+    _Generic(*(dst),                                                    \
+             float:  tpl_resample_1d_adj_f,                             \
+             double: tpl_resample_1d_adj_d)                             \
+    (dst, dst_len, src, src_len, off, step, ker)
+
+extern int
+tpl_resample_1d_adj_f(float*restrict dst,
+                      long dst_len,
+                      float const*restrict src,
+                      long src_len,
+                      double off,
+                      double step,
+                      TPL_InterpolationFunction const* ker);
+
+extern int
+tpl_resample_1d_adj_d(double*restrict dst,
+                      long dst_len,
+                      double const*restrict src,
+                      long src_len,
+                      double off,
+                      double step,
+                      TPL_InterpolationFunction const* ker);
+
+/**
+ * @def tpl_resample_1d_adj_parallel(pool, dst, dst_len, src, src_len, off, step, ker)
+ *
+ * @brief Apply the adjoint of the resampling of a 1-dimensional array using a
+ * pool of threads.
+ *
+ * The call
+ * `tpl_resample_1d_adj_parallel(pool,dst,dst_len,src,src_len,off,step,ker)`
+ * yields the same result as
+ * `tpl_resample_1d_adj(dst,dst_len,src,src_len,off,step,ker)`.  The
+ * destination is split in contiguous parts, each thread of `pool` visits
+ * the source elements whose interpolation footprint intersects its part and
+ * only updates the elements of its part, so no atomic operations are needed.
+ *
+ * @param pool     Pool of threads (can be `NULL` to run in the calling
+ *                 thread).
+ * @param dst      Destination array.
+ * @param dst_len  Number of elements in destination array.
+ * @param src      Source array.
+ * @param src_len  Number of elements in source array.
+ * @param off      Coordinate in the destination of the first source element.
+ * @param step     Coordinate increment in the destination between
+ *                 consecutive source elements.
+ * @param ker      Interpolation function.
+ *
+ * @return `0` on success, `-1` if the size of the interpolation function
+ *         is not in the range `1` to ::TPL_INTERP_MAX_SIZE.
+ *
+ * @see tpl_resample_1d_adj, tpl_create_pool.
+ */
+#define tpl_resample_1d_adj_parallel(pool, dst, dst_len, src, src_len, off, step, ker) \
+    _Generic(*(dst),                                                    \
+             float:  tpl_resample_1d_adj_parallel_f,                    \
+             double: tpl_resample_1d_adj_parallel_d)                    \
+    (pool, dst, dst_len, src, src_len, off, step, ker)
+
+extern int
+tpl_resample_1d_adj_parallel_f(TPL_Pool* pool,
+                               float*restrict dst,
+                               long dst_len,
+                               float const*restrict src,
+                               long src_len,
+                               double off,
+                               double step,
+                               TPL_InterpolationFunction const* ker);
+
+extern int
+tpl_resample_1d_adj_parallel_d(TPL_Pool* pool,
+                               double*restrict dst,
+                               long dst_len,
+                               double const*restrict src,
+                               long src_len,
+                               double off,
+                               double step,
+                               TPL_InterpolationFunction const* ker);
+
+_TPL_EXTERN_C_END
+
+#endif /* _TPL_WARP_H */
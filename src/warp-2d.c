@@ -0,0 +1,753 @@
+/*
+ * warp-2d.c -
+ *
+ * Implementation of geometric transforms of images.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ */
+
+#ifndef _TPL_WARP_2D_C
+#define _TPL_WARP_2D_C 1
+
+#include <math.h>
+#include "tpl-warp.h"
+#include "tpl-filter.h"
+#include "tpl-inline.h"
+#include "tpl-pool.h"
+#include "tpl-stats.h"
+
+#define _tpl_index       long
+
+/* Assume column-major storage order. */
+#define dst(i1,i2)       dst[(i1) + len1*(i2)]
+#define src(i1,i2)       src[(i1) + len1*(i2)]
+
+/*
+ * Shearing along the 2nd dimension processes together the consecutive lines
+ * `i`, `i+1`, ... such that the integer part of the shift `a + b*i` is equal
+ * to `j`.  This function yields the index of the first line after such a run
+ * (but not beyond `n`).  The end of the run is computed directly rather than
+ * by testing each line, it may differ by rounding errors from `floor(a + b*i)`
+ * but this is harmless as long as the same rule is used to compute the
+ * interpolation weights and to apply them.
+ */
+static inline _tpl_index
+shear_run_end(double a, double b, _tpl_index i, double j, _tpl_index n)
+{
+    double r;
+    if (b > 0) {
+        r = ceil((j + 1 - a)/b);
+    } else if (b < 0) {
+        r = floor((j - a)/b) + 1;
+    } else {
+        return n;
+    }
+    return (r <= i ? i + 1 : (r >= n ? n : (_tpl_index)r));
+}
+
+/*
+ * Number of workspace elements needed by the adjoint shears for lines of
+ * `len1` elements: `2*len1 + 3*size - 3` to zero-pad and filter a line along
+ * the 1st dimension, `size*len1` for the weights along the 2nd dimension.
+ */
+static inline _tpl_index
+shear_adj_wrk_len(_tpl_index len1, _tpl_index size)
+{
+    _tpl_index n1 = 2*len1 + 3*size - 3;
+    _tpl_index n2 = size*len1;
+    return (n1 > n2 ? n1 : n2);
+}
+
+/*
+ * Split `len` columns in contiguous blocks, one per thread.  Blocks are made
+ * of whole groups of `grp` columns so that threads do not write in the same
+ * cache lines.
+ */
+static inline void
+split_columns(_tpl_index len, _tpl_index grp, long rank, long nranks,
+              _tpl_index* first, _tpl_index* last)
+{
+    _tpl_index lo, hi;
+    tpl_pool_split((len + grp - 1)/grp, rank, nranks, &lo, &hi);
+    *first = pvc_min(lo*grp, len);
+    *last = pvc_min(hi*grp, len);
+}
+
+#define _tpl_float          float
+#define _tpl_suffix         f
+#define _tpl_public(name)   tpl_##name##_f
+#define _tpl_private(name)  name##_f
+#include __FILE__
+
+#define _tpl_float          double
+#define _tpl_suffix         d
+#define _tpl_public(name)   tpl_##name##_d
+#define _tpl_private(name)  name##_d
+#include __FILE__
+
+#else /* _TPL_WARP_2D_C defined */
+
+/*
+ * Shear along the 1st dimension, that is `dst(i1,i2) = src(i1 + a + b*i2,
+ * i2)`.  Each line is loaded in the workspace with flat boundary conditions
+ * and filtered by the interpolation weights.  Can be applied in-place.
+ */
+static void
+_tpl_private(shear_1st)(_tpl_float* dst,
+                        _tpl_float const* src,
+                        _tpl_index len1,
+                        _tpl_index len2,
+                        double a,
+                        double b,
+                        TPL_InterpolationFunction const* ker,
+                        _tpl_float*restrict wrk)
+{
+    _tpl_index size = ker->size;
+    _tpl_index wrk_len = len1 + size - 1;
+    double w[TPL_INTERP_MAX_SIZE];
+    _tpl_float coefs[TPL_INTERP_MAX_SIZE];
+    for (_tpl_index i2 = 0; i2 < len2; ++i2) {
+        double s = a + b*i2;
+        double j = floor(s);
+        TPL_INTERP_FUNC_WGTS(ker, s - j, w);
+        for (_tpl_index k = 0; k < size; ++k) {
+            coefs[k] = w[k];
+        }
+        tpl_load_contiguous_flat(wrk_len, wrk, len1, &src(0, i2),
+                                 (_tpl_index)j - (size - 1)/2);
+        tpl_filter(size, len1, &dst(0, i2), coefs, wrk);
+    }
+}
+
+/*
+ * Adjoint of shear_1st.  Each line is zero-padded in the workspace and
+ * filtered by the reversed interpolation weights, the result is then folded
+ * into the destination by the adjoint of the flat boundary conditions.  Can
+ * be applied in-place.
+ */
+static void
+_tpl_private(shear_1st_adj)(_tpl_float* dst,
+                            _tpl_float const* src,
+                            _tpl_index len1,
+                            _tpl_index len2,
+                            double a,
+                            double b,
+                            TPL_InterpolationFunction const* ker,
+                            _tpl_float*restrict wrk)
+{
+    _tpl_index size = ker->size;
+    _tpl_index wrk_len = len1 + size - 1;
+    _tpl_float*restrict pad = wrk;
+    _tpl_float*restrict tmp = wrk + wrk_len + size - 1;
+    double w[TPL_INTERP_MAX_SIZE];
+    _tpl_float coefs[TPL_INTERP_MAX_SIZE];
+    for (_tpl_index k = 0; k < size - 1; ++k) {
+        pad[k] = 0;
+        pad[wrk_len + k] = 0;
+    }
+    for (_tpl_index i2 = 0; i2 < len2; ++i2) {
+        double s = a + b*i2;
+        double j = floor(s);
+        TPL_INTERP_FUNC_WGTS(ker, s - j, w);
+        for (_tpl_index k = 0; k < size; ++k) {
+            coefs[k] = w[size - 1 - k];
+        }
+        tpl_copy_contiguous(len1, &pad[size - 1], &src(0, i2));
+        tpl_filter(size, wrk_len, tmp, coefs, pad);
+        tpl_load_contiguous_flat_adj(wrk_len, tmp, len1, &dst(0, i2),
+                                     (_tpl_index)j - (size - 1)/2);
+    }
+}
+
+/*
+ * Compute the interpolation weights for shearing along the 2nd dimension
+ * the columns `first ≤ i1 < last`.  The weights are stored as `size`
+ * contiguous arrays of `last - first` elements.
+ */
+static void
+_tpl_private(shear_2nd_weights)(_tpl_index first,
+                                _tpl_index last,
+                                double a,
+                                double b,
+                                TPL_InterpolationFunction const* ker,
+                                _tpl_float*restrict wrk)
+{
+    _tpl_index size = ker->size;
+    _tpl_index n = last - first;
+    double w[TPL_INTERP_MAX_SIZE];
+    for (_tpl_index i1 = first, i1_end; i1 < last; i1 = i1_end) {
+        double j = floor(a + b*i1);
+        i1_end = shear_run_end(a, b, i1, j, last);
+        for (_tpl_index i = i1; i < i1_end; ++i) {
+            TPL_INTERP_FUNC_WGTS(ker, (a + b*i) - j, w);
+            for (_tpl_index k = 0; k < size; ++k) {
+                wrk[k*n + i - first] = w[k];
+            }
+        }
+    }
+}
+
+/*
+ * Shear along the 2nd dimension, that is `dst(i1,i2) = src(i1, i2 + a +
+ * b*i1)`, for the rows `first ≤ i2 < last` of the destination.  The
+ * interpolation weights are computed once for all and stored in the
+ * workspace, then the destination is computed row by row so that the inner
+ * loop runs along the contiguous dimension.  Cannot be applied in-place.
+ */
+static void
+_tpl_private(shear_2nd)(_tpl_float*restrict dst,
+                        _tpl_float const*restrict src,
+                        _tpl_index len1,
+                        _tpl_index len2,
+                        double a,
+                        double b,
+                        TPL_InterpolationFunction const* ker,
+                        _tpl_float*restrict wrk,
+                        _tpl_index first,
+                        _tpl_index last)
+{
+    _tpl_index size = ker->size;
+    _tpl_private(shear_2nd_weights)(0, len1, a, b, ker, wrk);
+    for (_tpl_index i2 = first; i2 < last; ++i2) {
+        _tpl_float*restrict d = &dst(0, i2);
+        for (_tpl_index i1 = 0, i1_end; i1 < len1; i1 = i1_end) {
+            double j = floor(a + b*i1);
+            i1_end = shear_run_end(a, b, i1, j, len1);
+            _tpl_index off = i2 + (_tpl_index)j - (size - 1)/2;
+            for (_tpl_index k = 0; k < size; ++k) {
+                _tpl_index src_i2 = pvc_min(pvc_max(off + k, 0), len2 - 1);
+                _tpl_float const*restrict s = &src(0, src_i2);
+                _tpl_float const*restrict c = &wrk[k*len1];
+                if (k == 0) {
+                    for (_tpl_index i = i1; i < i1_end; ++i) {
+                        d[i] = c[i]*s[i];
+                    }
+                } else {
+                    for (_tpl_index i = i1; i < i1_end; ++i) {
+                        d[i] += c[i]*s[i];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Adjoint of shear_2nd for the columns `first ≤ i1 < last`.  The rows of the
+ * source are scattered into the rows of the destination.  As each column of
+ * the destination only depends on the same column of the source, the work is
+ * split by blocks of columns without any conflicts, each block being zeroed
+ * and accumulated by the same thread.  The workspace has at least
+ * `ker->size*(last - first)` elements.  Cannot be applied in-place.
+ */
+static void
+_tpl_private(shear_2nd_adj)(_tpl_float*restrict dst,
+                            _tpl_float const*restrict src,
+                            _tpl_index len1,
+                            _tpl_index len2,
+                            double a,
+                            double b,
+                            TPL_InterpolationFunction const* ker,
+                            _tpl_float*restrict wrk,
+                            _tpl_index first,
+                            _tpl_index last)
+{
+    _tpl_index size = ker->size;
+    _tpl_index n = last - first;
+    _tpl_private(shear_2nd_weights)(first, last, a, b, ker, wrk);
+    for (_tpl_index i2 = 0; i2 < len2; ++i2) {
+        _tpl_float*restrict d = &dst(0, i2);
+        for (_tpl_index i = first; i < last; ++i) {
+            d[i] = 0;
+        }
+    }
+    for (_tpl_index i2 = 0; i2 < len2; ++i2) {
+        _tpl_float const*restrict s = &src(0, i2);
+        for (_tpl_index i1 = first, i1_end; i1 < last; i1 = i1_end) {
+            double j = floor(a + b*i1);
+            i1_end = shear_run_end(a, b, i1, j, last);
+            _tpl_index off = i2 + (_tpl_index)j - (size - 1)/2;
+            for (_tpl_index k = 0; k < size; ++k) {
+                _tpl_index dst_i2 = pvc_min(pvc_max(off + k, 0), len2 - 1);
+                _tpl_float*restrict d = &dst(0, dst_i2);
+                _tpl_float const*restrict c = &wrk[k*n];
+                for (_tpl_index i = i1; i < i1_end; ++i) {
+                    d[i] += c[i - first]*s[i];
+                }
+            }
+        }
+    }
+}
+
+int
+_tpl_public(shear_2d)(int dim,
+                      _tpl_float* dst,
+                      _tpl_float const* src,
+                      _tpl_index len1,
+                      _tpl_index len2,
+                      double a,
+                      double b,
+                      TPL_InterpolationFunction const* ker,
+                      _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    if (dim == 1) {
+        _tpl_private(shear_1st)(dst, src, len1, len2, a, b, ker, wrk);
+    } else {
+        _tpl_private(shear_2nd)(dst, src, len1, len2, a, b, ker, wrk,
+                                0, len2);
+    }
+    TPL_STATS_END(TPL_STATS_SHEAR_2D, len1*len2);
+    return 0;
+}
+
+int
+_tpl_public(rotate_2d)(_tpl_float*restrict dst,
+                       _tpl_float const*restrict src,
+                       _tpl_index len1,
+                       _tpl_index len2,
+                       double theta,
+                       double c1,
+                       double c2,
+                       TPL_InterpolationFunction const* ker,
+                       _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    /*
+     * The rotation matrix is factorized as:
+     *
+     *     [cos(θ) -sin(θ)]   [1 p] [1 0] [1 p]
+     *     [sin(θ)  cos(θ)] = [0 1]·[q 1]·[0 1]
+     *
+     * with p = -tan(θ/2) and q = sin(θ).  The 1st shear is applied out of
+     * place in the workspace, the last one in place in the destination.
+     */
+    double p = -tan(theta/2);
+    double q = sin(theta);
+    _tpl_float*restrict tmp = wrk;
+    wrk += len1*len2;
+    _tpl_private(shear_1st)(tmp, src, len1, len2, -p*c2, p, ker, wrk);
+    _tpl_private(shear_2nd)(dst, tmp, len1, len2, -q*c1, q, ker, wrk,
+                            0, len2);
+    _tpl_private(shear_1st)(dst, dst, len1, len2, -p*c2, p, ker, wrk);
+    TPL_STATS_END(TPL_STATS_ROTATE_2D, len1*len2);
+    return 0;
+}
+
+/*
+ * Arguments of the parallel shears and of their adjoints for the workers.
+ * Each thread uses its own part of `wrk_len` elements of the workspace
+ * `wrk`.
+ */
+struct _tpl_private(shear_task) {
+    int dim;
+    _tpl_float* dst;
+    _tpl_float const* src;
+    _tpl_index len1, len2;
+    double a, b;
+    TPL_InterpolationFunction const* ker;
+    _tpl_float* wrk;
+    _tpl_index wrk_len;
+};
+
+/*
+ * Each thread shears a block of consecutive rows of the destination.  For
+ * `dim = 1` the rows are independent, for `dim = 2` each row of the
+ * destination is interpolated from the neighboring rows of the whole
+ * source.
+ */
+static void
+_tpl_private(shear_worker)(void* arg, long rank, long nranks)
+{
+    struct _tpl_private(shear_task) const* t = arg;
+    _tpl_index len1 = t->len1;
+    _tpl_index first, last;
+    tpl_pool_split(t->len2, rank, nranks, &first, &last);
+    if (first >= last) {
+        return;
+    }
+    _tpl_float* wrk = t->wrk + rank*t->wrk_len;
+    if (t->dim == 1) {
+        _tpl_private(shear_1st)(t->dst + len1*first, t->src + len1*first,
+                                len1, last - first, t->a + t->b*first, t->b,
+                                t->ker, wrk);
+    } else {
+        _tpl_private(shear_2nd)(t->dst, t->src, len1, t->len2, t->a, t->b,
+                                t->ker, wrk, first, last);
+    }
+}
+
+int
+_tpl_public(shear_2d_parallel)(TPL_Pool* pool,
+                               int dim,
+                               _tpl_float* dst,
+                               _tpl_float const* src,
+                               _tpl_index len1,
+                               _tpl_index len2,
+                               double a,
+                               double b,
+                               TPL_InterpolationFunction const* ker,
+                               _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    struct _tpl_private(shear_task) t = {
+        .dim = dim, .dst = dst, .src = src, .len1 = len1, .len2 = len2,
+        .a = a, .b = b, .ker = ker, .wrk = wrk,
+        .wrk_len = TPL_ALIGNED_LENGTH(ker->size*len1, sizeof(_tpl_float))
+    };
+    tpl_pool_run(pool, _tpl_private(shear_worker), &t);
+    TPL_STATS_END(TPL_STATS_SHEAR_2D_PARALLEL, len1*len2);
+    return 0;
+}
+
+int
+_tpl_public(rotate_2d_parallel)(TPL_Pool* pool,
+                                _tpl_float*restrict dst,
+                                _tpl_float const*restrict src,
+                                _tpl_index len1,
+                                _tpl_index len2,
+                                double theta,
+                                double c1,
+                                double c2,
+                                TPL_InterpolationFunction const* ker,
+                                _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    /* Same factorization as tpl_rotate_2d, each shear is a parallel task
+       and the joins in-between guarantee that the rows needed by the next
+       shear are available. */
+    TPL_STATS_BEGIN;
+    double p = -tan(theta/2);
+    double q = sin(theta);
+    _tpl_float* tmp = wrk;
+    struct _tpl_private(shear_task) t = {
+        .dim = 1, .dst = tmp, .src = src, .len1 = len1, .len2 = len2,
+        .a = -p*c2, .b = p, .ker = ker,
+        .wrk = wrk + TPL_ALIGNED_LENGTH(len1*len2, sizeof(_tpl_float)),
+        .wrk_len = TPL_ALIGNED_LENGTH(ker->size*len1, sizeof(_tpl_float))
+    };
+    tpl_pool_run(pool, _tpl_private(shear_worker), &t);
+    t.dim = 2;
+    t.dst = dst;
+    t.src = tmp;
+    t.a = -q*c1;
+    t.b = q;
+    tpl_pool_run(pool, _tpl_private(shear_worker), &t);
+    t.dim = 1;
+    t.src = dst;
+    t.a = -p*c2;
+    t.b = p;
+    tpl_pool_run(pool, _tpl_private(shear_worker), &t);
+    TPL_STATS_END(TPL_STATS_ROTATE_2D_PARALLEL, len1*len2);
+    return 0;
+}
+
+/*
+ * Arguments of tpl_rotate_2d_batch() for the jobs.  Each thread uses its
+ * own part of `wrk_len` elements of the workspace `wrk`.
+ */
+struct _tpl_private(rotate_batch) {
+    _tpl_float* const* dst;
+    _tpl_float const* const* src;
+    _tpl_index const* len1;
+    _tpl_index const* len2;
+    double const* theta;
+    double const* c1;
+    double const* c2;
+    TPL_InterpolationFunction const* ker;
+    _tpl_float* wrk;
+    _tpl_index wrk_len;
+};
+
+static void
+_tpl_private(rotate_job)(void* arg, long j, long rank)
+{
+    struct _tpl_private(rotate_batch) const* b = arg;
+    _tpl_public(rotate_2d)(b->dst[j], b->src[j], b->len1[j], b->len2[j],
+                           b->theta[j], b->c1[j], b->c2[j], b->ker,
+                           b->wrk + rank*b->wrk_len);
+}
+
+int
+_tpl_public(rotate_2d_batch)(TPL_Pool* pool,
+                             _tpl_index nimgs,
+                             _tpl_float* const dst[],
+                             _tpl_float const* const src[],
+                             _tpl_index const len1[],
+                             _tpl_index const len2[],
+                             double const theta[],
+                             double const c1[],
+                             double const c2[],
+                             TPL_InterpolationFunction const* ker,
+                             _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    if (nimgs < 1) {
+        return 0;
+    }
+    TPL_STATS_BEGIN;
+    long nelem = 0;
+    _tpl_index wrk_len = 0;
+    for (_tpl_index j = 0; j < nimgs; ++j) {
+        _tpl_index len = len1[j]*len2[j] + ker->size*len1[j];
+        wrk_len = (len > wrk_len ? len : wrk_len);
+        nelem += len1[j]*len2[j];
+    }
+    struct _tpl_private(rotate_batch) b = {
+        .dst = dst, .src = src, .len1 = len1, .len2 = len2,
+        .theta = theta, .c1 = c1, .c2 = c2, .ker = ker,
+        .wrk = wrk, .wrk_len = TPL_ALIGNED_LENGTH(wrk_len, sizeof(_tpl_float))
+    };
+    tpl_pool_run_jobs(pool, nimgs, _tpl_private(rotate_job), &b);
+    TPL_STATS_END(TPL_STATS_ROTATE_2D_BATCH, nelem);
+    return 0;
+}
+
+int
+_tpl_public(shear_2d_adj)(int dim,
+                          _tpl_float* dst,
+                          _tpl_float const* src,
+                          _tpl_index len1,
+                          _tpl_index len2,
+                          double a,
+                          double b,
+                          TPL_InterpolationFunction const* ker,
+                          _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    if (dim == 1) {
+        _tpl_private(shear_1st_adj)(dst, src, len1, len2, a, b, ker, wrk);
+    } else {
+        _tpl_private(shear_2nd_adj)(dst, src, len1, len2, a, b, ker, wrk,
+                                    0, len1);
+    }
+    TPL_STATS_END(TPL_STATS_SHEAR_2D_ADJ, len1*len2);
+    return 0;
+}
+
+int
+_tpl_public(rotate_2d_adj)(_tpl_float*restrict dst,
+                           _tpl_float const*restrict src,
+                           _tpl_index len1,
+                           _tpl_index len2,
+                           double theta,
+                           double c1,
+                           double c2,
+                           TPL_InterpolationFunction const* ker,
+                           _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    /* Apply the adjoint of the shears of tpl_rotate_2d in reverse order. */
+    double p = -tan(theta/2);
+    double q = sin(theta);
+    _tpl_float*restrict tmp = wrk;
+    wrk += len1*len2;
+    _tpl_private(shear_1st_adj)(tmp, src, len1, len2, -p*c2, p, ker, wrk);
+    _tpl_private(shear_2nd_adj)(dst, tmp, len1, len2, -q*c1, q, ker, wrk,
+                                0, len1);
+    _tpl_private(shear_1st_adj)(dst, dst, len1, len2, -p*c2, p, ker, wrk);
+    TPL_STATS_END(TPL_STATS_ROTATE_2D_ADJ, len1*len2);
+    return 0;
+}
+
+/*
+ * Each thread applies the adjoint shear to the part of the destination it
+ * owns: a block of consecutive lines for `dim = 1`, a block of consecutive
+ * columns for `dim = 2`.  No destination element is updated by more than
+ * one thread, so no atomic operations are needed.
+ */
+static void
+_tpl_private(shear_adj_worker)(void* arg, long rank, long nranks)
+{
+    struct _tpl_private(shear_task) const* t = arg;
+    _tpl_index len1 = t->len1;
+    _tpl_index first, last;
+    _tpl_float* wrk = t->wrk + rank*t->wrk_len;
+    if (t->dim == 1) {
+        tpl_pool_split(t->len2, rank, nranks, &first, &last);
+        if (first < last) {
+            _tpl_private(shear_1st_adj)(t->dst + len1*first,
+                                        t->src + len1*first,
+                                        len1, last - first,
+                                        t->a + t->b*first, t->b,
+                                        t->ker, wrk);
+        }
+    } else {
+        split_columns(len1, TPL_ALIGNMENT/sizeof(_tpl_float), rank, nranks,
+                      &first, &last);
+        if (first < last) {
+            _tpl_private(shear_2nd_adj)(t->dst, t->src, len1, t->len2,
+                                        t->a, t->b, t->ker, wrk,
+                                        first, last);
+        }
+    }
+}
+
+int
+_tpl_public(shear_2d_adj_parallel)(TPL_Pool* pool,
+                                   int dim,
+                                   _tpl_float* dst,
+                                   _tpl_float const* src,
+                                   _tpl_index len1,
+                                   _tpl_index len2,
+                                   double a,
+                                   double b,
+                                   TPL_InterpolationFunction const* ker,
+                                   _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    struct _tpl_private(shear_task) t = {
+        .dim = dim, .dst = dst, .src = src, .len1 = len1, .len2 = len2,
+        .a = a, .b = b, .ker = ker, .wrk = wrk,
+        .wrk_len = TPL_ALIGNED_LENGTH(shear_adj_wrk_len(len1, ker->size),
+                                      sizeof(_tpl_float))
+    };
+    tpl_pool_run(pool, _tpl_private(shear_adj_worker), &t);
+    TPL_STATS_END(TPL_STATS_SHEAR_2D_ADJ_PARALLEL, len1*len2);
+    return 0;
+}
+
+int
+_tpl_public(rotate_2d_adj_parallel)(TPL_Pool* pool,
+                                    _tpl_float*restrict dst,
+                                    _tpl_float const*restrict src,
+                                    _tpl_index len1,
+                                    _tpl_index len2,
+                                    double theta,
+                                    double c1,
+                                    double c2,
+                                    TPL_InterpolationFunction const* ker,
+                                    _tpl_float*restrict wrk)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    /* Same as tpl_rotate_2d_adj, each adjoint shear is a parallel task. */
+    TPL_STATS_BEGIN;
+    double p = -tan(theta/2);
+    double q = sin(theta);
+    _tpl_float* tmp = wrk;
+    struct _tpl_private(shear_task) t = {
+        .dim = 1, .dst = tmp, .src = src, .len1 = len1, .len2 = len2,
+        .a = -p*c2, .b = p, .ker = ker,
+        .wrk = wrk + TPL_ALIGNED_LENGTH(len1*len2, sizeof(_tpl_float)),
+        .wrk_len = TPL_ALIGNED_LENGTH(shear_adj_wrk_len(len1, ker->size),
+                                      sizeof(_tpl_float))
+    };
+    tpl_pool_run(pool, _tpl_private(shear_adj_worker), &t);
+    t.dim = 2;
+    t.dst = dst;
+    t.src = tmp;
+    t.a = -q*c1;
+    t.b = q;
+    tpl_pool_run(pool, _tpl_private(shear_adj_worker), &t);
+    t.dim = 1;
+    t.src = dst;
+    t.a = -p*c2;
+    t.b = p;
+    tpl_pool_run(pool, _tpl_private(shear_adj_worker), &t);
+    TPL_STATS_END(TPL_STATS_ROTATE_2D_ADJ_PARALLEL, len1*len2);
+    return 0;
+}
+
+int
+_tpl_public(interp_grad_2d)(_tpl_index n,
+                            _tpl_float*restrict val,
+                            _tpl_float*restrict der1,
+                            _tpl_float*restrict der2,
+                            double const*restrict x1,
+                            double const*restrict x2,
+                            _tpl_float const*restrict src,
+                            _tpl_index len1,
+                            _tpl_index len2,
+                            TPL_InterpolationFunction const* ker)
+{
+    if (ker->size < 1 || ker->size > TPL_INTERP_MAX_SIZE) {
+        return -1;
+    }
+    TPL_STATS_BEGIN;
+    _tpl_index size = ker->size;
+    _tpl_index h = (size - 1)/2;
+    double wf1[TPL_INTERP_MAX_SIZE], wd1[TPL_INTERP_MAX_SIZE];
+    double wf2[TPL_INTERP_MAX_SIZE], wd2[TPL_INTERP_MAX_SIZE];
+    _tpl_index j1[TPL_INTERP_MAX_SIZE];
+    for (_tpl_index i = 0; i < n; ++i) {
+        double fl1 = floor(x1[i]);
+        double fl2 = floor(x2[i]);
+        TPL_INTERP_FUNC_DERIV_WGTS(ker, x1[i] - fl1, wf1, wd1);
+        TPL_INTERP_FUNC_DERIV_WGTS(ker, x2[i] - fl2, wf2, wd2);
+        _tpl_index i1 = (_tpl_index)fl1 - h;
+        _tpl_index i2 = (_tpl_index)fl2 - h;
+        double v = 0, d1 = 0, d2 = 0;
+        if (i1 >= 0 && i1 + size <= len1 && i2 >= 0 && i2 + size <= len2) {
+            /* Fast path: all neighbors are inside the image. */
+            _tpl_float const* p = &src(i1, i2);
+            for (_tpl_index k2 = 0; k2 < size; ++k2, p += len1) {
+                double rf = 0, rd = 0;
+                for (_tpl_index k1 = 0; k1 < size; ++k1) {
+                    double a = p[k1];
+                    rf += wf1[k1]*a;
+                    rd += wd1[k1]*a;
+                }
+                v  += wf2[k2]*rf;
+                d1 += wf2[k2]*rd;
+                d2 += wd2[k2]*rf;
+            }
+        } else {
+            for (_tpl_index k1 = 0; k1 < size; ++k1) {
+                j1[k1] = pvc_min(pvc_max(i1 + k1, 0), len1 - 1);
+            }
+            for (_tpl_index k2 = 0; k2 < size; ++k2) {
+                _tpl_index j2 = pvc_min(pvc_max(i2 + k2, 0), len2 - 1);
+                _tpl_float const* p = &src(0, j2);
+                double rf = 0, rd = 0;
+                for (_tpl_index k1 = 0; k1 < size; ++k1) {
+                    double a = p[j1[k1]];
+                    rf += wf1[k1]*a;
+                    rd += wd1[k1]*a;
+                }
+                v  += wf2[k2]*rf;
+                d1 += wf2[k2]*rd;
+                d2 += wd2[k2]*rf;
+            }
+        }
+        val[i] = v;
+        der1[i] = d1;
+        der2[i] = d2;
+    }
+    TPL_STATS_END(TPL_STATS_INTERP_GRAD_2D, n);
+    return 0;
+}
+
+#undef _tpl_float
+#undef _tpl_suffix
+#undef _tpl_public
+#undef _tpl_private
+
+#endif /* _TPL_WARP_2D_C */
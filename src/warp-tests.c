@@ -0,0 +1,373 @@
+/*
+ * warp-tests.c -
+ *
+ * Testing geometric transforms and their adjoints.
+ *
+ *-----------------------------------------------------------------------------
+ *
+ * This file is part of TPL software released under the MIT "Expat" license.
+ *
+ * Copyright (c) 2020: Éric Thiébaut <https://github.com/emmt/TPL>
+ *
+ */
+
+#include <stdlib.h> /* for EXIT_SUCCESS, etc. */
+#include <stdio.h>
+#include <math.h>
+#include <pvc-math.h>
+#include "tpl-pool.h"
+#include "tpl-warp.h"
+#include "tpl-sparse.h"
+
+#define LEN1 67
+#define LEN2 54
+
+static double
+inner(long n, double const* x, double const* y)
+{
+    double s = 0.0;
+    for (long i = 0; i < n; ++i) {
+        s += x[i]*y[i];
+    }
+    return s;
+}
+
+static void
+random_values(long n, double* x)
+{
+    for (long i = 0; i < n; ++i) {
+        x[i] = (double)rand()/RAND_MAX - 0.5;
+    }
+}
+
+/*
+ * Check that `<A.x,y> = <x,A'.y>` where `ax = A.x` has `m` elements and
+ * `aty = A'.y` has `n` elements.
+ */
+static int
+check_adjoint(char const* name, long m, double const* ax, double const* y,
+              long n, double const* x, double const* aty)
+{
+    double s1 = inner(m, ax, y);
+    double s2 = inner(n, x, aty);
+    double err = fabs(s1 - s2)/pvc_max(fabs(s1), fabs(s2));
+    printf("%-24s rel. err. = %g\n", name, err);
+    return (err < 1e-12 ? 0 : -1);
+}
+
+int main(int argc, char* argv[])
+{
+    int status = EXIT_SUCCESS;
+    long len1 = LEN1, len2 = LEN2, npix = LEN1*LEN2;
+    static double x[LEN1*LEN2], y[LEN1*LEN2];
+    static double ax[LEN1*LEN2], aty[LEN1*LEN2];
+    static double wrk[LEN1*LEN2 + 4*(LEN1 + 3)];
+    TPL_CardinalCubicSpline phi;
+    tpl_initialize_cardinal_cubic_spline(&phi, 0.0);
+    TPL_InterpolationFunction const* ker =
+        (TPL_InterpolationFunction const*)&phi;
+
+    /* Interpolation functions with too many weights are rejected. */
+    {
+        TPL_CardinalCubicSpline big = phi;
+        big.size = TPL_INTERP_MAX_SIZE + 1;
+        TPL_InterpolationFunction const* bad =
+            (TPL_InterpolationFunction const*)&big;
+        double p = 3.5;
+        int ok = 1;
+        ok &= (tpl_shear_2d(1, ax, x, len1, len2, 0.0, 0.1, bad, wrk) == -1);
+        ok &= (tpl_rotate_2d(ax, x, len1, len2, 0.3, 1.0, 2.0, bad,
+                             wrk) == -1);
+        ok &= (tpl_shear_2d_adj(2, ax, x, len1, len2, 0.0, 0.1, bad,
+                                wrk) == -1);
+        ok &= (tpl_interp_grad_2d(1, ax, ax + 1, ax + 2, &p, &p,
+                                  x, len1, len2, bad) == -1);
+        ok &= (tpl_resample_1d(ax, len2, x, len1, 0.0, 1.0, bad) == -1);
+        ok &= (tpl_resample_1d_adj_parallel(NULL, ax, len1, x, len2,
+                                            0.0, 1.0, bad) == -1);
+        TPL_InterpolationMatrix B;
+        ok &= (tpl_initialize_interpolation_matrix_d(&B, 1, &p, &p,
+                                                     len1, len2, bad) == -1);
+        tpl_finalize_interpolation_matrix(&B);
+        ok &= (tpl_shear_2d(1, ax, x, len1, len2, 0.0, 0.1, ker, wrk) == 0);
+        printf("interpolation function size check %s\n",
+               (ok ? "ok" : "FAILED"));
+        if (!ok) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* 1-dimensional resampling (with some samples out of bounds). */
+    random_values(len1, x);
+    random_values(len2, y);
+    tpl_resample_1d(ax, len2, x, len1, -3.3, 1.37, ker);
+    tpl_resample_1d_adj(aty, len1, y, len2, -3.3, 1.37, ker);
+    if (check_adjoint("tpl_resample_1d_adj", len2, ax, y,
+                      len1, x, aty) != 0) {
+        status = EXIT_FAILURE;
+    }
+
+    /* Shears. */
+    for (int dim = 1; dim <= 2; ++dim) {
+        random_values(npix, x);
+        random_values(npix, y);
+        tpl_shear_2d(dim, ax, x, len1, len2, 2.7, -0.21, ker, wrk);
+        tpl_shear_2d_adj(dim, aty, y, len1, len2, 2.7, -0.21, ker, wrk);
+        if (check_adjoint(dim == 1 ? "tpl_shear_2d_adj (dim=1)" :
+                          "tpl_shear_2d_adj (dim=2)", npix, ax, y,
+                          npix, x, aty) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Rotation. */
+    random_values(npix, x);
+    random_values(npix, y);
+    tpl_rotate_2d(ax, x, len1, len2, 0.4, 30.2, 25.7, ker, wrk);
+    tpl_rotate_2d_adj(aty, y, len1, len2, 0.4, 30.2, 25.7, ker, wrk);
+    if (check_adjoint("tpl_rotate_2d_adj", npix, ax, y,
+                      npix, x, aty) != 0) {
+        status = EXIT_FAILURE;
+    }
+
+    /* Accuracy of the rotation of a smooth image. */
+    double c1 = 33.1, c2 = 26.4, theta = 0.3, err_max = 0.0;
+    for (long i2 = 0; i2 < len2; ++i2) {
+        for (long i1 = 0; i1 < len1; ++i1) {
+            double u = (i1 - 30.0)/7.0, v = (i2 - 25.0)/5.0;
+            x[i1 + len1*i2] = exp(-(u*u + v*v)/2);
+        }
+    }
+    tpl_rotate_2d(ax, x, len1, len2, theta, c1, c2, ker, wrk);
+    for (long i2 = 0; i2 < len2; ++i2) {
+        for (long i1 = 0; i1 < len1; ++i1) {
+            double r1 = c1 + cos(theta)*(i1 - c1) - sin(theta)*(i2 - c2);
+            double r2 = c2 + sin(theta)*(i1 - c1) + cos(theta)*(i2 - c2);
+            double u = (r1 - 30.0)/7.0, v = (r2 - 25.0)/5.0;
+            double e = fabs(ax[i1 + len1*i2] - exp(-(u*u + v*v)/2));
+            err_max = pvc_max(err_max, e);
+        }
+    }
+    printf("tpl_rotate_2d            abs. err. max. = %g\n", err_max);
+    if (err_max > 1e-2) {
+        status = EXIT_FAILURE;
+    }
+
+    /* Parallel versus serial transforms, with and without workers. */
+    {
+        static double wrk2[TPL_ALIGNED_LENGTH(LEN1*LEN2, sizeof(double)) +
+                           3*TPL_ALIGNED_LENGTH(4*(LEN1 + 3), sizeof(double))];
+        TPL_Pool* pool = tpl_create_pool(2, NULL, 10000);
+        if (pool == NULL) {
+            fprintf(stderr, "failed to create pool of threads\n");
+            return EXIT_FAILURE;
+        }
+        random_values(npix, x);
+        double err = 0.0;
+        for (int k = 0; k < 2; ++k) {
+            TPL_Pool* p = (k == 0 ? NULL : pool);
+            tpl_resample_1d_parallel(p, y, len2, x, len1, -3.3, 1.37, ker);
+            tpl_resample_1d(ax, len2, x, len1, -3.3, 1.37, ker);
+            for (long i = 0; i < len2; ++i) {
+                err = pvc_max(err, fabs(y[i] - ax[i]));
+            }
+            for (int dim = 1; dim <= 2; ++dim) {
+                tpl_shear_2d_parallel(p, dim, y, x, len1, len2, 2.7, -0.21,
+                                      ker, wrk2);
+                tpl_shear_2d(dim, ax, x, len1, len2, 2.7, -0.21, ker, wrk);
+                for (long i = 0; i < npix; ++i) {
+                    err = pvc_max(err, fabs(y[i] - ax[i]));
+                }
+            }
+            tpl_rotate_2d_parallel(p, y, x, len1, len2, 0.4, 30.2, 25.7,
+                                   ker, wrk2);
+            tpl_rotate_2d(ax, x, len1, len2, 0.4, 30.2, 25.7, ker, wrk);
+            for (long i = 0; i < npix; ++i) {
+                err = pvc_max(err, fabs(y[i] - ax[i]));
+            }
+        }
+        printf("tpl_*_parallel           abs. err. max. = %g\n", err);
+        if (err > 1e-14) {
+            status = EXIT_FAILURE;
+        }
+
+        /* Parallel adjoints versus forward operators and serial adjoints. */
+        err = 0.0;
+        for (int k = 0; k < 2; ++k) {
+            TPL_Pool* p = (k == 0 ? NULL : pool);
+            random_values(npix, x);
+            random_values(npix, y);
+            tpl_resample_1d(ax, len2, x, len1, -3.3, 1.37, ker);
+            tpl_resample_1d_adj_parallel(p, aty, len1, y, len2,
+                                         -3.3, 1.37, ker);
+            if (check_adjoint("tpl_resample_1d_adj_parallel", len2, ax, y,
+                              len1, x, aty) != 0) {
+                status = EXIT_FAILURE;
+            }
+            tpl_resample_1d_adj(ax, len1, y, len2, -3.3, 1.37, ker);
+            for (long i = 0; i < len1; ++i) {
+                err = pvc_max(err, fabs(aty[i] - ax[i]));
+            }
+            /* Steps of both signs and larger than the destination. */
+            tpl_resample_1d_adj_parallel(p, aty, 40, y, len2,
+                                         47.5, -0.61, ker);
+            tpl_resample_1d_adj(ax, 40, y, len2, 47.5, -0.61, ker);
+            for (long i = 0; i < 40; ++i) {
+                err = pvc_max(err, fabs(aty[i] - ax[i]));
+            }
+            for (int dim = 1; dim <= 2; ++dim) {
+                tpl_shear_2d(dim, ax, x, len1, len2, 2.7, -0.21, ker, wrk);
+                tpl_shear_2d_adj_parallel(p, dim, aty, y, len1, len2,
+                                          2.7, -0.21, ker, wrk2);
+                if (check_adjoint(dim == 1 ?
+                                  "tpl_shear_2d_adj_parallel (dim=1)" :
+                                  "tpl_shear_2d_adj_parallel (dim=2)",
+                                  npix, ax, y, npix, x, aty) != 0) {
+                    status = EXIT_FAILURE;
+                }
+                tpl_shear_2d_adj(dim, ax, y, len1, len2, 2.7, -0.21,
+                                 ker, wrk);
+                for (long i = 0; i < npix; ++i) {
+                    err = pvc_max(err, fabs(aty[i] - ax[i]));
+                }
+            }
+            tpl_rotate_2d(ax, x, len1, len2, 0.4, 30.2, 25.7, ker, wrk);
+            tpl_rotate_2d_adj_parallel(p, aty, y, len1, len2,
+                                       0.4, 30.2, 25.7, ker, wrk2);
+            if (check_adjoint("tpl_rotate_2d_adj_parallel", npix, ax, y,
+                              npix, x, aty) != 0) {
+                status = EXIT_FAILURE;
+            }
+            tpl_rotate_2d_adj(ax, y, len1, len2, 0.4, 30.2, 25.7, ker, wrk);
+            for (long i = 0; i < npix; ++i) {
+                err = pvc_max(err, fabs(aty[i] - ax[i]));
+            }
+        }
+        tpl_destroy_pool(pool);
+        printf("tpl_*_adj_parallel       abs. err. max. = %g\n", err);
+        if (err > 1e-14) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Batch of rotations of images of different sizes. */
+    {
+        static double wrk2[3*TPL_ALIGNED_LENGTH(LEN1*LEN2 + 4*LEN1,
+                                                sizeof(double))];
+        static double buf[LEN1*LEN2 + 30*20 + 9*40];
+        long m1[3] = {len1, 30, 9}, m2[3] = {len2, 20, 40};
+        double theta[3] = {0.4, -0.2, 0.7};
+        double c1[3] = {30.2, 14.0, 4.5}, c2[3] = {25.7, 9.3, 20.1};
+        double* dst[3];
+        double const* src[3] = {x, x + 100, x + 7};
+        dst[0] = buf;
+        for (int j = 1; j < 3; ++j) {
+            dst[j] = dst[j-1] + m1[j-1]*m2[j-1];
+        }
+        TPL_Pool* pool = tpl_create_pool(2, NULL, 10000);
+        if (pool == NULL) {
+            fprintf(stderr, "failed to create pool of threads\n");
+            return EXIT_FAILURE;
+        }
+        random_values(npix, x);
+        double err = 0.0;
+        for (int k = 0; k < 2; ++k) {
+            tpl_rotate_2d_batch((k == 0 ? NULL : pool), 3, dst, src, m1, m2,
+                                theta, c1, c2, ker, wrk2);
+            for (int j = 0; j < 3; ++j) {
+                tpl_rotate_2d(ax, src[j], m1[j], m2[j], theta[j], c1[j],
+                              c2[j], ker, wrk);
+                for (long i = 0; i < m1[j]*m2[j]; ++i) {
+                    err = pvc_max(err, fabs(dst[j][i] - ax[i]));
+                }
+            }
+        }
+        tpl_destroy_pool(pool);
+        printf("tpl_rotate_2d_batch      abs. err. max. = %g\n", err);
+        if (err > 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    /* Fused interpolation of the value and of the gradient of a linear
+       image (exactly reproduced by a Catmull-Rom spline except near the
+       boundaries). */
+    double p1[LEN1], p2[LEN1], val[LEN1], der1[LEN1], der2[LEN1];
+    for (long i2 = 0; i2 < len2; ++i2) {
+        for (long i1 = 0; i1 < len1; ++i1) {
+            x[i1 + len1*i2] = 0.7*i1 - 1.3*i2 + 2.0;
+        }
+    }
+    for (long i = 0; i < len1; ++i) {
+        p1[i] = 2.0 + (len1 - 5.0)*rand()/RAND_MAX;
+        p2[i] = 2.0 + (len2 - 5.0)*rand()/RAND_MAX;
+    }
+    tpl_interp_grad_2d(len1, val, der1, der2, p1, p2, x, len1, len2, ker);
+    err_max = 0.0;
+    for (long i = 0; i < len1; ++i) {
+        double v = 0.7*p1[i] - 1.3*p2[i] + 2.0;
+        err_max = pvc_max(err_max, fabs(val[i] - v));
+        err_max = pvc_max(err_max, fabs(der1[i] - 0.7));
+        err_max = pvc_max(err_max, fabs(der2[i] + 1.3));
+    }
+    printf("tpl_interp_grad_2d       abs. err. max. = %g\n", err_max);
+    if (err_max > 1e-12) {
+        status = EXIT_FAILURE;
+    }
+
+    /* Sparse interpolation matrix (with some positions out of bounds). */
+    TPL_InterpolationMatrix A;
+    for (long i = 0; i < len1; ++i) {
+        p1[i] = -3.0 + (len1 + 6.0)*rand()/RAND_MAX;
+        p2[i] = -3.0 + (len2 + 6.0)*rand()/RAND_MAX;
+    }
+    if (tpl_initialize_interpolation_matrix_d(&A, len1, p1, p2,
+                                              len1, len2, ker) != 0) {
+        fprintf(stderr, "failed to initialize interpolation matrix\n");
+        return EXIT_FAILURE;
+    }
+    random_values(npix, x);
+    random_values(len1, y);
+    tpl_interp_grad_2d(len1, val, der1, der2, p1, p2, x, len1, len2, ker);
+    tpl_apply_interpolation_matrix(&A, ax, x);
+    tpl_apply_interpolation_matrix_adj(&A, aty, y);
+    err_max = 0.0;
+    for (long i = 0; i < len1; ++i) {
+        err_max = pvc_max(err_max, fabs(ax[i] - val[i]));
+    }
+    printf("interpolation matrix     abs. err. max. = %g\n", err_max);
+    if (err_max > 1e-12) {
+        status = EXIT_FAILURE;
+    }
+    if (check_adjoint("interpolation matrix adj", len1, ax, y,
+                      npix, x, aty) != 0) {
+        status = EXIT_FAILURE;
+    }
+    {
+        static double buf[LEN1*LEN2];
+        TPL_Pool* pool = tpl_create_pool(2, NULL, 10000);
+        if (pool == NULL) {
+            fprintf(stderr, "failed to create pool of threads\n");
+            return EXIT_FAILURE;
+        }
+        double err = 0.0;
+        for (int k = 0; k < 2; ++k) {
+            TPL_Pool* p = (k == 0 ? NULL : pool);
+            tpl_apply_interpolation_matrix_parallel(p, &A, buf, x);
+            for (long i = 0; i < len1; ++i) {
+                err = pvc_max(err, fabs(buf[i] - ax[i]));
+            }
+            tpl_apply_interpolation_matrix_adj_parallel(p, &A, buf, y);
+            for (long i = 0; i < npix; ++i) {
+                err = pvc_max(err, fabs(buf[i] - aty[i]));
+            }
+        }
+        tpl_destroy_pool(pool);
+        printf("interpolation matrix par abs. err. max. = %g\n", err);
+        if (err > 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+    tpl_finalize_interpolation_matrix(&A);
+    return status;
+}